@@ -0,0 +1,95 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+/**
+  * @file array_algorithms.hpp
+  * Contains the ArrayAlgorithms class, which sorts and deduplicates Array Values in place
+  *
+  * @brief in-place, multi-core sort, unique and dedupe of Array Values
+  * @author WhiZTiM
+  *
+  * Items are ordered by \ref Value::compare(), either as a whole or by the Value at a key path
+  * within each of them. They are moved around by pointer, never copied.
+  * Large Arrays are sorted in contiguous runs on several threads, and the runs are then merged
+  * pairwise, also concurrently
+  *
+  * @code
+  * Value records = reader.getValue();
+  * ArrayAlgorithms algorithms;
+  * algorithms.sort(records, {"user", "id"});      //by records[i]["user"]["id"]
+  * algorithms.unique(records, {"user", "id"});    //drops the now adjacent repeats
+  * @endcode
+  */
+
+#ifndef ARRAY_ALGORITHMS_HPP
+#define ARRAY_ALGORITHMS_HPP
+
+#include <cstddef>
+#include "value.hpp"
+
+namespace ubjson {
+
+    /*!
+     * \brief The ArrayAlgorithms class
+     * Each algorithm takes an Array Value, and an optional key path: the keys to follow, Map by Map,
+     * from each item to the Value it is ordered or compared by. An item the path can't be followed in
+     * is taken as Null, and so sorts first. An empty path means the item itself.
+     *
+     * A Null Value is taken as an empty Array; any other type throws value_exception.
+     * If a comparison throws, the Array is left as it was
+     */
+    class ArrayAlgorithms
+    {
+    public:
+        using KeyPath = Value::Keys;
+
+        /*!
+         * \param threads the most threads an algorithm runs on, the calling thread included; 0 lets \ref threadCount() choose
+         */
+        explicit ArrayAlgorithms(unsigned threads = 0);
+
+        //! sorts the items in ascending order; equal items may be reordered
+        void sort(Value& array, const KeyPath& key = KeyPath());
+
+        //! sorts the items in ascending order, keeping equal items in their original order
+        void stableSort(Value& array, const KeyPath& key = KeyPath());
+
+        /*!
+         * \brief removes every item equal to the one before it, like std::unique
+         * \return the number of items removed
+         */
+        std::size_t unique(Value& array, const KeyPath& key = KeyPath());
+
+        /*!
+         * \brief removes every item equal to an earlier one, wherever it is, by hashing;
+         * the first of each is kept and the order is otherwise preserved
+         * \return the number of items removed
+         */
+        std::size_t dedupe(Value& array, const KeyPath& key = KeyPath());
+
+        //! the number of threads the last algorithm ran on
+        unsigned getThreadsUsed() const { return threads_used; }
+
+    private:
+        static Value::ArrayType* items_of(Value& array, const char* algorithm);
+        static const Value* key_of(const Value& item, const KeyPath& key) noexcept;
+        void sort_items(Value& array, const KeyPath& key, bool stable);
+        unsigned workers_for(std::size_t items) const;
+
+        const unsigned max_threads;
+        unsigned threads_used = 0;
+    };
+
+}   //end namespace ubjson
+
+#endif // ARRAY_ALGORITHMS_HPP
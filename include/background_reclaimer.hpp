@@ -0,0 +1,90 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+/**
+  * @file background_reclaimer.hpp
+  * Contains the BackgroundReclaimer class, which destroys Values on a thread of its own
+  *
+  * @brief keep the freeing of large Values off latency sensitive threads
+  * @author WhiZTiM
+  *
+  * @code
+  * BackgroundReclaimer janitor;
+  *
+  * void handle(Request& request)
+  * {
+  *     Value response = buildResponse(request);
+  *     send(response);
+  *     janitor.dispose(std::move(response));      //O(1) here; freed on the janitor thread
+  * }
+  * @endcode
+  */
+
+#ifndef BACKGROUND_RECLAIMER_HPP
+#define BACKGROUND_RECLAIMER_HPP
+
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cstddef>
+#include <condition_variable>
+#include "value.hpp"
+
+namespace ubjson {
+
+    /*!
+     * \brief The BackgroundReclaimer class
+     * Takes Values that are no longer needed and destroys them on a janitor thread, in batches.
+     * Handing a Value over moves it, so it costs the same however large the Value is.
+     * Values whose containers are still shared with other Values only drop their share.
+     * Any number of threads may dispose() concurrently.
+     */
+    class BackgroundReclaimer
+    {
+    public:
+        //! starts the janitor thread
+        BackgroundReclaimer();
+
+        //! destroys whatever is still pending, then stops the janitor thread
+        ~BackgroundReclaimer();
+
+        BackgroundReclaimer(const BackgroundReclaimer&) = delete;
+        BackgroundReclaimer& operator = (const BackgroundReclaimer&) = delete;
+
+        /*!
+         * \brief hands \a v over to be destroyed on the janitor thread
+         * \post v.isNull() == true
+         */
+        void dispose(Value&& v);
+
+        //! waits until everything disposed of so far has been destroyed
+        void drain();
+
+        //! the number of Values disposed of and not destroyed yet
+        std::size_t getPendingCount() const;
+
+    private:
+        void run();
+
+        mutable std::mutex mutex;
+        std::condition_variable wake;       //!< the janitor, when there is work or it must stop
+        std::condition_variable drained;    //!< drain(), when a batch has been destroyed
+        std::vector<Value> pending;
+        std::size_t in_progress = 0;        //!< the size of the batch being destroyed
+        bool stopping = false;
+        std::thread janitor;
+    };
+
+}   //end namespace ubjson
+
+#endif // BACKGROUND_RECLAIMER_HPP
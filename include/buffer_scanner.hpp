@@ -0,0 +1,145 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+/**
+  * @file buffer_scanner.hpp
+  * Contains the BufferScanner class, the shared primitives for walking encoded UBJSON in memory
+  *
+  * @brief bounds checked, non-allocating navigation over an encoded buffer
+  * @author WhiZTiM
+  *
+  * Every position is a byte offset into the buffer. The scanner reads markers, counts and
+  * container headers, and skips whole values; only decodeScalar() and decodeValue() ever build a Value
+  */
+
+#ifndef BUFFER_SCANNER_HPP
+#define BUFFER_SCANNER_HPP
+
+#include <string>
+#include <cstddef>
+#include <utility>
+#include "types.hpp"
+#include "exception.hpp"
+#include "stream_helpers.hpp"
+#include "value.hpp"
+
+namespace ubjson {
+
+    /*!
+     * \brief The BufferScanner class
+     * Reads the structure of UBJSON encoded bytes in place.
+     * Malformed or truncated input throws \ref parsing_exception; it never reads past the buffer
+     */
+    class BufferScanner
+    {
+    public:
+        BufferScanner(const byte* data, std::size_t size, std::size_t max_depth)
+            : first(data), length(size), depth_limit(max_depth) {}
+
+        const byte* data() const noexcept { return first; }
+        std::size_t size() const noexcept { return length; }
+        std::size_t maxDepth() const noexcept { return depth_limit; }
+
+        //! the byte at \a pos; throws if \a pos is past the end
+        byte markerAt(std::size_t pos) const
+        {
+            require(pos, 1);
+            return first[pos];
+        }
+
+        /*!
+         * \brief payload size of a marker whose payload has a fixed size
+         * \return -1 for markers with a variable sized payload (strings, containers, ...) or invalid markers
+         */
+        static int fixedPayloadSize(byte marker) noexcept;
+
+        //! reads the integer payload of \a marker at \a pos
+        long long readInteger(byte marker, std::size_t pos) const;
+
+        /*!
+         * \brief reads a count (an integer marker and its payload) at \a pos
+         * \post \a pos is just past the count
+         */
+        std::size_t readCount(std::size_t& pos) const;
+
+        /*!
+         * \brief reads the payload of a string, key, binary or high precision number at \a pos
+         * \return the offset and size of the bytes
+         * \post \a pos is just past the bytes
+         */
+        std::pair<std::size_t, std::size_t> readSized(std::size_t& pos) const;
+
+        /*!
+         * \brief reads the optional '$' type and '#' count of a container
+         * \param pos the first byte after '[' or '{'
+         * \post \a pos is at the first child (its key, for objects)
+         * \throws parsing_exception if the count can't possibly fit in the rest of the buffer
+         */
+        STCHeader readContainerHeader(std::size_t& pos) const;
+
+        /*!
+         * \brief whether a typed container of payload-less items (Null, No-Op, bool) counts more than \a max_items.
+         * Those are the only counts that the size of the buffer doesn't bound
+         */
+        static bool exceedsItemLimit(const STCHeader& header, std::size_t max_items) noexcept
+        {
+            return header.has_type and fixedPayloadSize(static_cast<byte>(header.marker)) == 0 and
+                    header.item_count > max_items;
+        }
+
+        /*!
+         * \brief skips the payload of \a marker that starts at \a pos
+         * \return the position just past the payload
+         */
+        std::size_t skipPayload(byte marker, std::size_t pos) const
+        { return skip(marker, pos, 0); }
+
+        //! skips the value (marker and payload) at \a pos; returns the position just past it
+        std::size_t skipValue(std::size_t pos) const
+        { return skip(markerAt(pos), pos + 1, 0); }
+
+        /*!
+         * \brief decodes the payload of \a marker at \a pos, which must not be a container,
+         * exactly as StreamReader::extract_singleValueTo() does
+         */
+        Value decodeScalar(byte marker, std::size_t pos) const;
+
+        /*!
+         * \brief decodes the payload of \a marker at \a pos and everything in it, the same as StreamReader would
+         * \param depth the nesting depth of the value, checked against \a policy
+         * \post \a pos is just past the value
+         */
+        Value decodeValue(byte marker, std::size_t& pos, const ValueSizePolicy& policy, std::size_t depth = 0) const;
+
+        //! throws unless the \a bytes returned by readSized() are valid UTF-8
+        void checkUtf8(std::pair<std::size_t, std::size_t> bytes) const;
+
+        //! throws unless \a n bytes are available at \a pos
+        void require(std::size_t pos, std::size_t n) const
+        {
+            if(pos > length or n > length - pos)
+                throw parsing_exception("Unexpected end of buffer!");
+        }
+
+    private:
+        std::size_t skip(byte marker, std::size_t pos, std::size_t depth) const;
+        std::size_t skipContainer(bool is_object, std::size_t pos, std::size_t depth) const;
+
+        const byte* first;
+        std::size_t length;
+        std::size_t depth_limit;
+    };
+
+}   //end namespace ubjson
+
+#endif // BUFFER_SCANNER_HPP
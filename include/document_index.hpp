@@ -0,0 +1,118 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+/**
+  * @file document_index.hpp
+  * Contains the DocumentIndex class, a flat structural index (a "tape") of an encoded document
+  *
+  * @brief one pass over the bytes; O(1) random access afterwards
+  * @author WhiZTiM
+  *
+  * Every value of the document gets one \ref DocumentIndex::Entry, in document (pre-)order.
+  * The children of every container are also listed contiguously, so that the i-th element of
+  * an Array is a single lookup, and a key lookup only visits the children of its Map
+  *
+  * @code
+  * DocumentIndex index(bytes.data(), bytes.size());
+  *
+  * auto items = index.find(index.root(), "items");
+  * for(auto i = index.child(items, 0); i != DocumentIndex::npos; i = index[i].next_sibling)
+  *     cout << index.value(index.find(i, "id")).asInt() << '\n';
+  * @endcode
+  */
+
+#ifndef DOCUMENT_INDEX_HPP
+#define DOCUMENT_INDEX_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "value.hpp"
+#include "buffer_scanner.hpp"
+#include "stream_reader.hpp"
+
+namespace ubjson {
+
+    /*!
+     * \brief The DocumentIndex class
+     * Built by a single, non-recursive scan of the buffer, using the length prefixes and counts of UBJSON.
+     * The index is immutable once built, and so may be queried from multiple threads at once.
+     *
+     * \warning the buffer must outlive the index, and must not be modified
+     * \throws parsing_exception (from the constructor) if the document is malformed
+     */
+    class DocumentIndex
+    {
+    public:
+        using index_type = std::uint32_t;
+        static constexpr index_type npos = static_cast<index_type>(-1);
+
+        struct Entry
+        {
+            std::size_t offset;         //! of the marker; of the payload for elements of a typed container
+            std::size_t length;         //! of the whole encoded value, from \a offset
+            std::size_t key;            //! offset of the key of a Map member
+            std::uint32_t key_size;
+            index_type parent;          //! npos for the root
+            index_type next_sibling;    //! npos for the last child of a container
+            index_type first_child;     //! position of the children in the child table, for containers
+            index_type child_count;
+            byte marker;
+            bool typed;                 //! an element of a typed container; no marker precedes the payload
+        };
+
+        DocumentIndex(const byte* data, std::size_t size, ValueSizePolicy policy = defaultStreamReaderPolicy());
+        DocumentIndex(const char* data, std::size_t size, ValueSizePolicy policy = defaultStreamReaderPolicy());
+
+        //! the number of values in the document
+        std::size_t size() const noexcept { return entries.size(); }
+
+        index_type root() const noexcept { return 0; }
+
+        const Entry& operator [] (index_type i) const { return entries[i]; }
+
+        //! offset of the payload of \a i (just past its marker)
+        std::size_t payload(index_type i) const
+        { return entries[i].offset + (entries[i].typed ? 0 : 1); }
+
+        //! the \a n-th child of the container \a i, or npos if there is none
+        index_type child(index_type i, std::size_t n) const;
+
+        //! the value of \a key in the Map \a i, or npos if there is none
+        index_type find(index_type i, const char* key, std::size_t size) const;
+        index_type find(index_type i, const std::string& key) const
+        { return find(i, key.data(), key.size()); }
+        index_type find(index_type i, const char* key) const
+        { return find(i, key, std::char_traits<char>::length(key)); }
+
+        //! the key of the Map member \a i
+        std::string key(index_type i) const;
+
+        //! decodes \a i and everything in it, the same as StreamReader would
+        Value value(index_type i) const;
+
+        //! the encoded bytes
+        const byte* data() const noexcept { return scanner.data(); }
+
+    private:
+        void build(const ValueSizePolicy& policy);
+        index_type append(byte marker, std::size_t offset, bool typed, index_type parent);
+
+        BufferScanner scanner;
+        std::vector<Entry> entries;
+        std::vector<index_type> children;       //! the children of each container, contiguous
+    };
+
+}   //end namespace ubjson
+
+#endif // DOCUMENT_INDEX_HPP
@@ -0,0 +1,144 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+/**
+  * @file high_precision.hpp
+  * Contains the HighPrecisionNumber class, the storage for UBJSON high precision ('H') numbers
+  *
+  * @brief arbitrary precision decimal numbers
+  * @author WhiZTiM
+  *
+  * A high precision number is kept exactly as written (it is a JSON number in text form),
+  * but packed two characters per byte. Up to \ref HighPrecisionNumber::inline_capacity
+  * characters are stored inline, without any heap allocation
+  *
+  * @code
+  * HighPrecisionNumber price("1234567890.12345678901234567890");
+  * Value v = price;
+  *
+  * v.asFloat();            // 1234567890.1234567
+  * v.asString();           // "1234567890.12345678901234567890"
+  * @endcode
+  */
+
+#ifndef HIGH_PRECISION_HPP
+#define HIGH_PRECISION_HPP
+
+#include <string>
+#include <cstdint>
+#include <ostream>
+#include <type_traits>
+#include "types.hpp"
+
+namespace ubjson {
+
+    /*!
+     * \brief The HighPrecisionNumber class
+     * Holds the text of a JSON number, packed in 4-bit codes: the digits, '-', '+', '.', 'e' and 'E'
+     */
+    class HighPrecisionNumber
+    {
+    public:
+        //! number of characters that fit without a heap allocation
+        static constexpr std::size_t inline_capacity = 48;
+
+        //! constructs an empty (and therefore not \ref isValid()) number
+        HighPrecisionNumber() noexcept;
+
+        /*!
+         * \brief constructs from the text of a JSON number
+         * \throws value_exception if \a text isn't a valid JSON number
+         */
+        HighPrecisionNumber(const char* text, std::size_t size);
+
+        //SFINAE zone :-)
+        //! only a real string or char pointer; a Value (which converts to both) uses its own conversion instead
+        template<typename T, typename = std::enable_if_t<std::is_same<T, std::string>::value or
+                                                         std::is_convertible<const T&, const char*>::value>>
+        explicit HighPrecisionNumber(const T& text)
+            : HighPrecisionNumber(data_of(text), size_of(text)) {}
+
+        HighPrecisionNumber(const HighPrecisionNumber&);
+        HighPrecisionNumber(HighPrecisionNumber&&) noexcept;
+        HighPrecisionNumber& operator = (const HighPrecisionNumber&);
+        HighPrecisionNumber& operator = (HighPrecisionNumber&&) noexcept;
+        ~HighPrecisionNumber();
+
+        //! number of characters in the text form
+        std::size_t size() const noexcept { return length; }
+        bool empty() const noexcept { return length == 0; }
+
+        //! returns the character at \a idx of the text form
+        char operator [] (std::size_t idx) const noexcept;
+
+        /*!
+         * \brief copies at most \a count characters, starting at \a pos, into \a dest
+         * \return the number of characters copied
+         */
+        std::size_t copy(char* dest, std::size_t count, std::size_t pos = 0) const noexcept;
+
+        //! the text form, exactly as it was constructed
+        std::string str() const;
+
+        /*!
+         * \brief appends characters to the text form; used by stream readers to build a number in place
+         * \throws value_exception if any character can never be part of a JSON number.
+         * \note the grammar is only checked by \ref isValid()
+         */
+        void append(const char* text, std::size_t size);
+
+        //! reserves storage for \a size characters
+        void reserve(std::size_t size);
+
+        //! whether the text form is a valid JSON number
+        bool isValid() const noexcept;
+
+        /*!
+         * \brief converts to the nearest double.
+         * Numbers whose significant digits make an integer of at most 2^53 (so up to 16 digits), scaled by a power
+         * of ten within 10^-22 to 10^22, are converted exactly without touching the C library; every other number
+         * falls back to std::strtod, through a buffer on the stack
+         */
+        double toDouble() const noexcept;
+
+        //! if the number is a plain non-negative integer that fits, stores it in \a out and returns \e true
+        bool toUint64(unsigned long long& out) const noexcept;
+
+        //! if the number is a plain integer that fits, stores it in \a out and returns \e true
+        bool toInt64(long long& out) const noexcept;
+
+        friend bool operator == (const HighPrecisionNumber&, const HighPrecisionNumber&) noexcept;
+        friend bool operator != (const HighPrecisionNumber&, const HighPrecisionNumber&) noexcept;
+
+        //! writes the exact text form
+        friend std::ostream& operator << (std::ostream&, const HighPrecisionNumber&);
+
+    private:
+        static const char* data_of(const std::string& text) noexcept { return text.data(); }
+        static const char* data_of(const char* text) noexcept { return text; }
+        static std::size_t size_of(const std::string& text) noexcept { return text.size(); }
+        static std::size_t size_of(const char* text) noexcept { return std::char_traits<char>::length(text); }
+
+        bool on_heap() const noexcept { return capacity > inline_capacity; }
+        byte* packed() noexcept;
+        const byte* packed() const noexcept;
+        byte code_at(std::size_t idx) const noexcept;
+
+        byte storage[24];           //! the packed codes inline, or a pointer to them when on_heap()
+        std::uint32_t length;       //! in characters
+        std::uint32_t capacity;     //! in characters
+    };
+
+}   //end namespace ubjson
+
+#endif // HIGH_PRECISION_HPP
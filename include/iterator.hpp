@@ -14,7 +14,10 @@
 #ifndef ITERATOR_HPP
 #define ITERATOR_HPP
 
+#include <string>
+#include <cstddef>
 #include <iterator>
+#include <type_traits>
 #include "types.hpp"
 
 namespace ubjson {
@@ -34,10 +37,10 @@ public:
     {
         switch (parent->vtype) {
         case Type::Array:
-            arr_iter = (p == pos::begin) ? parent->value.Array.begin() : parent->value.Array.end();
+            arr_iter = (p == pos::begin) ? parent->array().begin() : parent->array().end();
             break;
         case Type::Map:
-            map_iter = (p == pos::begin) ? parent->value.Map.begin() : parent->value.Map.end();
+            map_iter = (p == pos::begin) ? parent->map().begin() : parent->map().end();
             break;
         default:
             break;
@@ -117,6 +120,156 @@ private:
     Array_IteratorType arr_iter;
 };
 
+
+
+/*!
+ * \brief Iterates over the items of an Array, and only of an Array; see \ref Value::elements().
+ * Unlike value_iterator, it is random access, and is no more than the iterator of the underlying storage,
+ * so it is as cheap to copy, advance and compare, and std::sort(), std::lower_bound() and the like run on it directly
+ */
+template<typename Value_Type, typename Array_IteratorType>
+class value_array_iterator :
+        public std::iterator<std::random_access_iterator_tag, Value_Type>
+{
+public:
+    using difference_type = std::ptrdiff_t;
+
+    value_array_iterator() = default;
+
+    explicit value_array_iterator(Array_IteratorType Array_iter)
+        : arr_iter(Array_iter)
+    {  }
+
+    //! an iterator over mutable items converts to one over const items
+    template<typename Other_Value_Type, typename Other_IteratorType,
+             typename = std::enable_if_t<std::is_convertible<Other_IteratorType, Array_IteratorType>::value>>
+    value_array_iterator(const value_array_iterator<Other_Value_Type, Other_IteratorType>& other)
+        : arr_iter(other.base())
+    {  }
+
+    //! the iterator of the underlying storage
+    Array_IteratorType base() const { return arr_iter; }
+
+    Value_Type& operator * () const
+    {   return **arr_iter; }
+
+    Value_Type* operator -> () const
+    {   return arr_iter->get(); }
+
+    Value_Type& operator [] (difference_type n) const
+    {   return *arr_iter[n]; }
+
+    value_array_iterator& operator ++ () { ++arr_iter; return *this; }
+    value_array_iterator& operator -- () { --arr_iter; return *this; }
+    value_array_iterator operator ++ (int) { return value_array_iterator(arr_iter++); }
+    value_array_iterator operator -- (int) { return value_array_iterator(arr_iter--); }
+
+    value_array_iterator& operator += (difference_type n) { arr_iter += n; return *this; }
+    value_array_iterator& operator -= (difference_type n) { arr_iter -= n; return *this; }
+
+    friend value_array_iterator operator + (value_array_iterator it, difference_type n) { return it += n; }
+    friend value_array_iterator operator + (difference_type n, value_array_iterator it) { return it += n; }
+    friend value_array_iterator operator - (value_array_iterator it, difference_type n) { return it -= n; }
+
+    friend difference_type operator - (const value_array_iterator& lhs, const value_array_iterator& rhs)
+    {   return lhs.arr_iter - rhs.arr_iter;   }
+
+    friend bool operator == (const value_array_iterator& lhs, const value_array_iterator& rhs)
+    {   return lhs.arr_iter == rhs.arr_iter;   }
+    friend bool operator != (const value_array_iterator& lhs, const value_array_iterator& rhs)
+    {   return lhs.arr_iter != rhs.arr_iter;   }
+    friend bool operator < (const value_array_iterator& lhs, const value_array_iterator& rhs)
+    {   return lhs.arr_iter < rhs.arr_iter;   }
+    friend bool operator > (const value_array_iterator& lhs, const value_array_iterator& rhs)
+    {   return lhs.arr_iter > rhs.arr_iter;   }
+    friend bool operator <= (const value_array_iterator& lhs, const value_array_iterator& rhs)
+    {   return lhs.arr_iter <= rhs.arr_iter;   }
+    friend bool operator >= (const value_array_iterator& lhs, const value_array_iterator& rhs)
+    {   return lhs.arr_iter >= rhs.arr_iter;   }
+
+private:
+    Array_IteratorType arr_iter{};
+};
+
+
+/*!
+ * \brief A member of a Map, as yielded by \ref Value::items(): its key and its value,
+ * both referring to the Map itself; nothing is copied
+ */
+template<typename Value_Type>
+struct value_member
+{
+    const std::string& key;
+    Value_Type& value;
+};
+
+
+/*!
+ * \brief Iterates over the members of a Map, yielding each as a value_member.
+ * The value_member is made on dereference rather than stored, so this is an input iterator,
+ * though copies of it can be advanced independently
+ */
+template<typename Value_Type, typename Map_IteratorType>
+class value_member_iterator :
+        public std::iterator<std::input_iterator_tag, value_member<Value_Type>, std::ptrdiff_t,
+                             void, value_member<Value_Type>>
+{
+public:
+    value_member_iterator() = default;
+
+    explicit value_member_iterator(Map_IteratorType Map_iter)
+        : map_iter(Map_iter)
+    {  }
+
+    value_member<Value_Type> operator * () const
+    {   return { map_iter->first, *map_iter->second }; }
+
+    value_member_iterator& operator ++ () //prefix
+    {
+        ++map_iter;
+        return *this;
+    }
+
+    value_member_iterator operator ++ (int)
+    {
+        auto rtn = value_member_iterator(*this);
+        operator ++();
+        return rtn;
+    }
+
+    friend bool operator == (const value_member_iterator& lhs, const value_member_iterator& rhs)
+    {   return lhs.map_iter == rhs.map_iter;   }
+
+    friend bool operator != (const value_member_iterator& lhs, const value_member_iterator& rhs)
+    {   return  !(lhs == rhs);   }
+
+private:
+    Map_IteratorType map_iter{};
+};
+
+
+//! A pair of iterators, for range-based for loops
+template<typename Iterator>
+class iterator_range
+{
+public:
+    iterator_range() = default;
+
+    iterator_range(Iterator First, Iterator Last)
+        : first(First), last(Last)
+    {  }
+
+    Iterator begin() const { return first; }
+    Iterator end() const { return last; }
+    bool empty() const { return first == last; }
+
+    //! constant time for random access iterators
+    std::size_t size() const { return static_cast<std::size_t>(std::distance(first, last)); }
+
+private:
+    Iterator first{}, last{};
+};
+
 }
 
 #endif // ITERATOR_HPP
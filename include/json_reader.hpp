@@ -0,0 +1,104 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+/**
+  * @file json_reader.hpp
+  * Contains the JsonReader class, which parses JSON text into a Value
+  *
+  * @brief fast JSON input, without an intermediate DOM
+  * @author WhiZTiM
+  *
+  * Parsing takes two passes. The first finds every structural character ({}[]:, the opening quote of
+  * each string and the first byte of each number or literal) 64 bytes at a time, with SSE2 where
+  * available; the second walks those positions and builds the Value in place
+  *
+  * @code
+  * JsonReader reader;                          //keep it around; its buffers are reused
+  * for(const std::string& body : requests)
+  * {
+  *     Value doc = reader.parse(body);
+  *     . . .
+  * }
+  * @endcode
+  */
+
+#ifndef JSON_READER_HPP
+#define JSON_READER_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "value.hpp"
+#include "exception.hpp"
+#include "stream_reader.hpp"
+
+namespace ubjson {
+
+    /*!
+     * \brief The JsonReader class
+     * Parses one JSON document into a Value. Malformed input throws \ref parsing_exception.
+     *
+     * - integers become SignedInt, or UnsignedInt above the range of long long, just as Value(long long) and
+     *   Value(unsigned long long) choose; integers beyond both, and numbers too large for a double, are kept
+     *   exactly as HighPrecision
+     * - numbers with a fraction or an exponent become Float, correctly rounded
+     * - empty objects and arrays are kept as empty Maps and Arrays
+     * - when a key repeats, the last value wins
+     *
+     * Like StreamReader, the depth, the size of the text (as max_object_size), the size of strings,
+     * and, when \a policy.validate_utf8 is set, the UTF-8 of strings and keys are checked against the policy.
+     * The structural index and the key buffer are kept between calls, so a long lived reader
+     * doesn't allocate for them again
+     */
+    class JsonReader
+    {
+    public:
+        explicit JsonReader(ValueSizePolicy policy = defaultStreamReaderPolicy())
+            : vsz(policy) {}
+
+        //! parses \a text, which must hold exactly one JSON value, optionally surrounded by whitespace
+        Value parse(const char* text, std::size_t size);
+
+        Value parse(const std::string& text)
+        { return parse(text.data(), text.size()); }
+
+    private:
+        void index(const char* text, std::size_t size);
+        void parse_value(Value& v, std::size_t depth);
+        void parse_object(Value& v, std::size_t depth);
+        void parse_array(Value& v, std::size_t depth);
+        void parse_string(std::size_t pos, std::string& out);
+        void parse_literal(Value& v, std::size_t pos);
+        void parse_number(Value& v, std::size_t pos);
+
+        static const char* read_number(const char* first, const char* last, Value& v);
+        static const char* unescape(const char* p, const char* last, std::string& out);
+        static void check_string(const ValueSizePolicy& policy, const char* str, std::size_t size);
+
+        //! the character at the next structural position, or '\0' at the end; the position is consumed
+        char next_structural() noexcept;
+
+        friend class JsonToUbjson;
+
+        const ValueSizePolicy vsz;
+        std::vector<uint32_t> structurals;      //!< reused across parse() calls
+        std::string key;                        //!< reused by every key
+        const char* doc = nullptr;
+        std::size_t doc_size = 0;
+        const uint32_t* cursor = nullptr;
+    };
+
+}   //end namespace ubjson
+
+#endif // JSON_READER_HPP
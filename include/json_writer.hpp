@@ -0,0 +1,117 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+/**
+  * @file json_writer.hpp
+  * Contains the JsonWriter class, which serializes a Value to JSON text
+  *
+  * @brief fast JSON output into a growable buffer
+  * @author WhiZTiM
+  *
+  * @code
+  * JsonWriter writer;                          //compact
+  * writer.writeValue(value);
+  * send(socket, writer.data(), writer.size());
+  *
+  * std::string text = JsonWriter(JsonWriter::pretty).writeValue(value).release();
+  *
+  * writer.beginObject().writeKey("id", 2).writeInteger(7).endObject();     //a piece at a time
+  * @endcode
+  */
+
+#ifndef JSON_WRITER_HPP
+#define JSON_WRITER_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include "value.hpp"
+
+namespace ubjson {
+
+    /*!
+     * \brief The JsonWriter class
+     * Appends the JSON text of Values to its buffer, which is reused across clear() calls.
+     *
+     * - strings and keys are escaped as JSON requires (quotes, backslashes and control characters)
+     * - doubles are written with the shortest digits that read back the same (Grisu2),
+     *   and keep a ".0" when integral; NaN and infinities, which JSON can't represent, are written as null
+     * - high precision numbers are written as the numbers they hold
+     * - binaries are written as arrays of their byte values
+     *
+     * The pretty layout is the one to_ostream has always had.
+     * Documents can also be written a piece at a time, with the begin, end and write calls below;
+     * writeValue() is built on them, and may be mixed with them
+     */
+    class JsonWriter
+    {
+    public:
+        enum Opt : char { pretty, compact };
+
+        explicit JsonWriter(Opt option = compact)
+            : ppretty(option == pretty) {}
+
+        //! appends \a value; the writer is returned for chaining
+        JsonWriter& writeValue(const Value& value);
+
+        JsonWriter& beginObject();
+        JsonWriter& endObject();
+        JsonWriter& beginArray();
+        JsonWriter& endArray();
+
+        //! the key of the next member of the innermost object; its value must follow
+        JsonWriter& writeKey(const char* key, std::size_t size);
+
+        JsonWriter& writeNull();
+        JsonWriter& writeBool(bool b);
+        JsonWriter& writeInteger(long long i);
+        JsonWriter& writeUnsigned(unsigned long long u);
+        JsonWriter& writeFloat(double d);
+        JsonWriter& writeString(const char* str, std::size_t size);
+
+        //! writes \a text, which must already be a valid JSON number, as it is
+        JsonWriter& writeNumber(const char* text, std::size_t size);
+
+        const char* data() const noexcept { return out.data(); }
+        std::size_t size() const noexcept { return out.size(); }
+
+        //! the text written so far
+        const std::string& str() const noexcept { return out; }
+
+        //! moves the text out, leaving the writer empty
+        std::string release() { std::string rtn(std::move(out)); out.clear(); return rtn; }
+
+        //! empties the buffer, keeping its capacity. Open objects and arrays stay open,
+        //! so a large document can be handed out in pieces
+        void clear() noexcept { out.clear(); }
+
+    private:
+        void write_value(const Value& v);
+        void write_binary(const Value::BinaryType& b);
+        void write_string(const char* str, std::size_t size);
+        void write_integer(unsigned long long u, bool negative);
+        void write_double(double d);
+        void separate();
+        void indent();
+
+        //! the open objects and arrays, innermost last
+        enum : unsigned char { in_object = 1, has_items = 2 };
+
+        std::string out;
+        std::vector<unsigned char> open;
+        const bool ppretty;
+    };
+
+}   //end namespace ubjson
+
+#endif // JSON_WRITER_HPP
@@ -0,0 +1,89 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+/**
+  * @file parallel_reader.hpp
+  * Contains the ParallelReader class, which decodes a huge top-level Array on several threads
+  *
+  * @brief multi-core decoding of in-memory documents
+  * @author WhiZTiM
+  *
+  * The boundaries of the elements of the top-level Array are found first, by a pass that only
+  * skips over the bytes. The elements are then split into ranges of about the same encoded size,
+  * decoded concurrently, and placed into the resulting Array in their original order
+  *
+  * @code
+  * ParallelReader reader(bytes.data(), bytes.size());
+  * Value records;
+  * if(not reader.getValue(records))
+  *     cerr << reader.getLastError() << endl;
+  * @endcode
+  */
+
+#ifndef PARALLEL_READER_HPP
+#define PARALLEL_READER_HPP
+
+#include <string>
+#include "value.hpp"
+#include "buffer_scanner.hpp"
+#include "stream_reader.hpp"
+
+namespace ubjson {
+
+    /*!
+     * \brief The ParallelReader class
+     * Decodes the single document in a buffer into a Value, exactly as StreamReader would.
+     * If the document is an Array that is large enough, its elements are decoded on up to
+     * \a threads threads; any other document is decoded on the calling thread
+     *
+     * \warning the buffer must stay alive and unmodified for the duration of getValue()
+     */
+    class ParallelReader
+    {
+    public:
+        /*!
+         * \param threads the maximum number of threads to decode with, including the calling thread,
+         * or 0 for one per core, see \ref threadCount()
+         */
+        ParallelReader(const byte* data, std::size_t size, ValueSizePolicy policy = defaultStreamReaderPolicy(),
+                       unsigned threads = 0);
+        ParallelReader(const char* data, std::size_t size, ValueSizePolicy policy = defaultStreamReaderPolicy(),
+                       unsigned threads = 0);
+
+        Value getValue();
+
+        //! decodes the document into \a v; on failure, returns false and records the error
+        bool getValue(Value& v);
+
+        //! the size of the document that was decoded last
+        std::size_t getBytesRead() const { return bytes_read; }
+
+        std::string getLastError() const { return last_error; }
+
+        //! the number of threads the last document was decoded with
+        unsigned getThreadsUsed() const { return threads_used; }
+
+    private:
+        Value decodeArray(std::size_t& pos);
+
+        BufferScanner scanner;
+        const ValueSizePolicy vsz;
+        const unsigned max_threads;
+        std::size_t bytes_read = 0;
+        unsigned threads_used = 0;
+        std::string last_error;
+    };
+
+}   //end namespace ubjson
+
+#endif // PARALLEL_READER_HPP
@@ -0,0 +1,44 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+/**
+  * @file parallel_tasks.hpp
+  * Contains threadCount() and runTasks()
+  *
+  * @brief The fork-join helpers ParallelReader and ArrayAlgorithms share; not needed to use the library
+  * @author WhiZTiM
+  */
+
+#ifndef PARALLEL_TASKS_HPP
+#define PARALLEL_TASKS_HPP
+
+#include <cstddef>
+#include <functional>
+
+namespace ubjson {
+
+    //! \a threads, or if it is 0, std::thread::hardware_concurrency(), and at least 1
+    unsigned threadCount(unsigned threads) noexcept;
+
+    /*!
+     * \brief runs task(0) ... task(count - 1), each on a thread of its own, one of them the calling thread,
+     * and waits for them all. If threads can't be started, the rest run on the calling thread, one after another.
+     * Starting a thread costs in the order of ten microseconds, so each task should be worth more than that
+     * \return the number of threads the tasks ran on
+     * \throws the first exception any task threw, once every task has finished
+     */
+    unsigned runTasks(std::size_t count, const std::function<void(std::size_t)>& task);
+
+}   //end namespace ubjson
+
+#endif // PARALLEL_TASKS_HPP
@@ -0,0 +1,157 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+/**
+  * @file persistent_value.hpp
+  * Contains the PersistentValue class, an immutable Value whose updates share structure with the original
+  *
+  * @brief cheap snapshots of versioned state
+  * @author WhiZTiM
+  *
+  * Maps are hash array mapped tries and Arrays are 32-way tries of chunks. An update copies only the
+  * path from the root to what changed, O(log n) nodes, and every other node is shared with the previous version
+  *
+  * @code
+  * PersistentValue v1 = config;                        //converted once
+  * PersistentValue v2 = v1.with("limits", v1["limits"].with("max_users", Value(500)));
+  *
+  * v1["limits"]["max_users"].asInt();                  //still the old value
+  * v2["limits"]["max_users"].asInt();                  //500
+  * Value plain = v2.toValue();
+  * @endcode
+  */
+
+#ifndef PERSISTENT_VALUE_HPP
+#define PERSISTENT_VALUE_HPP
+
+#include <memory>
+#include <string>
+#include <cstddef>
+#include "value.hpp"
+
+namespace ubjson {
+
+    /*!
+     * \brief The PersistentValue class
+     * An immutable Value. The navigation API follows \ref Value, and every update (with(), without(), pushBack())
+     * returns a new PersistentValue, leaving this one, and everything that shares nodes with it, unchanged.
+     *
+     * Copies are O(1). Since nodes are never modified once built, any number of threads may read the same
+     * versions concurrently without locks; only assigning to a PersistentValue object that other threads
+     * are reading needs synchronization, just as for a std::shared_ptr.
+     */
+    class PersistentValue
+    {
+    public:
+        //! constructs a Null PersistentValue
+        PersistentValue() noexcept = default;
+
+        /*!
+         * \brief converts \a v and everything in it, in O(n)
+         * \post toValue() == v
+         */
+        PersistentValue(const Value& v);
+
+        Type type() const noexcept;
+
+        //! \see Value::size()
+        std::size_t size() const noexcept;
+
+        bool isMap() const noexcept { return type() == Type::Map; }
+        bool isNull() const noexcept { return type() == Type::Null; }
+        bool isArray() const noexcept { return type() == Type::Array; }
+        bool isObject() const noexcept { return isMap(); }
+
+        //! conversions follow exactly the rules of the Value::asX() family
+        bool                asBool()   const;
+        int                 asInt()    const;
+        long long           asInt64()  const;
+        unsigned long long  asUint64() const;
+        double              asFloat()  const;
+        std::string         asString() const;
+
+        /*!
+         * \brief the element at \a i of an Array, in O(log n)
+         * \throws std::out_of_range if there is no such element, value_exception if this isn't an Array
+         */
+        const PersistentValue& operator [] (int i) const;
+
+        /*!
+         * \brief the value of \a key in a Map, in O(log n)
+         * \throws std::out_of_range if there is no such key, value_exception if this isn't a Map
+         */
+        const PersistentValue& operator [] (const char* key) const;
+        const PersistentValue& operator [] (const std::string& key) const;
+
+        //! the value of \a key in a Map \return nullptr if there is no such key, or this isn't a Map
+        const PersistentValue* find(const std::string& key) const noexcept;
+
+        //! whether this is a Map that has \a key
+        bool contains(const std::string& key) const noexcept
+        { return find(key) != nullptr; }
+
+        //! \see Value::keys()
+        Value::Keys keys() const;
+
+        /*!
+         * \brief this Map with \a key set to \a v, in O(log n). A Null is taken as an empty Map, like Value::operator []
+         * \throws value_exception if this is neither a Map nor Null
+         */
+        PersistentValue with(const std::string& key, PersistentValue v) const;
+        PersistentValue with(const char* key, PersistentValue v) const
+        { return with(std::string(key), std::move(v)); }
+
+        /*!
+         * \brief this Array with the element at \a i replaced by \a v, in O(log n)
+         * \throws std::out_of_range if there is no such element, value_exception if this isn't an Array
+         */
+        PersistentValue with(int i, PersistentValue v) const;
+
+        /*!
+         * \brief this Map without \a key, in O(log n); the same version if there is no such key
+         * \throws value_exception if this isn't a Map
+         */
+        PersistentValue without(const std::string& key) const;
+
+        /*!
+         * \brief this Array with \a v appended, in O(log n). A Null is taken as an empty Array, like Value::push_back()
+         * \throws value_exception if this is neither an Array nor Null
+         */
+        PersistentValue pushBack(PersistentValue v) const;
+
+        //! builds a Value equal to this, in O(n). Empty containers stay empty Maps and Arrays
+        Value toValue() const;
+
+        //! whether \a other is the very same version, not merely an equal one
+        bool sharesWith(const PersistentValue& other) const noexcept
+        { return node == other.node; }
+
+    private:
+        struct Node;
+        struct Scalar;
+        struct Vector;
+        struct Trie;
+
+        explicit PersistentValue(std::shared_ptr<const Node> n) noexcept
+            : node(std::move(n)) {}
+
+        const Vector& vector() const;
+        const Trie& trie() const;
+        Value scalar() const;
+
+        std::shared_ptr<const Node> node;     //!< nullptr for Null
+    };
+
+}   //end namespace ubjson
+
+#endif // PERSISTENT_VALUE_HPP
@@ -0,0 +1,145 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+/**
+  * @file record_reader.hpp
+  * Contains the RecordReader class, a pipelined reader of concatenated UBJSON documents
+  *
+  * @brief parallel decoding of record streams, delivered in order
+  * @author WhiZTiM
+  *
+  * One thread frames the documents, by skipping over them using their markers and lengths;
+  * a pool of workers decodes the frames; and getNextValue() hands the results out in their
+  * original order. At most \ref RecordReaderPolicy::max_pending records are ever ahead of the consumer
+  *
+  * @code
+  * RecordReader reader(bytes.data(), bytes.size());    //e.g. an mmap()ed log file
+  * Value record;
+  * while(reader.getNextValue(record))
+  *     process(record);
+  * if(not reader.getLastError().empty())
+  *     cerr << reader.getLastError() << endl;
+  * @endcode
+  */
+
+#ifndef RECORD_READER_HPP
+#define RECORD_READER_HPP
+
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+#include "value.hpp"
+#include "buffer_scanner.hpp"
+#include "stream_reader.hpp"
+
+namespace ubjson {
+
+    /*!
+     * \brief The RecordReaderPolicy struct
+     * A POD struct for the parallelism and the backpressure of RecordReader
+     */
+    struct RecordReaderPolicy       //NOTE: Please never reorder the members, because, brace initializer{}
+    {
+        //! The number of decoding threads; 0 is the \ref threadCount() default
+        unsigned workers;
+
+        //! The maximum number of records framed but not yet consumed; framing pauses beyond it
+        std::size_t max_pending;
+    };
+
+    constexpr RecordReaderPolicy defaultRecordReaderPolicy()
+    { return {0, 256}; }
+
+
+    /*!
+     * \brief The RecordReader class
+     * Reads a buffer of independent, concatenated UBJSON documents.
+     * Each record is decoded exactly as StreamReader would decode it.
+     *
+     * getNextValue() returns false at the end of the buffer, and for a record that could not be decoded;
+     * getLastError() tells them apart. A record that fails to decode doesn't stop the ones after it,
+     * but a failure to frame (a truncated or corrupt document) ends the stream.
+     *
+     * \warning the buffer must outlive the reader, and must not be modified
+     * \note getNextValue() must only be called from one thread at a time
+     */
+    class RecordReader
+    {
+    public:
+        RecordReader(const byte* data, std::size_t size, ValueSizePolicy policy = defaultStreamReaderPolicy(),
+                     RecordReaderPolicy rpolicy = defaultRecordReaderPolicy());
+        RecordReader(const char* data, std::size_t size, ValueSizePolicy policy = defaultStreamReaderPolicy(),
+                     RecordReaderPolicy rpolicy = defaultRecordReaderPolicy());
+
+        //! stops the pipeline; records that were not consumed are dropped
+        ~RecordReader();
+
+        RecordReader(const RecordReader&) = delete;
+        RecordReader& operator = (const RecordReader&) = delete;
+
+        Value getNextValue();
+
+        bool getNextValue(Value& v);
+
+        //! the total size of the records consumed so far
+        std::size_t getBytesRead() const { return bytes_so_far; }
+
+        std::string getLastError() const { return last_error; }
+
+    private:
+        struct Frame
+        {
+            std::size_t seq;
+            std::size_t begin;
+            std::size_t end;
+        };
+
+        struct Slot
+        {
+            Value value;
+            std::string error;
+            std::size_t size = 0;
+            bool ready = false;
+        };
+
+        void frame();
+        void decode();
+        void shutdown();
+
+        BufferScanner scanner;
+        const ValueSizePolicy vsz;
+        const unsigned workers;
+
+        std::mutex mtx;
+        std::condition_variable work_cv;        //! frames to decode, or the end of framing
+        std::condition_variable space_cv;       //! a record was consumed
+        std::condition_variable ready_cv;       //! a record was decoded, or the end of framing
+        std::deque<Frame> frames;
+        std::vector<Slot> slots;                //! a ring of max_pending, indexed by seq
+        std::size_t framed = 0;
+        std::size_t delivered = 0;
+        bool framing_done = false;
+        bool stopping = false;
+        std::string framing_error;
+
+        std::vector<std::thread> threads;
+        std::size_t bytes_so_far = 0;
+        std::string last_error;
+    };
+
+}   //end namespace ubjson
+
+#endif // RECORD_READER_HPP
@@ -0,0 +1,170 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+/**
+  * @file scatter_gather_stream.hpp
+  * A StreamType for StreamWriter that gathers output as an iovec list
+  *
+  * @brief zero-copy output sink
+  * @author WhiZTiM
+  *
+  * Small writes (markers, sizes, short strings) are copied into an internal buffer,
+  * while large string and binary payloads are only referenced. The result can be
+  * handed to ::writev() without ever copying the payloads
+  *
+  * @code
+  * Value v;
+  * v["blob"] = Value::BinaryType(64*1024*1024);
+  *
+  * ScatterGatherStream sg;
+  * StreamWriter<ScatterGatherStream> writer(sg);
+  * writer.writeValue(v);
+  *
+  * auto result = sg.writev(fd);   // v must still be alive here
+  * @endcode
+  */
+
+#ifndef SCATTER_GATHER_STREAM_HPP
+#define SCATTER_GATHER_STREAM_HPP
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <sys/uio.h>
+
+namespace ubjson {
+
+    /*!
+     * \brief The ScatterGatherStream class
+     * Collects StreamWriter output as a list of chunks, where payloads of at least
+     * \ref reference_threshold() bytes are referenced rather than copied.
+     *
+     * \warning referenced payloads belong to the Value that was written;
+     * that Value must neither be destroyed nor modified until the iovecs have been consumed
+     */
+    class ScatterGatherStream
+    {
+    public:
+        explicit ScatterGatherStream(std::size_t ref_threshold = 4096)
+            : threshold(ref_threshold) {}
+
+        //! copies \a sz bytes into the internal buffer
+        ScatterGatherStream& write(const char* data, std::size_t sz)
+        {
+            if(sz == 0)
+                return *this;
+            if(chunks.empty() or not chunks.back().owned)
+                chunks.push_back(Chunk{true, buffer.size(), nullptr, 0});
+            buffer.append(data, sz);
+            chunks.back().size += sz;
+            total += sz;
+            return *this;
+        }
+
+        //! records a reference to \a sz bytes at \a data, nothing is copied
+        ScatterGatherStream& write_reference(const char* data, std::size_t sz)
+        {
+            if(sz == 0)
+                return *this;
+            chunks.push_back(Chunk{false, 0, data, sz});
+            total += sz;
+            return *this;
+        }
+
+        //! payloads smaller than this are copied by StreamWriter
+        std::size_t reference_threshold() const { return threshold; }
+
+        //! total number of bytes (copied and referenced) written so far
+        std::size_t size() const { return total; }
+
+        //! bytes actually copied into the internal buffer
+        std::size_t copied() const { return buffer.size(); }
+
+        /*!
+         * \brief returns the gathered output in write order
+         * \note the iovecs are invalidated by the next call to write() or clear()
+         */
+        std::vector<iovec> iovecs() const
+        {
+            std::vector<iovec> rtn;
+            rtn.reserve(chunks.size());
+            for(const auto& c : chunks)
+            {
+                const char* base = c.owned ? buffer.data() + c.offset : c.data;
+                rtn.push_back(iovec{const_cast<char*>(base), c.size});
+            }
+            return rtn;
+        }
+
+        /*!
+         * \brief writes everything to the file descriptor using ::writev()
+         * Partial writes and EINTR are retried, and the list is submitted in batches of IOV_MAX
+         * \return the number of bytes written, and \e false if ::writev() failed
+         */
+        std::pair<std::size_t, bool> writev(int fd) const
+        {
+            auto vecs = iovecs();
+            std::size_t written = 0;
+            std::size_t idx = 0;
+            while(idx < vecs.size())
+            {
+                const int count = static_cast<int>(std::min<std::size_t>(vecs.size() - idx, IOV_MAX));
+                const ssize_t rc = ::writev(fd, &vecs[idx], count);
+                if(rc < 0)
+                {
+                    if(errno == EINTR)
+                        continue;
+                    return std::make_pair(written, false);
+                }
+
+                written += static_cast<std::size_t>(rc);
+                std::size_t left = static_cast<std::size_t>(rc);
+                while(idx < vecs.size() and left >= vecs[idx].iov_len)
+                    left -= vecs[idx++].iov_len;
+                if(left > 0)    //partially written chunk
+                {
+                    vecs[idx].iov_base = static_cast<char*>(vecs[idx].iov_base) + left;
+                    vecs[idx].iov_len -= left;
+                }
+            }
+            return std::make_pair(written, true);
+        }
+
+        void clear()
+        {
+            buffer.clear();
+            chunks.clear();
+            total = 0;
+        }
+
+    private:
+        struct Chunk
+        {
+            bool owned;             //offset into buffer if owned, otherwise data
+            std::size_t offset;
+            const char* data;
+            std::size_t size;
+        };
+
+        std::string buffer;
+        std::vector<Chunk> chunks;
+        std::size_t total = 0;
+        const std::size_t threshold;
+    };
+
+}   //end namespace ubjson
+
+#endif // SCATTER_GATHER_STREAM_HPP
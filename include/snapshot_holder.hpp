@@ -0,0 +1,174 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+/**
+  * @file snapshot_holder.hpp
+  * Contains the SnapshotHolder class, which publishes immutable Values from writers to many reader threads
+  *
+  * @brief read-mostly shared state, without a lock on the read side
+  * @author WhiZTiM
+  *
+  * Reclamation is epoch based: a reader announces the epoch it started in, in a slot of its own, and a
+  * replaced snapshot is deleted once no announced epoch is old enough to have seen it
+  *
+  * @code
+  * SnapshotHolder routes(buildRoutes());
+  *
+  * //each reader thread
+  * SnapshotHolder::Reader reader(routes);              //once per thread; claims a slot
+  * for(;;)
+  * {
+  *     SnapshotHolder::Snapshot table = reader.acquire();
+  *     forward(request, (*table)[request.host()]);
+  * }
+  *
+  * //the writer thread
+  * routes.publish(buildRoutes());
+  * @endcode
+  */
+
+#ifndef SNAPSHOT_HOLDER_HPP
+#define SNAPSHOT_HOLDER_HPP
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include "value.hpp"
+
+namespace ubjson {
+
+    /*!
+     * \brief The SnapshotHolder class
+     * Holds the current version of a Value that is never modified once published.
+     *
+     * - acquire() is wait-free: two loads and a store, whatever the writers are doing
+     * - publish() swaps in a new version, then deletes the replaced versions that no reader can still hold
+     * - a Snapshot stays valid, unchanged, for as long as it is kept, however often versions are published
+     *
+     * Each reader thread needs its own \ref Reader, of which there can be at most \a max_readers at a time.
+     * Publishers are serialized among themselves; they never wait for readers.
+     * \warning every Reader and Snapshot must be gone before the SnapshotHolder is destroyed
+     */
+    class SnapshotHolder
+    {
+    public:
+        class Reader;
+        class Snapshot;
+
+        explicit SnapshotHolder(Value initial = Value(), std::size_t max_readers = 64);
+        ~SnapshotHolder();
+
+        SnapshotHolder(const SnapshotHolder&) = delete;
+        SnapshotHolder& operator = (const SnapshotHolder&) = delete;
+
+        //! makes \a v the current version; readers that acquire from now on see it
+        void publish(Value v);
+
+        //! deletes the replaced versions that no reader can still hold; publish() already does this
+        void reclaim();
+
+        //! the number of replaced versions not deleted yet, because a reader might still hold them
+        std::size_t getRetiredCount() const;
+
+    private:
+        //! an announced epoch, padded to a cache line of its own so readers don't contend
+        struct Slot
+        {
+            std::atomic<uint64_t> epoch{ 0 };       //!< 0 while the reader holds no Snapshot
+            std::atomic<bool> claimed{ false };
+            char padding[64 - sizeof(std::atomic<uint64_t>) - sizeof(std::atomic<bool>)];
+        };
+
+        void reclaim_locked();
+
+        std::atomic<const Value*> current;
+        std::atomic<uint64_t> epoch{ 1 };
+        std::vector<Slot> slots;
+
+        mutable std::mutex writer;
+        std::vector<std::pair<const Value*, uint64_t>> retired;     //!< and the last epoch each was current in
+    };
+
+
+    /*!
+     * \brief The SnapshotHolder::Snapshot class
+     * A version acquired by a Reader; movable, but not copyable
+     */
+    class SnapshotHolder::Snapshot
+    {
+    public:
+        Snapshot(Snapshot&& other) noexcept
+            : reader(other.reader), value(other.value)
+        { other.reader = nullptr; }
+
+        Snapshot& operator = (Snapshot&& other) noexcept
+        {
+            std::swap(reader, other.reader);
+            std::swap(value, other.value);
+            return *this;
+        }
+
+        ~Snapshot();
+
+        const Value& operator * () const noexcept { return *value; }
+        const Value* operator -> () const noexcept { return value; }
+
+    private:
+        friend class Reader;
+        Snapshot(Reader* r, const Value* v) noexcept
+            : reader(r), value(v) {}
+
+        Reader* reader;
+        const Value* value;
+    };
+
+
+    /*!
+     * \brief The SnapshotHolder::Reader class
+     * A reader slot of a SnapshotHolder, to be used by one thread. Snapshots acquired through it may nest,
+     * and must not outlive it
+     * \throws std::length_error on construction when every slot is taken
+     */
+    class SnapshotHolder::Reader
+    {
+    public:
+        explicit Reader(SnapshotHolder& holder);
+        ~Reader();
+
+        Reader(const Reader&) = delete;
+        Reader& operator = (const Reader&) = delete;
+
+        //! the current version, wait-free
+        Snapshot acquire() noexcept;
+
+    private:
+        friend class Snapshot;
+        void release() noexcept;
+
+        SnapshotHolder& holder;
+        Slot* slot;
+        std::size_t depth = 0;      //!< of the Snapshots acquired and not yet released
+    };
+
+    inline SnapshotHolder::Snapshot::~Snapshot()
+    {
+        if(reader)
+            reader->release();
+    }
+
+}   //end namespace ubjson
+
+#endif // SNAPSHOT_HOLDER_HPP
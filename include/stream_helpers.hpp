@@ -1,6 +1,7 @@
 #ifndef CONVERSIONS_HPP
 #define CONVERSIONS_HPP
 
+#include <string>
 #include <cstdint>
 #include <cstring>
 #include <endian.h>
@@ -39,6 +40,140 @@ namespace ubjson {
     inline bool in_range(double value, double min, double max)
     { return (min <= value and value <= max); }
 
+
+    ////////////////////////////////////
+    ///   bit level classification of doubles
+    ///////////////////////////////////////
+
+    inline uint64_t doubleBits(double val)
+    {
+        uint64_t rtn;
+        std::memcpy(&rtn, &val, sizeof(rtn));
+        return rtn;
+    }
+
+    //! unbiased binary exponent of \a bits; -1023 for zeros and subnormals, 1024 for infinities and NaNs
+    inline int doubleExponent(uint64_t bits)
+    { return static_cast<int>((bits >> 52) & 0x7ff) - 1023; }
+
+    inline uint64_t doubleMantissa(uint64_t bits)
+    { return bits & 0x000fffffffffffffull; }
+
+    /*!
+     * \brief whether |val| <= std::numeric_limits<float>::max()
+     * Positive doubles order like their bit patterns, so this is a single integer compare.
+     * NaNs and infinities are out of range
+     */
+    inline bool inFloat32Range(double val)
+    {
+        const uint64_t float32_max = 0x47efffffe0000000ull;     //bits of double(FLT_MAX)
+        return (doubleBits(val) & 0x7fffffffffffffffull) <= float32_max;
+    }
+
+    /*!
+     * \brief whether \a val converts to float and back without losing a single bit.
+     * Infinities are exact; NaNs are reported as inexact because their payload may not survive
+     */
+    inline bool isExactFloat32(double val)
+    {
+        const uint64_t bits = doubleBits(val);
+        const int exponent = doubleExponent(bits);
+        const uint64_t mantissa = doubleMantissa(bits);
+
+        if(-126 <= exponent and exponent <= 127)    //normal floats keep the upper 23 of 52 mantissa bits
+            return (mantissa & 0x1fffffffull) == 0;
+        if(-149 <= exponent and exponent < -126)    //subnormal floats keep fewer
+            return (mantissa & ((uint64_t(1) << (29 - 126 - exponent)) - 1)) == 0;
+        if(exponent == -1023 or exponent == 1024)   //zeros and infinities (double subnormals are far below float's)
+            return mantissa == 0;
+        return false;
+    }
+
+    /*!
+     * \brief whether \a val is an integer within the range of \e long \e long, stored in \a out if so.
+     * \note -0.0 is not reported as integral, because its sign would be lost
+     */
+    inline bool isIntegral(double val, long long& out)
+    {
+        const uint64_t bits = doubleBits(val);
+        const int exponent = doubleExponent(bits);
+        if(bits == 0)
+        {
+            out = 0;
+            return true;
+        }
+        if(exponent < 0 or exponent > 62)
+            return false;
+        if(exponent < 52 and (doubleMantissa(bits) & ((uint64_t(1) << (52 - exponent)) - 1)) != 0)
+            return false;
+        out = static_cast<long long>(val);
+        return true;
+    }
+
+
+    /*!
+     * \brief The IntegerEncoding struct
+     * The marker and payload width (in bytes) of an encoded integer
+     */
+    struct IntegerEncoding
+    {
+        Marker marker;
+        byte width;
+    };
+
+    /*!
+     * \brief Lookup table for the smallest integer encoding
+     * indexed by [significant bits of the magnitude][non-negative]
+     *
+     * The magnitude of a signed value \a v is \code v ^ (v >> 63) \endcode, so its
+     * sign bit must also fit; Uint8 takes over for non-negative values of exactly 8 bits (128 - 255)
+     */
+    struct IntegerEncodingTable
+    {
+        IntegerEncoding entry[65][2];
+
+        constexpr IntegerEncodingTable() : entry{}
+        {
+            for(unsigned bits = 0; bits <= 64; ++bits)
+            {
+                const IntegerEncoding e =
+                        bits < 8  ? IntegerEncoding{Marker::Int8, 1}  :
+                        bits < 16 ? IntegerEncoding{Marker::Int16, 2} :
+                        bits < 32 ? IntegerEncoding{Marker::Int32, 4} :
+                                    IntegerEncoding{Marker::Int64, 8};
+                entry[bits][0] = e;
+                entry[bits][1] = (bits == 8) ? IntegerEncoding{Marker::Uint8, 1} : e;
+            }
+        }
+    };
+
+    constexpr IntegerEncodingTable integerEncodingTable{};
+
+    //! number of significant bits in \a v; 0 and 1 both report 1
+    inline unsigned significantBits(std::uint64_t v)
+    { return 64 - __builtin_clzll(v | 1); }
+
+    //! the smallest UBJSON integer encoding that can hold \a val
+    inline IntegerEncoding smallestIntegerEncoding(long long val)
+    {
+        const std::uint64_t magnitude = static_cast<std::uint64_t>(val ^ (val >> 63));
+        return integerEncodingTable.entry[significantBits(magnitude)][val >= 0];
+    }
+
+    /*!
+     * \brief the smallest UBJSON integer encoding that can hold \a val
+     * \return Marker::HighPrecision with a zero width if \a val is beyond the range of Int64
+     * \note values up to 255 always map to Uint8, so that unsigned-ness survives a round trip
+     */
+    inline IntegerEncoding smallestIntegerEncoding(unsigned long long val)
+    {
+        if(val > static_cast<unsigned long long>(std::numeric_limits<long long>::max()))
+            return IntegerEncoding{Marker::HighPrecision, 0};
+        if(val <= std::numeric_limits<std::uint8_t>::max())
+            return IntegerEncoding{Marker::Uint8, 1};
+        return smallestIntegerEncoding(static_cast<long long>(val));
+    }
+
 	inline
     uint16_t toBigEndian16(uint16_t val)
     {  return htobe16(val); }
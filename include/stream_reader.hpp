@@ -16,9 +16,11 @@
 
 #include "stream_helpers.hpp"
 #include "value.hpp"
+#include "utf8.hpp"
 #include <fstream>
 #include <cstring>
 #include <tuple>
+#include <algorithm>
 #include <iostream>
 
 namespace ubjson {
@@ -26,7 +28,10 @@ namespace ubjson {
     enum class MarkerType { Object, Array };
 
     constexpr ValueSizePolicy defaultStreamReaderPolicy()
-    { return {32, 1024*1024*64, 1024*1024*8, 1024*1024*65, 1024, 1024}; }
+    { return {32, 1024*1024*64, 1024*1024*8, 1024*1024*65, 1024, 1024, false}; }
+
+    static_assert(defaultStreamReaderPolicy().max_binary_size <= defaultStreamReaderPolicy().max_object_size,
+                  "a binary the reader accepts must fit in a document it accepts");
 
     template<typename StreamType>
     class StreamReader
@@ -64,11 +69,13 @@ namespace ubjson {
         std::pair<int16_t, bool> extract_Int16();
         std::pair<int32_t, bool> extract_Int32();
         std::pair<int64_t, bool> extract_Int64();
-        std::pair<long long, bool> extract_Integer(bool read_uint8 = true);
+        std::pair<long long, bool> extract_Integer();
         std::pair<float, bool> extract_Float32();
         std::pair<double, bool> extract_Float64();
         std::pair<std::string, bool> extract_String();
+        bool extract_StringTo(std::string& str);
         std::pair<Value::BinaryType, bool> extract_Binary();
+        void extract_HighPrecision(Value& value);
 
         void extract_Object(Value& v);
         void extract_Array(Value& v);
@@ -239,7 +246,7 @@ namespace ubjson {
             Value value;
             switch (type) {
             case MarkerType::Object:
-                km.key = extract_String().first;  //extract key
+                extract_StringTo(km.key);  //extract key, reusing the buffer of the previous one
                 break;
             case MarkerType::Array:
             default:
@@ -247,7 +254,7 @@ namespace ubjson {
             }
 
             if(header.marker != Marker::Invalid and header.is_valid)
-                marker = km.marker;
+                marker = static_cast<byte>(header.marker);
             else
                 marker = readNextByte();
 
@@ -257,7 +264,7 @@ namespace ubjson {
 
             switch (type) {
             case MarkerType::Object:
-                vref[km.key] = std::move(value);
+                vref.set_member(km.key, std::move(value));
                 break;
             case MarkerType::Array:
                 vref.push_back( std::move(value) );
@@ -338,7 +345,11 @@ namespace ubjson {
         }
         else if(isBinary(marker))
         {
-            value = extract_Binary().first;
+            value = std::move(extract_Binary().first);
+        }
+        else if(isHighPrecision(marker))
+        {
+            extract_HighPrecision(value);
         }
     }
 
@@ -354,7 +365,9 @@ namespace ubjson {
     template<typename StreamType>
     std::pair<std::size_t, bool> StreamReader<StreamType>::extract_itemCount()
     {
-        auto rtn = extract_Integer(false);  //extract without considering Uint8 type
+        auto rtn = extract_Integer();
+        if(rtn.second and rtn.first < 0)
+            throw parsing_exception("Negative count token encountered!");
         return std::make_pair(static_cast<size_t>(rtn.first), rtn.second);
     }
 
@@ -424,11 +437,11 @@ namespace ubjson {
     }
 
     template<typename StreamType>
-    std::pair<long long, bool> StreamReader<StreamType>::extract_Integer(bool read_uint8)
+    std::pair<long long, bool> StreamReader<StreamType>::extract_Integer()
     {
         byte b = readNextByte();
 
-        if(isUint8(b) and read_uint8)
+        if(isUint8(b))
         {
             auto rtn = extract_Uint8();
             return std::make_pair(rtn.first, rtn.second);
@@ -490,15 +503,43 @@ namespace ubjson {
     template<typename StreamType>
     std::pair<std::string, bool> StreamReader<StreamType>::extract_String()
     {
+        std::string rtn;
+        const bool good = extract_StringTo(rtn);
+        return std::make_pair(std::move(rtn), good);
+    }
+
+    //! reads a string into \a rtn, reusing its capacity
+    template<typename StreamType>
+    bool StreamReader<StreamType>::extract_StringTo(std::string& rtn)
+    {
+        rtn.clear();
         auto icount = extract_itemCount();
         if(not icount.second)
-            return std::make_pair(std::string(), false);
-
-        std::unique_ptr<byte[]> b(new byte[icount.first]);
-        read(b.get(), icount.first);
-
-        std::string rtn(to_cbyte(b.get()), to_cbyte(b.get()) + icount.first);
-        return std::make_pair(rtn, true);
+            return false;
+        if(icount.first > vsz.max_string_size)
+            throw policy_violation("Maximum String size exceeded at: " + std::to_string(bytes_so_far));
+
+        //a chunk at a time, so that with validate_utf8, each chunk is checked while it is still in cache
+        byte chunk[4096];
+        const std::size_t first = std::min(icount.first, sizeof(chunk));   //the count isn't trusted until the bytes are read
+        if(rtn.capacity() < first)
+            rtn.reserve(first);      //a smaller request may shrink it
+        std::size_t checked = 0;
+        for(std::size_t left = icount.first; left > 0; )
+        {
+            const std::size_t sz = std::min(left, sizeof(chunk));
+            read(chunk, sz);
+            rtn.append(to_cbyte(chunk), sz);
+            left -= sz;
+            if(not vsz.validate_utf8)
+                continue;
+
+            //a sequence split by the end of the chunk is checked with the next one
+            checked += validateUtf8(rtn.data() + checked, rtn.size() - checked);
+            if(rtn.size() - checked > 3 or (left == 0 and checked != rtn.size()))
+                throw parsing_exception("Invalid UTF-8 encountered!");
+        }
+        return true;
     }
 
     template<typename StreamType>
@@ -507,12 +548,61 @@ namespace ubjson {
         auto icount = extract_itemCount();
         if(not icount.second)
             throw parsing_exception("Invalid count token encounted!");
+        if(icount.first > vsz.max_binary_size)
+            throw policy_violation("Maximum Binary size exceeded at: " + std::to_string(bytes_so_far));
+
+        //read straight into the result, in chunks that grow with it: the count isn't trusted until the bytes are
+        //read, so nothing much larger than what was read so far is allocated
+        Value::BinaryType rtn;
+        for(std::size_t left = icount.first; left > 0; )
+        {
+            const std::size_t filled = rtn.size();
+            const std::size_t sz = std::min(left, std::max<std::size_t>(filled, 4096));
+            rtn.resize(filled + sz);
+            read(rtn.data() + filled, sz);
+            left -= sz;
+        }
+        return std::make_pair(std::move(rtn), true);
+    }
+
+    /*!
+     * \brief reads a high precision number straight into a HighPrecisionType, a chunk at a time.
+     * Plain integers that fit into an \e unsigned \e long \e long (as written by StreamWriter for
+     * values beyond Int64) become Type::UnsignedInt, every other number becomes Type::HighPrecision
+     */
+    template<typename StreamType>
+    void StreamReader<StreamType>::extract_HighPrecision(Value& value)
+    {
+        auto icount = extract_itemCount();
+        if(not icount.second or icount.first == 0)
+            throw parsing_exception("Invalid high precision number encountered!");
+        if(icount.first > vsz.max_string_size)
+            throw policy_violation("Maximum String size exceeded at: " + std::to_string(bytes_so_far));
 
-        std::unique_ptr<byte[]> b(new byte[icount.first]);
-        read(b.get(), icount.first);
+        Value::HighPrecisionType number;
+        number.reserve(icount.first);
 
-        Value::BinaryType rtn(to_cbyte(b.get()), to_cbyte(b.get()) + icount.first);
-        return std::make_pair(rtn, true);
+        byte chunk[64];
+        for(std::size_t left = icount.first; left > 0; )
+        {
+            const std::size_t sz = std::min(left, sizeof(chunk));
+            read(chunk, sz);
+            try { number.append(to_cbyte(chunk), sz); }
+            catch(bad_value_cast&) { throw; }
+            catch(value_exception&)
+            {
+                throw parsing_exception("Invalid high precision number encountered!");
+            }
+            left -= sz;
+        }
+        if(not number.isValid())
+            throw parsing_exception("Invalid high precision number encountered!");
+
+        unsigned long long integral;
+        if(number.toUint64(integral))
+            value = integral;
+        else
+            value = std::move(number);
     }
 
     /*!
@@ -530,13 +620,9 @@ namespace ubjson {
                 {
                     if(isOptimized_Count(b))
                     {
-                        b = peekNextByte();
-                        if(isSignedNumber(b))   //Directly objects
-                        {
-                            auto sz = extract_Integer(false);  //extract size...
-                            header.item_count = sz.first;
-                            header.is_valid = sz.second;
-                        }
+                        auto sz = extract_itemCount();  //extract size...
+                        header.item_count = sz.first;
+                        header.is_valid = sz.second;
                     }
                 };
 
@@ -548,7 +634,10 @@ namespace ubjson {
         else if(isOptimized_Type(b))    //If is type
         {
             header.marker = static_cast<Marker>(readNextByte());  //extract the type
+            b = readNextByte();
             get_optimized_count();              //extract count..
+            if(not header.is_valid)
+                throw parsing_exception("A typed container must be followed by a count!");
         }
 
         return header;
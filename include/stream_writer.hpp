@@ -16,17 +16,58 @@
 
 #include <fstream>
 #include <algorithm>
+#include <type_traits>
 #include "value.hpp"
 #include "stream_helpers.hpp"
 
 namespace ubjson {
 
+    /*!
+     * Detects a StreamType that can reference payloads instead of copying them,
+     * i.e. one that has \e write_reference(const char*, size_t) and \e reference_threshold()
+     * \see ScatterGatherStream
+     */
+    template<typename T, typename = void>
+    struct has_write_reference : std::false_type {};
+
+    template<typename T>
+    struct has_write_reference<T, decltype(std::declval<T&>().write_reference(nullptr, std::size_t()),
+                                           void(std::declval<T&>().reference_threshold()))>
+        : std::true_type {};
+
+    //! How StreamWriter encodes floating point (Type::Float) values
+    enum class FloatEncoding : char
+    {
+        //! Float32 for every value within the range of float; precision may be lost (e.g 0.1)
+        narrowing,
+
+        //! Float32 only if the value survives the round trip bit-for-bit, otherwise Float64
+        lossless,
+
+        //! like \a lossless, but integral values are written with an integer marker when that is shorter.
+        //! \note such values are read back as integers
+        lossless_integral
+    };
+
+    /*!
+     * \brief The StreamWriterPolicy struct
+     * This is a POD struct that dictates how StreamWriter encodes values
+     * \see defaultStreamWriterPolicy()
+     */
+    struct StreamWriterPolicy   //NOTE: Please never reorder the members, because, brace initializer{}
+    {
+        FloatEncoding float_encoding;
+    };
+
+    constexpr StreamWriterPolicy defaultStreamWriterPolicy()
+    { return { FloatEncoding::narrowing }; }
+
 
     template<typename StreamType>
     class StreamWriter
     {
     public:
-        StreamWriter(StreamType& Stream);
+        StreamWriter(StreamType& Stream, StreamWriterPolicy policy = defaultStreamWriterPolicy());
 
         std::pair<std::size_t, bool> writeValue(const Value&);
         StreamType& getStream() { return stream; }
@@ -41,12 +82,17 @@ namespace ubjson {
         std::pair<size_t, bool> append_char(char);
         std::pair<size_t, bool> append_bool(bool);
         std::pair<size_t, bool> append_float(double);
+        std::pair<size_t, bool> append_float32(float);
+        std::pair<size_t, bool> append_float64(double);
         std::pair<size_t, bool> append_signedInt(long long);
         std::pair<size_t, bool> append_unsignedInt(unsigned long long);
+        std::pair<size_t, bool> append_integer(IntegerEncoding, uint64_t);
+        std::pair<size_t, bool> append_bigUnsignedInt(unsigned long long);
         std::pair<size_t, bool> append_size(std::size_t);
 
         std::pair<size_t, bool> append_string(const std::string&);
         std::pair<size_t, bool> append_binary(const Value::BinaryType&);
+        std::pair<size_t, bool> append_highPrecision(const Value::HighPrecisionType&);
         std::pair<size_t, bool> append_array(const Value&);
 
         void update(const std::pair<size_t, bool>&, std::pair<size_t, bool>&);
@@ -54,14 +100,23 @@ namespace ubjson {
         bool write(Marker);
         bool write(byte);
         bool write(const byte *, std::size_t);
+        bool write_payload(const byte *, std::size_t);
+
+        //SFINAE zone :-)
+        template<typename U = StreamType>
+        std::enable_if_t<has_write_reference<U>::value, bool> write_to_stream(const byte*, std::size_t);
+
+        template<typename U = StreamType>
+        std::enable_if_t<not has_write_reference<U>::value, bool> write_to_stream(const byte*, std::size_t);
 
         StreamType& stream;
+        const StreamWriterPolicy policy;
     };
 
 
     template<typename StreamType>
-    StreamWriter<StreamType>::StreamWriter(StreamType& Stream)
-        : stream(Stream) {}
+    StreamWriter<StreamType>::StreamWriter(StreamType& Stream, StreamWriterPolicy Policy)
+        : stream(Stream), policy(Policy) {}
 
     template<typename StreamType>
     std::pair<size_t, bool> StreamWriter<StreamType>::writeValue(const Value& value)
@@ -72,17 +127,16 @@ namespace ubjson {
     template<typename StreamType>
     std::pair<size_t, bool> StreamWriter<StreamType>::append_object(const Value& value)
     {
-        auto keys = value.keys();
         std::pair<size_t, bool> rtn(1, false);
         write(Marker::Object_Start);
-        //update(append_size(keys.size()), rtn);
+        //update(append_size(value.size()), rtn);
 
-        for(const auto& key : keys)
+        for(auto member : value.items())
         {
             decltype(rtn) k(0, false);
-            k = append_key(key);
+            k = append_key(member.key);
             update(k, rtn);
-            k = append_value(value[key]);
+            k = append_value(member.value);
             update(k, rtn);
         }
         write(Marker::Object_End);
@@ -108,8 +162,10 @@ namespace ubjson {
             k = append_float(v);
         else if(v.isString())
             k = append_string(v);
-        //else if(v.isBinary())
-        //    k = append_binary(v); //currently not supported
+        else if(v.isBinary())
+            k = append_binary(v);
+        else if(v.isHighPrecision())
+            k = append_highPrecision(v);
         else if(v.isArray())
             k = append_array(v);
         else if(v.isObject())
@@ -136,6 +192,30 @@ namespace ubjson {
         return true;
     }
 
+    //! writes string and binary payloads; they are referenced rather than copied if the stream supports it
+    template<typename StreamType>
+    bool StreamWriter<StreamType>::write_payload(const byte* b, std::size_t sz)
+    {
+        return write_to_stream<StreamType>(b, sz);
+    }
+
+    template<typename StreamType>
+    template<typename U> std::enable_if_t<has_write_reference<U>::value, bool>
+    StreamWriter<StreamType>::write_to_stream(const byte* b, std::size_t sz)
+    {
+        if(sz < stream.reference_threshold())
+            return write(b, sz);
+        stream.write_reference(reinterpret_cast<const char*>(b), sz);
+        return true;
+    }
+
+    template<typename StreamType>
+    template<typename U> std::enable_if_t<not has_write_reference<U>::value, bool>
+    StreamWriter<StreamType>::write_to_stream(const byte* b, std::size_t sz)
+    {
+        return write(b, sz);
+    }
+
     template<typename StreamType>
     inline void StreamWriter<StreamType>::update(const std::pair<size_t, bool>& src, std::pair<size_t, bool>& dest)
     {
@@ -183,12 +263,26 @@ namespace ubjson {
     {
         write(Marker::Binary);
         auto rtn = append_size(bin.size());
-        write(bin.data(), bin.size());
+        write_payload(bin.data(), bin.size());
         rtn.first += bin.size() + 1;
         return rtn;
     }
 
 
+    template<typename StreamType>
+    std::pair<size_t, bool> StreamWriter<StreamType>::append_highPrecision(const Value::HighPrecisionType& number)
+    {
+        const std::size_t size = number.size();
+        write(Marker::HighPrecision);
+        auto rtn = append_size(size);
+
+        char chunk[64];     //unpacked a chunk at a time; no intermediate std::string
+        for(std::size_t pos = 0; pos < size; pos += sizeof(chunk))
+            write(reinterpret_cast<const byte*>(chunk), number.copy(chunk, sizeof(chunk), pos));
+        rtn.first += size + 1;
+        return rtn;
+    }
+
     template<typename StreamType>
     std::pair<size_t, bool> StreamWriter<StreamType>::append_string(const std::string& str)
     {
@@ -196,7 +290,7 @@ namespace ubjson {
         write(Marker::String);
         auto rtn = append_size(size);
         if(size != 0)           //Empty strings are permitted
-            write(reinterpret_cast<const byte*>(str.data()), size);
+            write_payload(reinterpret_cast<const byte*>(str.data()), size);
         rtn.first += size + 1;
         return rtn;
     }
@@ -210,94 +304,97 @@ namespace ubjson {
     template<typename StreamType>
     std::pair<size_t, bool> StreamWriter<StreamType>::append_unsignedInt(unsigned long long val)
     {
-        using Uint8 = std::numeric_limits<uint8_t>;
-        std::pair<size_t, bool> rtn(0, false);
-        if(in_range(val, Uint8::lowest(), Uint8::max()))
-        {
-            write(Marker::Uint8);
-            write(static_cast<byte>(val));
-            rtn = std::make_pair(2, true);
-        }
-        return rtn;
+        const IntegerEncoding enc = smallestIntegerEncoding(val);
+        if(enc.marker == Marker::HighPrecision)     //beyond Int64, UBJSON requires a high precision number
+            return append_bigUnsignedInt(val);
+        return append_integer(enc, static_cast<uint64_t>(val));
     }
 
     template<typename StreamType>
     std::pair<size_t, bool> StreamWriter<StreamType>::append_signedInt(long long val)
     {
-        using Int8 = std::numeric_limits<int8_t>;
-        using Int16 = std::numeric_limits<int16_t>;
-        using Int32 = std::numeric_limits<int32_t>;
-        using Int64 = std::numeric_limits<int64_t>;
-
-        byte b[8];
-        std::pair<size_t, bool> rtn(0, false);
-        if(in_range(val, Int8::lowest(), Int8::max()))
-        {
-            write(Marker::Int8);
-            write(static_cast<byte>(val));
-            rtn = std::make_pair(2, true);
-        }
-        else if(in_range(val, Int16::lowest(), Int16::max()))
-        {
-            const uint16_t tit = static_cast<uint16_t>(val);
-            const uint16_t val = toBigEndian16(tit);
-            std::memcpy(b, &val, 2);
-            write(Marker::Int16);
-            write(b, 2);
-            rtn = std::make_pair(3, true);
-        }
-        else if(in_range(val, Int32::lowest(), Int32::max()))
-        {
-            const uint32_t tit = static_cast<uint32_t>(val);
-            const uint32_t val = toBigEndian32(tit);
-            std::memcpy(b, &val, 4);
-            write(Marker::Int32);
-            write(b, 4);
-            rtn = std::make_pair(5, true);
-        }
-        else if(in_range(val, Int64::lowest(), Int64::max()))
-        {
-            const uint64_t tit = static_cast<uint64_t>(val);
-            const uint64_t val = toBigEndian64(tit);
-            std::memcpy(b, &val, 8);
-            write(Marker::Int64);
-            write(b, 8);
-            rtn = std::make_pair(9, true);
-        }
+        return append_integer(smallestIntegerEncoding(val), static_cast<uint64_t>(val));
+    }
 
+    /*!
+     * writes the marker and the lowest \a enc.width bytes of \a bits (big endian) in a single write
+     */
+    template<typename StreamType>
+    std::pair<size_t, bool> StreamWriter<StreamType>::append_integer(IntegerEncoding enc, uint64_t bits)
+    {
+        byte b[9];
+        const uint64_t be = toBigEndian64(bits << (64 - 8 * enc.width));
+        b[0] = static_cast<byte>(enc.marker);
+        std::memcpy(b + 1, &be, enc.width);
+        write(b, enc.width + 1u);
+        return std::make_pair(enc.width + 1u, true);
+    }
+
+    template<typename StreamType>
+    std::pair<size_t, bool> StreamWriter<StreamType>::append_bigUnsignedInt(unsigned long long val)
+    {
+        byte digits[20];
+        std::size_t idx = sizeof(digits);
+        do {
+            digits[--idx] = static_cast<byte>('0' + val % 10);
+            val /= 10;
+        } while(val != 0);
+
+        const std::size_t size = sizeof(digits) - idx;
+        write(Marker::HighPrecision);
+        auto rtn = append_size(size);
+        write(digits + idx, size);
+        rtn.first += size + 1;
         return rtn;
     }
 
     template<typename StreamType>
     std::pair<size_t, bool> StreamWriter<StreamType>::append_float(double val)
     {
-        using Float32 = std::numeric_limits<float>;
-        using Float64 = std::numeric_limits<double>;
-
-        byte b[8];
-        std::pair<size_t, bool> rtn(0, false);
-        if(in_range(val, Float32::lowest(), Float32::max()))
+        switch (policy.float_encoding) {
+        case FloatEncoding::narrowing:
+            if(inFloat32Range(val))
+                return append_float32(static_cast<float>(val));
+            break;
+        case FloatEncoding::lossless_integral:
         {
-            // g++ 4.9.1 doesn't work well here
-            //const uint32_t val = toBigEndianFloat32(static_cast<float>(val));
-
-            float temp = static_cast<float>(val);           //Walkaround
-            const uint32_t val = toBigEndianFloat32(temp);  //Walkaround
-            std::memcpy(b, &val, 4);
-            write(Marker::Float32);
-            write(b, 4);
-            rtn = std::make_pair(5, true);
+            long long integral;
+            if(isIntegral(val, integral))
+            {
+                const std::size_t float_size = isExactFloat32(val) ? 5 : 9;
+                if(smallestIntegerEncoding(integral).width + 1u < float_size)
+                    return append_signedInt(integral);
+            }
         }
-        else if(in_range(val, Float64::lowest(), Float64::max()))
-        {
-            const uint64_t temp = toBigEndianFloat64(val);
-            std::memcpy(b, &temp, 8);
-            write(Marker::Float64);
-            write(b, 8);
-            rtn = std::make_pair(9, true);
+        //fall through
+        case FloatEncoding::lossless:
+            if(isExactFloat32(val))
+                return append_float32(static_cast<float>(val));
+            break;
         }
+        return append_float64(val);
+    }
 
-        return rtn;
+    template<typename StreamType>
+    std::pair<size_t, bool> StreamWriter<StreamType>::append_float32(float val)
+    {
+        byte b[5];
+        const uint32_t be = toBigEndianFloat32(val);
+        b[0] = static_cast<byte>(Marker::Float32);
+        std::memcpy(b + 1, &be, 4);
+        write(b, 5);
+        return std::make_pair(5, true);
+    }
+
+    template<typename StreamType>
+    std::pair<size_t, bool> StreamWriter<StreamType>::append_float64(double val)
+    {
+        byte b[9];
+        const uint64_t be = toBigEndianFloat64(val);
+        b[0] = static_cast<byte>(Marker::Float64);
+        std::memcpy(b + 1, &be, 8);
+        write(b, 9);
+        return std::make_pair(9, true);
     }
 
     template<typename StreamType>
@@ -0,0 +1,187 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+/**
+  * @file transcoder.hpp
+  * Contains the UbjsonToJson and JsonToUbjson classes, which convert between UBJSON and JSON text as they read
+  *
+  * @brief streaming conversion between UBJSON and JSON, without building a Value
+  * @author WhiZTiM
+  *
+  * The input is read a chunk at a time into a window, and each value is converted as soon as it is read;
+  * the output is buffered, and written a chunk at a time. Memory use depends on the longest string
+  * or key, never on the size of a document or of the input
+  *
+  * @code
+  * std::ifstream in("dump.ubj", std::ios::binary);
+  * std::ofstream out("dump.jsonl");
+  * UbjsonToJson(in, out).transcodeAll();        //one line of JSON per document
+  *
+  * std::ifstream events("events.jsonl");
+  * std::ofstream ubj("events.ubj", std::ios::binary);
+  * JsonToUbjson(events, ubj).transcodeAll();
+  * @endcode
+  */
+
+#ifndef TRANSCODER_HPP
+#define TRANSCODER_HPP
+
+#include <string>
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include "value.hpp"
+#include "json_writer.hpp"
+#include "stream_reader.hpp"
+#include "stream_writer.hpp"
+
+namespace ubjson {
+
+    /*!
+     * \brief The StreamTranscoder class
+     * The input side both transcoders share: a window over the input stream, refilled a chunk at a time.
+     * Malformed input throws \ref parsing_exception, after which the transcoder can't be used again.
+     * Like StreamReader, the depth, the size of each document (as max_object_size) and of strings,
+     * keys and binaries, and with \a policy.validate_utf8 the UTF-8 of strings and keys, are checked against the policy
+     */
+    class StreamTranscoder
+    {
+    public:
+        //! the number of bytes read from the input so far
+        std::size_t getBytesRead() const noexcept { return window_offset + end; }
+
+    protected:
+        StreamTranscoder(std::istream& in, ValueSizePolicy policy)
+            : input(in), vsz(policy) {}
+
+        //! makes at least \a n bytes available from \a pos, unless the input ends first.
+        //! The last \a lookahead of them may lie past the document, so they don't count towards its size
+        bool fill(std::size_t n, std::size_t lookahead = 0);
+
+        //! makes \a n bytes available from \a pos; throws if the input ends first
+        void require(std::size_t n)
+        {
+            if(end - pos < n and not fill(n))
+                throw parsing_exception("Unexpected end of stream!");
+        }
+
+        //! the next document starts at \a pos
+        void begin_document() noexcept { document_start = window_offset + pos; }
+
+        //! the document ends at \a pos; throws if it was larger than the policy allows
+        void end_document() const;
+
+        const char* at() const noexcept { return window.data() + pos; }
+
+        //! the size of each read, and of each write of buffered output
+        static constexpr std::size_t chunk_size = 64 * 1024;
+
+        std::istream& input;
+        const ValueSizePolicy vsz;
+        std::string window;
+        std::size_t pos = 0;                //!< the next byte to read, in \a window
+        std::size_t end = 0;                //!< the end of the bytes read into \a window
+        std::size_t window_offset = 0;      //!< where \a window starts in the input
+        std::size_t document_start = 0;
+    };
+
+
+    /*!
+     * \brief The UbjsonToJson class
+     * Converts concatenated UBJSON documents to JSON text, one line per document, in the layout of \ref JsonWriter.
+     * Members of objects keep their order, typed arrays are converted straight out of the input window,
+     * and empty containers stay empty objects and arrays
+     */
+    class UbjsonToJson : public StreamTranscoder
+    {
+    public:
+        UbjsonToJson(std::istream& in, std::ostream& out, JsonWriter::Opt option = JsonWriter::compact,
+                     ValueSizePolicy policy = defaultStreamReaderPolicy())
+            : StreamTranscoder(in, policy), output(out), json(option) {}
+
+        //! converts the next document \return false if the input has ended
+        bool transcodeNext();
+
+        //! converts every document left, then flushes \return how many there were
+        std::size_t transcodeAll();
+
+        //! writes out what is still buffered
+        void flush();
+
+    private:
+        byte next_byte();
+        long long read_integer(byte marker);
+        std::size_t read_count();
+        std::size_t read_count(byte marker);
+        void convert_value(byte marker, std::size_t depth);
+        void convert_container(bool is_object, std::size_t depth);
+        void convert_typed_array(byte marker, std::size_t count);
+        void convert_string(std::size_t size, bool is_key);
+        void convert_binary();
+        void convert_high_precision();
+        void spill();
+
+        std::ostream& output;
+        JsonWriter json;
+    };
+
+
+    /*!
+     * \brief The JsonToUbjson class
+     * Converts JSON values separated by whitespace (e.g. JSON Lines) to concatenated UBJSON documents.
+     * Values are encoded as StreamWriter encodes the Value that JsonReader would give for them,
+     * except that members of objects keep their order, and empty containers stay empty
+     */
+    class JsonToUbjson : public StreamTranscoder
+    {
+    public:
+        JsonToUbjson(std::istream& in, std::ostream& out, StreamWriterPolicy wpolicy = defaultStreamWriterPolicy(),
+                     ValueSizePolicy policy = defaultStreamReaderPolicy())
+            : StreamTranscoder(in, policy), output(out), writer(sink, wpolicy) {}
+
+        //! converts the next value \return false if the input has ended
+        bool transcodeNext();
+
+        //! converts every value left, then flushes \return how many there were
+        std::size_t transcodeAll();
+
+        //! writes out what is still buffered
+        void flush();
+
+    private:
+        //! the output buffer StreamWriter writes scalars into
+        struct Sink
+        {
+            std::string bytes;
+            void write(const char* data, std::size_t size) { bytes.append(data, size); }
+        };
+
+        int peek_token();
+        void convert_value(std::size_t depth);
+        void convert_object(std::size_t depth);
+        void convert_array(std::size_t depth);
+        void read_string(std::string& out);
+        void convert_number();
+        void convert_literal();
+        void write_sized(const std::string& bytes);
+        void spill();
+
+        std::ostream& output;
+        Sink sink;
+        StreamWriter<Sink> writer;
+        std::string text;       //!< reused by every string and key
+    };
+
+}   //end namespace ubjson
+
+#endif // TRANSCODER_HPP
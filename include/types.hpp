@@ -33,7 +33,7 @@ namespace ubjson {
      * \enum Type
      * \brief The Type enum
      */
-    enum class Type
+    enum class Type : byte
     {
         Null,
         Char,
@@ -44,7 +44,8 @@ namespace ubjson {
         Map,
         Array,
         Binary,
-        String
+        String,
+        HighPrecision
     };
 
     enum class Marker : byte
@@ -101,10 +102,16 @@ namespace ubjson {
 
 
     constexpr bool isSignedNumber(byte b)
-    { return isInt16(b) || isInt32(b) || isInt64(b);  }
+    { return isInt8(b) || isInt16(b) || isInt32(b) || isInt64(b);  }
+
+    constexpr bool isUnsignedNumber(byte b)
+    { return isUint8(b);  }
+
+    constexpr bool isInteger(byte b)
+    { return isSignedNumber(b) || isUnsignedNumber(b);  }
 
     constexpr bool isNumber(byte b)
-    { return isSignedNumber(b);  }
+    { return isInteger(b) || isFloat32(b) || isFloat64(b) || isHighPrecision(b);  }
 
     constexpr bool isNone(byte b)
     { return isNull(b); }
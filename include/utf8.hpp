@@ -0,0 +1,41 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+/**
+  * @file utf8.hpp
+  * Contains validateUtf8()
+  *
+  * @brief UTF-8 validation of strings and keys
+  * @author WhiZTiM
+  *
+  * On x86, blocks of 32 or 16 bytes are checked with AVX2 or SSSE3 when the CPU has them,
+  * picked once at run time; elsewhere, and for the last few bytes, a scalar check is used
+  */
+
+#ifndef UTF8_HPP
+#define UTF8_HPP
+
+#include <cstddef>
+
+namespace ubjson {
+
+    /*!
+     * \brief finds the first byte of \a text that isn't part of a well formed UTF-8 sequence.
+     * Overlong forms, surrogates and code points beyond U+10FFFF are rejected
+     * \return the offset of that byte, or \a size if \a text is valid
+     */
+    std::size_t validateUtf8(const char* text, std::size_t size) noexcept;
+
+}   //end namespace ubjson
+
+#endif // UTF8_HPP
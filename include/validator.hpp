@@ -0,0 +1,82 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+/**
+  * @file validator.hpp
+  * Contains validate(), a check that encoded UBJSON is well formed, without decoding it
+  *
+  * @brief non-allocating validation of in-memory UBJSON
+  * @author WhiZTiM
+  *
+  * validate() walks the bytes once and never builds a Value nor allocates;
+  * on failure, it reports what is wrong and the offset of the first offending byte
+  *
+  * @code
+  * auto result = validate(blob.data(), blob.size(), defaultStreamReaderPolicy(), true);
+  * if(not result)
+  *     cerr << result.error << " at byte " << result.error_offset << endl;
+  * @endcode
+  */
+
+#ifndef VALIDATOR_HPP
+#define VALIDATOR_HPP
+
+#include <cstddef>
+#include "types.hpp"
+#include "value.hpp"
+#include "stream_reader.hpp"
+#include "utf8.hpp"
+
+namespace ubjson {
+
+    /*!
+     * \brief The ValidationResult struct
+     * What validate() found; it converts to \c true when the buffer is valid
+     */
+    struct ValidationResult
+    {
+        bool valid;
+
+        //! the offset of the first offending byte; the size of the buffer when valid
+        std::size_t error_offset;
+
+        //! a static description of the error; \c nullptr when valid
+        const char* error;
+
+        //! the number of complete, valid documents before the error
+        std::size_t documents;
+
+        explicit operator bool () const noexcept { return valid; }
+    };
+
+    /*!
+     * \brief checks that \a data holds one or more complete, concatenated UBJSON documents
+     *
+     * Each document is checked for legal markers, lengths and counts that fit in the buffer, and against
+     * every limit of \a policy: the nesting depth, the size of each document, of strings, keys and binaries,
+     * and the number of items of each container.
+     * \note the readers check every other limit as validate() does, but max_array_items and max_object_items
+     * differently: StreamReader never checks them, and the in-memory readers only for typed containers of
+     * payload-less items, the one count the size of the buffer doesn't bound. validate() checks them for every
+     * container, so it may reject a document that those readers accept
+     * \param check_utf8 also check that strings and keys are valid UTF-8, as \a policy.validate_utf8 does
+     */
+    ValidationResult validate(const byte* data, std::size_t size, const ValueSizePolicy& policy = defaultStreamReaderPolicy(),
+                              bool check_utf8 = false) noexcept;
+
+    ValidationResult validate(const char* data, std::size_t size, const ValueSizePolicy& policy = defaultStreamReaderPolicy(),
+                              bool check_utf8 = false) noexcept;
+
+}   //end namespace ubjson
+
+#endif // VALIDATOR_HPP
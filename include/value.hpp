@@ -43,16 +43,20 @@
 #ifndef VALUE_H
 #define VALUE_H
 
+#include <atomic>
 #include <memory>
 #include <string>
+#include <cstdint>
 #include <vector>
 #include <numeric>
+#include <algorithm>
 #include <unordered_map>
 #include <map>
 #include <initializer_list>
 #include "exception.hpp"
 #include "iterator.hpp"
 #include "types.hpp"
+#include "high_precision.hpp"
 
 namespace ubjson {
 
@@ -60,6 +64,16 @@ namespace ubjson {
     /*!
      * \brief The Value class
      * A generalized container object for all value types exchageable by the protocol
+     *
+     * Arrays and Maps are shared between copies: copying a Value is O(1) however large it is, and a
+     * container is copied (one level at a time, its items are shared in turn) only when a copy still
+     * sharing it is about to be modified through non-const operator [], push_back(), remove(), find(), or iterators.
+     * A reference returned by non-const operator [] is to the item itself, wherever it is shared: like a reference
+     * into a std::vector, keep it only until the Value is copied or otherwise modified.
+     * An iterator may be kept across a copy: once non-const find(), items(), elements() or an iterator has handed
+     * one out, copies of the container are made at once, as they were before sharing, so a modification through the
+     * iterator is never seen by a copy. That lasts until push_back(), remove(), remove_if() or operator [] adding
+     * a key invalidates the iterators, as they would those of a std::vector.
      */
     class Value
     {
@@ -80,6 +94,9 @@ namespace ubjson {
         //! \note \a byte is an alias for \e unsigned \e char
         using BinaryType = std::vector<byte>;
 
+        //! An alias used to internally represent \ref Type "HighPrecision" types
+        using HighPrecisionType = HighPrecisionNumber;
+
         //! An alias used to internally represent \ref Type "Map" types
         using MapType = std::unordered_map<std::string, Uptr>;
 
@@ -89,9 +106,57 @@ namespace ubjson {
         //! Iterator alias for accessing values of an iterable value object
         using const_iterator = value_iterator<const Value, ArrayType::const_iterator, MapType::const_iterator>;
 
+        //! Random access iterator alias for accessing the items of an Array; see \ref elements()
+        using array_iterator = value_array_iterator<Value, ArrayType::iterator>;
+
+        //! Random access iterator alias for accessing the items of an Array; see \ref elements()
+        using const_array_iterator = value_array_iterator<const Value, ArrayType::const_iterator>;
+
+        //! Iterator alias for accessing the members of a Map, keys included; see \ref items()
+        using member_iterator = value_member_iterator<Value, MapType::iterator>;
+
+        //! Iterator alias for accessing the members of a Map, keys included; see \ref items()
+        using const_member_iterator = value_member_iterator<const Value, MapType::const_iterator>;
+
         friend iterator;
         friend const_iterator;
 
+        //! the items of an Array by hash, see \ref ArrayStorage
+        struct ArrayIndex;
+
+        /*!
+         * \brief The storage of an Array, shared by copies.
+         * Besides the items, it holds an index of them by \ref hash(), built by the first contains(), find() or remove()
+         * on an Array of at least \ref min_indexed_items items, which makes those O(1) on average from then on.
+         * push_back(), remove() and operator [] keep the index up to date; any other non-const access drops it.
+         * An item operator [] handed out may change without the Array knowing, so the index searches it one by one,
+         * as all the items are while they are \ref leaked
+         */
+        struct ArrayStorage
+        {
+            ArrayType items;
+            mutable std::atomic<ArrayIndex*> index{ nullptr };
+            bool leaked = false;        //!< an iterator into the items was handed out, so copies can't share them
+            bool referenced = false;    //!< operator [] handed out an item, so the hash of the Array isn't cached
+
+
+            explicit ArrayStorage(ArrayType&& a) noexcept : items(std::move(a)) {}
+            ~ArrayStorage();
+        };
+
+        //! The storage of a Map, shared by copies, see \ref ArrayStorage
+        struct MapStorage
+        {
+            MapType members;
+            bool leaked = false;        //!< an iterator into the members was handed out, so copies can't share them
+            bool referenced = false;    //!< operator [] handed out a member, so the hash of the Map isn't cached
+
+            explicit MapStorage(MapType&& m) noexcept : members(std::move(m)) {}
+        };
+
+        //! Arrays smaller than this are searched item by item, which is faster than hashing
+        static constexpr std::size_t min_indexed_items = 32;
+
 
         /*!
          * \brief This is the union type that actually stores the data for Value class
@@ -106,9 +171,10 @@ namespace ubjson {
             unsigned long long UnsignedInt;     //! To be Used when explicitly requested or higher values are to be stored
             double Float;
             std::string String;
-            ArrayType Array;
+            std::shared_ptr<ArrayStorage> Array;    //! shared by copies, see \ref array()
             BinaryType Binary;
-            MapType Map;
+            std::shared_ptr<MapStorage> Map;    //! shared by copies, see \ref map()
+            HighPrecisionType HighPrecision;
 
             ValueHolder() {}
             ~ValueHolder() {}
@@ -217,6 +283,30 @@ namespace ubjson {
         Value(BinaryType);
 
 
+        /*!
+         * \brief contstructs Value containing the given ArrayType
+         * \post isArray() == true \e and type() == Type::Array, even if the ArrayType is empty
+         * \pre every element is non-null
+         */
+        Value(ArrayType);
+
+
+        /*!
+         * \brief contstructs Value containing the given MapType
+         * \post isMap() == true \e and type() == Type::Map, even if the MapType is empty
+         * \pre every value is non-null
+         */
+        Value(MapType);
+
+
+        /*!
+         * \brief contstructs Value containing the given HighPrecisionType
+         * \post isHighPrecision() == true \e and type() == Type::HighPrecision
+         * \remarks you can safely call the \e HighPrecisionType conversion operators
+         */
+        Value(HighPrecisionType);
+
+
         /*!
          * \brief uniform-brace initialization constructor
          * \post For single arguments, it has the same effect as calling the single argument constructors...
@@ -248,7 +338,7 @@ namespace ubjson {
          * \brief moves the given value and sets \b val to \b Type::Null
          * \post this now contains moved value, and \b val.isNull() \b == \b true
          */
-        Value(Value&&);
+        Value(Value&&) noexcept;
 
         /*!
          * \brief Copies the given value
@@ -297,6 +387,10 @@ namespace ubjson {
         //! Returns whether the contained type is \ref BinaryType "Binary"
         bool isBinary() const noexcept;
 
+        //! Returns whether the contained type is a \ref HighPrecisionType "HighPrecision" number
+        //! \note high precision numbers are not isNumeric(), since they may be beyond every native type
+        bool isHighPrecision() const noexcept;
+
         //! Returns whether the contained type is a numeric type. ( double or {(unsigned)int/long long} )
         bool isNumeric() const noexcept;
 
@@ -318,6 +412,31 @@ namespace ubjson {
          */
         bool isComparableWith(const Value& rhs) const noexcept;
 
+        /*!
+         * \brief a structural hash, consistent with operator ==
+         * - Map members are combined without regard to their order
+         * - numbers hash by their value, whatever their type; so Value(2) and Value(2.0) hash alike
+         * - the hash of an Array or Map is cached until it is next modified, and is only 32 bits wide.
+         * It isn't cached once a non-const reference or iterator into the container was handed out, since that may
+         * modify it unseen. operator == returns early when both hashes are cached and differ
+         * \remarks std::hash<Value> calls this
+         */
+        std::size_t hash() const noexcept;
+
+        /*!
+         * \brief a total order over all Values, consistent with operator ==
+         * \return a negative number, zero or a positive number, as this sorts before, with, or after \a rhs
+         *
+         * - Values of different types sort by type: Null, Bool, the numbers, HighPrecision, Char, String,
+         * Binary, Array, Map
+         * - signed, unsigned and floating point numbers are compared exactly, by value. NaN sorts after
+         * every other number and equals itself
+         * - Arrays compare lexicographically. Maps with fewer members sort first; Maps of equal size
+         * compare their members in key order
+         * \remarks the operators <, >, <= and >= call this, so Values can be sorted, binary searched, and used as std::map keys
+         */
+        int compare(const Value& rhs) const;
+
         /*!
          * \brief unconditionally converts the contained type to \e bool using the following rules
          * - correct values are guranteed if the contained type is \e bool
@@ -354,6 +473,7 @@ namespace ubjson {
          * by an \e long \e long integer, otherwise, returns \b 0
          * - if the contained type is string, it attempts to convert it using "std::stoll".
          * Exceptions thrown by it are handled internally
+         * - if the contained type is high precision, it returns it if it is an integer that fits, otherwise \b 0
          * - otherwise, this function returns size()
          * \remarks Except when operator ::new fails, this function is guranteed not to throw.
          */
@@ -366,6 +486,7 @@ namespace ubjson {
          * by an \e unsigned \e long \e long integer, otherwise, returns \b 0
          * - if the contained type is string, it attempts to convert it using "std::stoull".
          * Exceptions thrown by it are handled internally
+         * - if the contained type is high precision, it returns it if it is an integer that fits, otherwise \b 0
          * - otherwise, this function returns size()
          * \remarks Except when operator ::new fails, this function is guranteed not to throw.
          */
@@ -378,6 +499,7 @@ namespace ubjson {
          * by a \e double, otherwise, returns \b 0.0
          * - if the contained type is string, it attempts to convert it using "std::stod".
          * Exceptions thrown by it are handled internally
+         * - if the contained type is high precision, it returns the nearest double
          * - otherwise, this function returns size()
          * \note this function actually delgates conversion to asInt64(), so refer to it for further behavior
          * \remarks Except when operator ::new fails, this function is guranteed not to throw.
@@ -389,6 +511,7 @@ namespace ubjson {
          * - correct values are guranteed if type() is Type::String
          * or is of Type::String
          * - if the contained type is numeric, it returns it in string form,
+         * - if the contained type is high precision, it returns its exact text
          * - if the contained type is string, it attempts to convert it using "std::stod".
          * Exceptions thrown by it are handled internally
          * - otherwise, this function returns size()
@@ -398,7 +521,7 @@ namespace ubjson {
         BinaryType          asBinary() const noexcept;
 
         Value& operator = (const Value& lhs);
-        Value& operator = (Value&& lhs);
+        Value& operator = (Value&& lhs) noexcept;
 
         Value& operator [] (int i);
         Value const& operator [] (int i) const;
@@ -415,6 +538,14 @@ namespace ubjson {
         bool contains(const Value&) const;
         void remove(const Value&);
 
+        /*!
+         * \brief removes every item of an Array, or member of a Map, for which \a pred returns true, in one pass
+         * \param pred is called as pred(const Value&)
+         * \return the number of items removed; 0 for other types
+         */
+        template<typename Predicate>
+        std::size_t remove_if(Predicate pred);
+
         iterator find(const Value&);
         const_iterator find(const Value&) const;
 
@@ -425,6 +556,33 @@ namespace ubjson {
          */
         Keys keys() const;
 
+        /*!
+         * \brief the members of this Map, each as a \ref value_member "{key, value}" referring to the Map itself.
+         * Unlike \ref keys() followed by operator [], nothing is copied and no key is looked up
+         * \return an empty range if this isn't a Map
+         *
+         * \code
+         * for(auto member : config.items())
+         *     std::cout << member.key << " = " << member.value.asString() << std::endl;
+         * \endcode
+         */
+        iterator_range<member_iterator> items();
+        iterator_range<const_member_iterator> items() const;
+
+        /*!
+         * \brief the items of this Array, through random access iterators.
+         * Where begin() and end() work on any type and only go forward, these suit the standard algorithms
+         * that need more, and cost no more than iterating the underlying storage
+         * \return an empty range if this isn't an Array
+         *
+         * \code
+         * auto items = records.elements();
+         * std::sort(items.begin(), items.end(), [](const Value& a, const Value& b){ return a["id"] < b["id"]; });
+         * \endcode
+         */
+        iterator_range<array_iterator> elements();
+        iterator_range<const_array_iterator> elements() const;
+
         iterator begin()
         { return iterator(this, iterator::pos::begin); }
 
@@ -474,34 +632,115 @@ namespace ubjson {
         operator BinaryType& () &;
         operator BinaryType const& () const&;
 
+        operator HighPrecisionType&& () &&;
+        operator HighPrecisionType& () &;
+        operator HighPrecisionType const& () const&;
+
         friend void swap(Value&, Value&);
         friend bool operator == (const Value&, const Value&);
+        friend class JsonWriter;
+        friend class JsonReader;
+        friend class ArrayAlgorithms;
+        friend class BufferScanner;
+        friend class DocumentIndex;
+        template<typename> friend class StreamReader;
 
     private:
 
         void construct_fromString(std::string&&);
         void construct_fromArray(ArrayType&&);
         void construct_fromBinary(BinaryType&&);
+        void construct_fromHighPrecision(HighPrecisionType&&);
         void construct_fromMap(MapType&&);
         inline void destruct() noexcept;
+        void destruct_items() noexcept;
+        inline bool owns_items() const noexcept;
+        static void take_items(Value& v, ArrayType& work) noexcept;
 
-        void move_from(Value&&);
+        void move_from(Value&&) noexcept;
         void copy_from(const Value&);
 
+        //! the items, for a caller that hands out iterators into them; they aren't shared until those are invalidated \pre isArray()
+        ArrayType& array();
+        const ArrayType& array() const noexcept { return value.Array->items; }
+
+        //! the items, copied first if they are shared with another Value; drops the index \pre isArray()
+        ArrayType& modify_array();
+
+        //! like modify_array(), but keeps the index, for a caller that keeps it up to date
+        ArrayType& array_keeping_index();
+        const ArrayIndex& array_index() const;
+        ArrayType::const_iterator find_item(const Value&) const;
+        void index_appended() noexcept;
+
+        //! the members, for a caller that hands out iterators into them, see array() \pre isMap()
+        MapType& map();
+        const MapType& map() const noexcept { return value.Map->members; }
+
+        //! the members, copied first if they are shared with another Value \pre isMap()
+        MapType& modify_map();
+
+        //! sets the member \a key, as operator [] would but without handing it out; a Null becomes a Map \pre isNull() or isMap()
+        void set_member(const std::string& key, Value&& v);
+
         ValueHolder value;
         Type vtype = Type::Null;
+        bool referenced = false;    //!< operator [] of the Array holding this handed it out, see ArrayStorage
+        mutable std::atomic<std::uint32_t> cached_hash{ 0 };    //!< of an Array or Map, 0 if unknown; these three share a word
 
 
     };
 
+    template<typename Predicate>
+    std::size_t Value::remove_if(Predicate pred)
+    {
+        //looked up without copying shared items or dropping the index; they are copied only when something matches
+        std::size_t removed = 0;
+        if(vtype == Type::Array)
+        {
+            const ArrayType& found = static_cast<const Value&>(*this).array();
+            const auto first = std::find_if(found.begin(), found.end(), [&pred](const Uptr& item){ return pred(static_cast<const Value&>(*item)); });
+            if(first == found.end())
+                return 0;
+            const auto position = first - found.begin();
+            ArrayType& items = modify_array();
+            auto kept = items.begin() + position;
+            for(auto it = kept + 1; it != items.end(); ++it)
+                if(not pred(static_cast<const Value&>(**it)))
+                    *kept++ = std::move(*it);
+            removed = static_cast<std::size_t>(items.end() - kept);
+            items.erase(kept, items.end());
+            value.Array->leaked = false;    //its iterators are invalidated
+        }
+        else if(vtype == Type::Map)
+        {
+            std::vector<std::string> matched;
+            for(const auto& member : static_cast<const Value&>(*this).map())
+                if(pred(static_cast<const Value&>(*member.second)))
+                    matched.push_back(member.first);
+            if(matched.empty())
+                return 0;
+            MapType& members = modify_map();
+            for(const auto& key : matched)
+                members.erase(key);
+            removed = matched.size();
+            value.Map->leaked = false;
+        }
+        return removed;
+    }
+
     void swap(Value&, Value&);
     bool operator == (const Value&, const Value&);
     bool operator != (const Value&, const Value&s);
+    bool operator < (const Value&, const Value&);
+    bool operator > (const Value&, const Value&);
+    bool operator <= (const Value&, const Value&);
+    bool operator >= (const Value&, const Value&);
 
 
 
     /*!
-     * \brief The to_ostream class is responsible for pretty printing Value in JSON format
+     * \brief The to_ostream class is responsible for pretty printing Value in JSON format, through \ref JsonWriter
      *
      * You can either print it in compact mode, or pretty. Example
      * \code
@@ -539,27 +778,13 @@ namespace ubjson {
 
         to_ostream(const Value& val, Opt option = pretty)
             : value(val), opt(option)
-        { ppretty = opt == pretty; }
+        {}
 
         friend std::ostream& operator << (std::ostream& stream, to_ostream&& tos);
 
     private:
-        void print_value(std::ostream& os, const Value& v);
-        void print_object(std::ostream& os, const Value& v);
-        void print_array(std::ostream& os, const Value& v);
-
-        inline void push_addendum(char c)
-        { addendum.push_back(c); }
-
-        inline void pop_addendum() {
-            if(!addendum.empty())
-                addendum.pop_back();
-        }
-
         const Value& value;
         const Opt opt;
-        std::string addendum;
-        bool ppretty;
     };
 
     std::ostream& operator << (std::ostream& stream, to_ostream&& tos);
@@ -575,7 +800,7 @@ namespace ubjson {
      * Clients are encouraged to always use a \b const copy of this class
      *
      * \code
-     * ValueSizePolicy vs = {8, 1024, 1024, 4096, 255, 255};
+     * ValueSizePolicy vs = {8, 1024, 1024, 4096, 255, 255, false};
      *
      * //Client
      * class Reader
@@ -610,8 +835,23 @@ namespace ubjson {
 
         //! This dictates the maximum items Value::size() in an Object
         std::size_t max_object_items;
+
+        //! When set, strings and keys must be valid UTF-8, else parsing fails
+        bool validate_utf8;
     };
 
 
+}
+
+namespace std {
+
+    //! lets Values key unordered containers, see \ref ubjson::Value::hash()
+    template<>
+    struct hash<ubjson::Value>
+    {
+        std::size_t operator () (const ubjson::Value& v) const noexcept
+        { return v.hash(); }
+    };
+
 }
 #endif // VALUE_H
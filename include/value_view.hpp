@@ -0,0 +1,210 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+/**
+  * @file value_view.hpp
+  * Contains the ValueView class, a read-only and lazily decoded Value over encoded UBJSON
+  *
+  * @brief navigate encoded bytes without building a Value tree
+  * @author WhiZTiM
+  *
+  * Only the parts of a document that are actually touched are decoded. The offsets of the
+  * children of every visited container are cached, and shared by all views of the document
+  *
+  * @code
+  * std::string bytes = . . .;   //e.g. a whole file, or an mmap()ed region
+  * ValueView doc(bytes.data(), bytes.size());
+  *
+  * if(doc["header"]["version"].asInt() == 2)
+  *     for(const auto& item : doc["items"])
+  *         cout << item["id"].asString() << '\n';
+  *
+  * Value owned = doc["items"][0].toValue();     //a full copy, independent of the buffer
+  * @endcode
+  */
+
+#ifndef VALUE_VIEW_HPP
+#define VALUE_VIEW_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <iterator>
+#include <unordered_map>
+#include "value.hpp"
+#include "buffer_scanner.hpp"
+#include "stream_reader.hpp"
+
+namespace ubjson {
+
+    /*!
+     * \brief The ValueView class
+     * A read-only view of one value in a buffer of encoded UBJSON, with the navigation API of \ref Value.
+     * Views are cheap to copy; every view of a document shares its buffer and its offset cache.
+     *
+     * \warning the buffer must outlive every view of it, and must not be modified.
+     * \warning views of the same document must not be used concurrently from multiple threads.
+     * \throws parsing_exception whenever a malformed part of the buffer is visited
+     */
+    class ValueView
+    {
+    public:
+        class const_iterator;
+
+        //! constructs a Null view, that isn't attached to any buffer
+        ValueView() noexcept;
+
+        //! views the first value encoded in \a data
+        ValueView(const byte* data, std::size_t size, ValueSizePolicy policy = defaultStreamReaderPolicy());
+        ValueView(const char* data, std::size_t size, ValueSizePolicy policy = defaultStreamReaderPolicy());
+
+        /*!
+         * \brief the type of the viewed value.
+         * Like StreamReader, a high precision number that is a plain integer within \e unsigned \e long \e long
+         * is reported as Type::UnsignedInt
+         */
+        Type type() const;
+
+        //! \see Value::size()
+        std::size_t size() const;
+
+        bool isMap() const { return type() == Type::Map; }
+        bool isNull() const { return type() == Type::Null; }
+        bool isChar() const { return type() == Type::Char; }
+        bool isBool() const { return type() == Type::Bool; }
+        bool isFloat() const { return type() == Type::Float; }
+        bool isArray() const { return type() == Type::Array; }
+        bool isObject() const { return isMap(); }
+        bool isString() const { return type() == Type::String; }
+        bool isBinary() const { return type() == Type::Binary; }
+        bool isHighPrecision() const { return type() == Type::HighPrecision; }
+        bool isNumeric() const { return isInteger() or isFloat(); }
+        bool isInteger() const { return isSignedInteger() or isUnsignedInteger(); }
+        bool isSignedInteger() const { return type() == Type::SignedInt; }
+        bool isUnsignedInteger() const { return type() == Type::UnsignedInt; }
+
+        //! conversions follow exactly the rules of the Value::asX() family
+        bool                asBool()   const;
+        int                 asInt()    const;
+        unsigned int        asUint()   const;
+        long long           asInt64()  const;
+        unsigned long long  asUint64() const;
+        double              asFloat()  const;
+        std::string         asString() const;
+        Value::BinaryType   asBinary() const;
+
+        /*!
+         * \brief views the element at \a i of an Array
+         * \throws std::out_of_range if there is no such element, value_exception if this isn't an Array
+         */
+        ValueView operator [] (int i) const;
+
+        /*!
+         * \brief views the value of \a key in a Map
+         * \throws std::out_of_range if there is no such key, value_exception if this isn't a Map
+         */
+        ValueView operator [] (const char* key) const;
+        ValueView operator [] (const std::string& key) const;
+
+        //! whether this is a Map that has \a key
+        bool contains(const std::string& key) const;
+
+        //! \see Value::keys()
+        Value::Keys keys() const;
+
+        //! iterates over the elements of an Array, or the values of a Map
+        const_iterator begin() const;
+        const_iterator end() const;
+
+        /*!
+         * \brief decodes this value and everything in it into a Value, the same as StreamReader would.
+         * The offset cache isn't populated; a ValueView only caches what is navigated.
+         * \note like StreamReader, empty containers become a Null Value
+         */
+        Value toValue() const;
+
+    private:
+        struct Document;
+        struct ContainerIndex;
+
+        ValueView(const std::shared_ptr<Document>& document, byte marker, std::size_t payload) noexcept;
+
+        bool isContainer() const noexcept;
+        ContainerIndex& index() const;
+        bool hasChild(std::size_t i) const;
+        ValueView child(std::size_t i) const;
+        std::string childKey(std::size_t i) const;
+        bool findKey(const char* key, std::size_t size, std::size_t& i) const;
+        Value scalar() const;
+
+        std::shared_ptr<Document> doc;
+        byte marker;
+        std::size_t payload;    //! offset of the payload, just past the marker (if any)
+    };
+
+
+    /*!
+     * \brief The ValueView::const_iterator class
+     * A forward iterator over the children of a viewed container; children are indexed as they are reached
+     */
+    class ValueView::const_iterator
+            : public std::iterator<std::forward_iterator_tag, const ValueView>
+    {
+    public:
+        const ValueView& operator * () const { return current; }
+        const ValueView* operator -> () const { return &current; }
+
+        //! the key of the current value, if the container is a Map
+        std::string key() const { return parent.childKey(idx); }
+
+        const_iterator& operator ++ ()
+        {
+            advance(idx + 1);
+            return *this;
+        }
+
+        const_iterator operator ++ (int)
+        {
+            auto rtn = *this;
+            operator ++();
+            return rtn;
+        }
+
+        friend bool operator == (const const_iterator& lhs, const const_iterator& rhs)
+        { return lhs.idx == rhs.idx; }
+
+        friend bool operator != (const const_iterator& lhs, const const_iterator& rhs)
+        { return !(lhs == rhs); }
+
+    private:
+        friend class ValueView;
+        static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+        const_iterator(const ValueView& Parent, std::size_t i)
+            : parent(Parent) { advance(i); }
+
+        void advance(std::size_t i)
+        {
+            idx = (i != npos and parent.hasChild(i)) ? i : npos;
+            if(idx != npos)
+                current = parent.child(idx);
+        }
+
+        ValueView parent;
+        ValueView current;
+        std::size_t idx;
+    };
+
+}   //end namespace ubjson
+
+#endif // VALUE_VIEW_HPP
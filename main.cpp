@@ -45,6 +45,22 @@ int main()
     extern int weird_cppunit_extern_bug_value_conversion_test;      weird_cppunit_extern_bug_value_conversion_test = 1;
     extern int weird_cppunit_extern_bug_value_map_and_array_test;   weird_cppunit_extern_bug_value_map_and_array_test = 1;
     extern int weird_cppunit_extern_bug_value_iterator_test;        weird_cppunit_extern_bug_value_iterator_test = 1;
+    extern int weird_cppunit_extern_bug_scatter_gather_test;        weird_cppunit_extern_bug_scatter_gather_test = 1;
+    extern int weird_cppunit_extern_bug_stream_roundtrip_test;      weird_cppunit_extern_bug_stream_roundtrip_test = 1;
+    extern int weird_cppunit_extern_bug_value_view_test;            weird_cppunit_extern_bug_value_view_test = 1;
+    extern int weird_cppunit_extern_bug_document_index_test;        weird_cppunit_extern_bug_document_index_test = 1;
+    extern int weird_cppunit_extern_bug_parallel_reader_test;       weird_cppunit_extern_bug_parallel_reader_test = 1;
+    extern int weird_cppunit_extern_bug_record_reader_test;         weird_cppunit_extern_bug_record_reader_test = 1;
+    extern int weird_cppunit_extern_bug_validator_test;             weird_cppunit_extern_bug_validator_test = 1;
+    extern int weird_cppunit_extern_bug_json_writer_test;           weird_cppunit_extern_bug_json_writer_test = 1;
+    extern int weird_cppunit_extern_bug_json_reader_test;           weird_cppunit_extern_bug_json_reader_test = 1;
+    extern int weird_cppunit_extern_bug_transcoder_test;            weird_cppunit_extern_bug_transcoder_test = 1;
+    extern int weird_cppunit_extern_bug_persistent_value_test;      weird_cppunit_extern_bug_persistent_value_test = 1;
+    extern int weird_cppunit_extern_bug_snapshot_holder_test;       weird_cppunit_extern_bug_snapshot_holder_test = 1;
+    extern int weird_cppunit_extern_bug_value_destruction_test;     weird_cppunit_extern_bug_value_destruction_test = 1;
+    extern int weird_cppunit_extern_bug_value_hash_test;            weird_cppunit_extern_bug_value_hash_test = 1;
+    extern int weird_cppunit_extern_bug_value_comparison_test;      weird_cppunit_extern_bug_value_comparison_test = 1;
+    extern int weird_cppunit_extern_bug_array_algorithms_test;      weird_cppunit_extern_bug_array_algorithms_test = 1;
 
     Value v1 = tst(), v2 = tst2();
 	cout << "V1 = " << to_ostream(v1) << '\n';
@@ -0,0 +1,212 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+#include "array_algorithms.hpp"
+#include "parallel_tasks.hpp"
+#include <vector>
+#include <algorithm>
+#include <unordered_set>
+
+using namespace ubjson;
+
+/////////////////  FREE FUNCTIONS
+
+namespace {
+
+    //! the fewest items a thread is given; sorting or hashing fewer is quicker than starting it
+    constexpr std::size_t min_items_per_thread = 8 * 1024;
+
+    const Value null_key;
+
+    //! the position of an item, and the Value within it that it is ordered by
+    struct Entry
+    {
+        const Value* key;
+        std::size_t index;
+    };
+
+    bool key_less(const Entry& lhs, const Entry& rhs)
+    { return lhs.key->compare(*rhs.key) < 0; }
+
+    /*!
+     * \brief sorts \a entries in \a workers contiguous runs at once, then merges neighbouring runs into
+     * \a buffer and back, also at once, until one run is left. Merging is stable, so stable runs make a stable sort
+     */
+    void sort_entries(std::vector<Entry>& entries, std::vector<Entry>& buffer, std::size_t workers, bool stable)
+    {
+        std::vector<std::size_t> cuts;
+        for(std::size_t w = 0; w <= workers; ++w)
+            cuts.push_back(entries.size() * w / workers);
+
+        runTasks(workers, [&](std::size_t w)
+        {
+            if(stable)
+                std::stable_sort(entries.begin() + cuts[w], entries.begin() + cuts[w + 1], key_less);
+            else
+                std::sort(entries.begin() + cuts[w], entries.begin() + cuts[w + 1], key_less);
+        });
+
+        buffer.resize(entries.size());
+        for(std::size_t width = 1; width < workers; width *= 2)
+        {
+            auto from = [&](std::size_t run){ return entries.begin() + cuts[std::min(run, workers)]; };
+            runTasks((workers + 2 * width - 1) / (2 * width), [&](std::size_t m)
+            {
+                const std::size_t first = 2 * m * width;
+                std::merge(from(first), from(first + width), from(first + width), from(first + 2 * width),
+                           buffer.begin() + cuts[first], key_less);
+            });
+            entries.swap(buffer);
+        }
+    }
+
+}
+
+
+ArrayAlgorithms::ArrayAlgorithms(unsigned threads)
+    : max_threads(threadCount(threads))
+{  /**/ }
+
+void ArrayAlgorithms::sort(Value& array, const KeyPath& key)
+{
+    sort_items(array, key, false);
+}
+
+void ArrayAlgorithms::stableSort(Value& array, const KeyPath& key)
+{
+    sort_items(array, key, true);
+}
+
+std::size_t ArrayAlgorithms::unique(Value& array, const KeyPath& key)
+{
+    threads_used = 1;
+    Value::ArrayType* items = items_of(array, "unique");
+    if(not items or items->empty())
+        return 0;
+
+    //erasing the repeats only once they have all been found keeps the items intact if a comparison throws
+    std::vector<bool> repeat(items->size());
+    const Value* last = key_of(*(*items)[0], key);
+    for(std::size_t i = 1; i < items->size(); ++i)
+    {
+        const Value* current = key_of(*(*items)[i], key);
+        repeat[i] = current->compare(*last) == 0;
+        last = current;
+    }
+
+    std::size_t kept = 0;
+    for(std::size_t i = 0; i < items->size(); ++i)
+        if(not repeat[i])
+            (*items)[kept++] = std::move((*items)[i]);
+    const std::size_t removed = items->size() - kept;
+    items->resize(kept);
+    return removed;
+}
+
+std::size_t ArrayAlgorithms::dedupe(Value& array, const KeyPath& key)
+{
+    threads_used = 1;
+    Value::ArrayType* items = items_of(array, "dedupe");
+    if(not items or items->empty())
+        return 0;
+
+    //hashing is what costs; each thread hashes a contiguous range
+    struct Keyed
+    {
+        const Value* key;
+        std::size_t hash;
+    };
+    std::vector<Keyed> keys(items->size());
+    const std::size_t workers = workers_for(items->size());
+    threads_used = runTasks(workers, [&](std::size_t w)
+    {
+        for(std::size_t i = items->size() * w / workers; i < items->size() * (w + 1) / workers; ++i)
+        {
+            keys[i].key = key_of(*(*items)[i], key);
+            keys[i].hash = keys[i].key->hash();
+        }
+    });
+
+    auto hash = [](const Keyed& k){ return k.hash; };
+    auto equal = [](const Keyed& lhs, const Keyed& rhs){ return *lhs.key == *rhs.key; };
+    std::unordered_set<Keyed, decltype(hash), decltype(equal)> seen(items->size(), hash, equal);
+    std::vector<bool> repeat(items->size());
+    for(std::size_t i = 0; i < items->size(); ++i)
+        repeat[i] = not seen.insert(keys[i]).second;
+
+    std::size_t kept = 0;
+    for(std::size_t i = 0; i < items->size(); ++i)
+        if(not repeat[i])
+            (*items)[kept++] = std::move((*items)[i]);
+    const std::size_t removed = items->size() - kept;
+    items->resize(kept);
+    return removed;
+}
+
+//////////////// PRIVATE ////////////////
+/////////////////////////////////////////
+
+//! the items of \a array, unshared first; nullptr if \a array is Null
+Value::ArrayType* ArrayAlgorithms::items_of(Value& array, const char* algorithm)
+{
+    if(array.isNull())
+        return nullptr;
+    if(not array.isArray())
+        throw value_exception((std::string("Attempt to ") + algorithm + " 'Value'; 'Value' is not an Array!").c_str());
+    return &array.modify_array();
+}
+
+const Value* ArrayAlgorithms::key_of(const Value& item, const KeyPath& key) noexcept
+{
+    const Value* at = &item;
+    for(const auto& k : key)
+    {
+        if(not at->isMap())
+            return &null_key;
+        auto it = at->map().find(k);
+        if(it == at->map().end())
+            return &null_key;
+        at = it->second.get();
+    }
+    return at;
+}
+
+void ArrayAlgorithms::sort_items(Value& array, const KeyPath& key, bool stable)
+{
+    threads_used = 1;
+    Value::ArrayType* items = items_of(array, "sort");
+    if(not items or items->size() < 2)
+        return;
+
+    //the items themselves are only moved once the order is known, so a comparison that throws changes nothing
+    std::vector<Entry> entries;
+    entries.reserve(items->size());
+    for(std::size_t i = 0; i < items->size(); ++i)
+        entries.push_back({ key_of(*(*items)[i], key), i });
+    Value::ArrayType sorted;
+    sorted.reserve(items->size());
+
+    std::vector<Entry> buffer;
+    const std::size_t workers = workers_for(items->size());
+    sort_entries(entries, buffer, workers, stable);
+
+    for(const Entry& e : entries)
+        sorted.push_back(std::move((*items)[e.index]));
+    items->swap(sorted);
+    threads_used = static_cast<unsigned>(workers);
+}
+
+unsigned ArrayAlgorithms::workers_for(std::size_t items) const
+{
+    return static_cast<unsigned>(std::max<std::size_t>(1, std::min<std::size_t>(max_threads, items / min_items_per_thread)));
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+#include "background_reclaimer.hpp"
+
+using namespace ubjson;
+
+BackgroundReclaimer::BackgroundReclaimer()
+    : janitor(&BackgroundReclaimer::run, this)
+{}
+
+BackgroundReclaimer::~BackgroundReclaimer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    janitor.join();
+}
+
+void BackgroundReclaimer::dispose(Value&& v)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back(std::move(v));
+    }
+    wake.notify_one();
+}
+
+void BackgroundReclaimer::drain()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    drained.wait(lock, [this]{ return pending.empty() and in_progress == 0; });
+}
+
+std::size_t BackgroundReclaimer::getPendingCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return pending.size() + in_progress;
+}
+
+//////////////// PRIVATE ////////////////
+/////////////////////////////////////////
+
+//! takes everything pending at once, and destroys it without holding the lock
+void BackgroundReclaimer::run()
+{
+    std::vector<Value> batch;
+    std::unique_lock<std::mutex> lock(mutex);
+    for(;;)
+    {
+        wake.wait(lock, [this]{ return stopping or not pending.empty(); });
+        if(pending.empty())
+            return;
+
+        batch.swap(pending);
+        in_progress = batch.size();
+        lock.unlock();
+        batch.clear();
+        lock.lock();
+        in_progress = 0;
+        drained.notify_all();
+    }
+}
@@ -0,0 +1,282 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+#include "buffer_scanner.hpp"
+#include "utf8.hpp"
+
+using namespace ubjson;
+
+
+int BufferScanner::fixedPayloadSize(byte marker) noexcept
+{
+    switch (static_cast<Marker>(marker)) {
+    case Marker::Null:
+    case Marker::No_Op:
+    case Marker::True:
+    case Marker::False:
+        return 0;
+    case Marker::Char:
+    case Marker::Int8:
+    case Marker::Uint8:
+        return 1;
+    case Marker::Int16:
+        return 2;
+    case Marker::Int32:
+    case Marker::Float32:
+        return 4;
+    case Marker::Int64:
+    case Marker::Float64:
+        return 8;
+    default:
+        return -1;
+    }
+}
+
+long long BufferScanner::readInteger(byte marker, std::size_t pos) const
+{
+    const int width = isInteger(marker) ? fixedPayloadSize(marker) : -1;
+    if(width < 0)
+        throw parsing_exception("Invalid integer marker encountered!");
+    require(pos, width);
+
+    byte* b = const_cast<byte*>(first + pos);
+    switch (static_cast<Marker>(marker)) {
+    case Marker::Uint8:
+        return fromBigEndian8(b);
+    case Marker::Int8:
+        return static_cast<int8_t>(fromBigEndian8(b));
+    case Marker::Int16:
+        return static_cast<int16_t>(fromBigEndian16(b));
+    case Marker::Int32:
+        return static_cast<int32_t>(fromBigEndian32(b));
+    default:
+        return static_cast<int64_t>(fromBigEndian64(b));
+    }
+}
+
+std::size_t BufferScanner::readCount(std::size_t& pos) const
+{
+    const byte marker = markerAt(pos);
+    const long long count = readInteger(marker, pos + 1);
+    if(count < 0)
+        throw parsing_exception("Negative count token encountered!");
+    pos += 1 + fixedPayloadSize(marker);
+    return static_cast<std::size_t>(count);
+}
+
+std::pair<std::size_t, std::size_t> BufferScanner::readSized(std::size_t& pos) const
+{
+    const std::size_t count = readCount(pos);
+    require(pos, count);
+    const std::size_t offset = pos;
+    pos += count;
+    return std::make_pair(offset, count);
+}
+
+STCHeader BufferScanner::readContainerHeader(std::size_t& pos) const
+{
+    STCHeader header;
+    byte b = markerAt(pos);
+    if(isOptimized_Type(b))
+    {
+        header.has_type = true;
+        header.marker = static_cast<Marker>(markerAt(pos + 1));
+        pos += 2;
+        b = markerAt(pos);
+        if(not isOptimized_Count(b))
+            throw parsing_exception("A typed container must be followed by a count!");
+    }
+    if(isOptimized_Count(b))
+    {
+        ++pos;
+        header.item_count = readCount(pos);
+        header.is_valid = true;
+
+        //every item takes at least a byte, unless it is a typed Null, No-Op or bool without a key
+        if(not(header.has_type and fixedPayloadSize(static_cast<byte>(header.marker)) == 0) and
+                header.item_count > length - pos)
+            throw parsing_exception("Unexpected end of buffer!");
+    }
+    return header;
+}
+
+std::size_t BufferScanner::skip(byte marker, std::size_t pos, std::size_t depth) const
+{
+    const int width = fixedPayloadSize(marker);
+    if(width >= 0)
+    {
+        require(pos, width);
+        return pos + width;
+    }
+    if(isString(marker) or isBinary(marker) or isHighPrecision(marker))
+    {
+        readSized(pos);
+        return pos;
+    }
+    if(isArrayStart(marker) or isObjectStart(marker))
+    {
+        if(depth >= depth_limit)
+            throw parsing_exception("Maximum Parsing depth Exceeded!");
+        return skipContainer(isObjectStart(marker), pos, depth + 1);
+    }
+    throw parsing_exception("Invalid marker encountered!");
+}
+
+std::size_t BufferScanner::skipContainer(bool is_object, std::size_t pos, std::size_t depth) const
+{
+    const STCHeader header = readContainerHeader(pos);
+    const byte type = static_cast<byte>(header.marker);
+
+    if(not header.is_valid)
+    {
+        const byte end = static_cast<byte>(is_object ? Marker::Object_End : Marker::Array_End);
+        while(markerAt(pos) != end)
+        {
+            if(is_object)
+                readSized(pos);
+            pos = skip(markerAt(pos), pos + 1, depth);
+        }
+        return pos + 1;
+    }
+
+    const int width = header.has_type ? fixedPayloadSize(type) : -1;
+    if(width >= 0 and not is_object)       //fixed size elements are skipped in one step
+    {
+        if(width > 0 and header.item_count > (length - pos) / width)
+            throw parsing_exception("Unexpected end of buffer!");
+        return pos + header.item_count * width;
+    }
+
+    for(std::size_t i = 0; i < header.item_count; ++i)
+    {
+        if(is_object)
+            readSized(pos);
+        if(header.has_type)
+            pos = skip(type, pos, depth);
+        else
+            pos = skip(markerAt(pos), pos + 1, depth);
+    }
+    return pos;
+}
+
+Value BufferScanner::decodeScalar(byte marker, std::size_t pos) const
+{
+    const int width = fixedPayloadSize(marker);
+    if(width > 0)
+        require(pos, width);
+    byte* b = const_cast<byte*>(first + pos);
+
+    switch (static_cast<Marker>(marker)) {
+    case Marker::Null:
+    case Marker::No_Op:
+        return Value();
+    case Marker::True:
+        return true;
+    case Marker::False:
+        return false;
+    case Marker::Char:
+        return static_cast<char>(b[0]);
+    case Marker::Uint8:
+        return static_cast<unsigned long long>(readInteger(marker, pos));
+    case Marker::Int8:
+    case Marker::Int16:
+    case Marker::Int32:
+    case Marker::Int64:
+        return readInteger(marker, pos);
+    case Marker::Float32:
+        return static_cast<double>(fromBigEndianFloat32(b));
+    case Marker::Float64:
+        return fromBigEndianFloat64(b);
+    default:
+        break;
+    }
+
+    if(isString(marker) or isBinary(marker) or isHighPrecision(marker))
+    {
+        const auto bytes = readSized(pos);
+        const char* text = reinterpret_cast<const char*>(first + bytes.first);
+        if(isString(marker))
+            return std::string(text, bytes.second);
+        if(isBinary(marker))
+            return Value::BinaryType(text, text + bytes.second);
+
+        Value::HighPrecisionType number;
+        try { number.append(text, bytes.second); }
+        catch(value_exception&)
+        {
+            throw parsing_exception("Invalid high precision number encountered!");
+        }
+        if(bytes.second == 0 or not number.isValid())
+            throw parsing_exception("Invalid high precision number encountered!");
+        unsigned long long integral;
+        if(number.toUint64(integral))
+            return integral;
+        return Value(std::move(number));
+    }
+    throw parsing_exception("Invalid marker encountered!");
+}
+
+Value BufferScanner::decodeValue(byte marker, std::size_t& pos, const ValueSizePolicy& policy, std::size_t depth) const
+{
+    if(not isArrayStart(marker) and not isObjectStart(marker))
+    {
+        if(policy.validate_utf8 and isString(marker))
+        {
+            std::size_t p = pos;
+            checkUtf8(readSized(p));
+        }
+        Value rtn = decodeScalar(marker, pos);
+        pos = skipPayload(marker, pos);
+        return rtn;
+    }
+    if(depth >= policy.max_value_depth)
+        throw parsing_exception("Maximum Parsing depth Exceeded!");
+
+    const bool is_object = isObjectStart(marker);
+    const byte end = static_cast<byte>(is_object ? Marker::Object_End : Marker::Array_End);
+    const STCHeader header = readContainerHeader(pos);
+    if(exceedsItemLimit(header, is_object ? policy.max_object_items : policy.max_array_items))
+        throw parsing_exception("Maximum container items exceeded!");
+
+    Value rtn;
+    std::string key_text;       //reused by every key
+    for(std::size_t i = 0; header.is_valid ? i < header.item_count : markerAt(pos) != end; ++i)
+    {
+        std::pair<std::size_t, std::size_t> key;
+        if(is_object)
+        {
+            key = readSized(pos);
+            if(policy.validate_utf8)
+                checkUtf8(key);
+        }
+        const byte m = header.has_type ? static_cast<byte>(header.marker) : markerAt(pos++);
+        Value value = decodeValue(m, pos, policy, depth + 1);
+
+        if(is_object)
+        {
+            key_text.assign(reinterpret_cast<const char*>(first + key.first), key.second);
+            rtn.set_member(key_text, std::move(value));
+        }
+        else
+            rtn.push_back(std::move(value));
+    }
+    if(not header.is_valid)
+        ++pos;      //the end marker
+    return rtn;
+}
+
+void BufferScanner::checkUtf8(std::pair<std::size_t, std::size_t> bytes) const
+{
+    if(validateUtf8(reinterpret_cast<const char*>(first + bytes.first), bytes.second) != bytes.second)
+        throw parsing_exception("Invalid UTF-8 encountered!");
+}
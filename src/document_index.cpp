@@ -0,0 +1,168 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+#include "document_index.hpp"
+#include <cstring>
+#include <limits>
+
+using namespace ubjson;
+
+constexpr DocumentIndex::index_type DocumentIndex::npos;
+
+DocumentIndex::DocumentIndex(const byte* data, std::size_t size, ValueSizePolicy policy)
+    : scanner(data, size, policy.max_value_depth)
+{
+    build(policy);
+}
+
+DocumentIndex::DocumentIndex(const char* data, std::size_t size, ValueSizePolicy policy)
+    : DocumentIndex(reinterpret_cast<const byte*>(data), size, policy)
+{  /**/ }
+
+DocumentIndex::index_type DocumentIndex::child(index_type i, std::size_t n) const
+{
+    const Entry& e = entries[i];
+    return n < e.child_count ? children[e.first_child + n] : npos;
+}
+
+DocumentIndex::index_type DocumentIndex::find(index_type i, const char* key, std::size_t size) const
+{
+    const Entry& e = entries[i];
+    if(not isObjectStart(e.marker))
+        return npos;
+    for(std::size_t n = e.first_child; n < e.first_child + e.child_count; ++n)
+    {
+        const Entry& c = entries[children[n]];
+        if(c.key_size == size and std::memcmp(data() + c.key, key, size) == 0)
+            return children[n];
+    }
+    return npos;
+}
+
+std::string DocumentIndex::key(index_type i) const
+{
+    const Entry& e = entries[i];
+    return std::string(reinterpret_cast<const char*>(data() + e.key), e.key_size);
+}
+
+Value DocumentIndex::value(index_type i) const
+{
+    const Entry& e = entries[i];
+    if(not isArrayStart(e.marker) and not isObjectStart(e.marker))
+        return scanner.decodeScalar(e.marker, payload(i));
+
+    Value rtn;
+    for(std::size_t n = e.first_child; n < e.first_child + e.child_count; ++n)
+    {
+        if(isObjectStart(e.marker))
+            rtn.set_member(key(children[n]), value(children[n]));
+        else
+            rtn.push_back(value(children[n]));
+    }
+    return rtn;
+}
+
+//////////////// PRIVATE ////////////////
+/////////////////////////////////////////
+
+DocumentIndex::index_type DocumentIndex::append(byte marker, std::size_t offset, bool typed, index_type parent)
+{
+    if(entries.size() >= npos)
+        throw parsing_exception("Too many values to index!");
+    entries.push_back(Entry{offset, 0, 0, 0, parent, npos, 0, 0, marker, typed});
+    return static_cast<index_type>(entries.size() - 1);
+}
+
+/*!
+ * A single pass with an explicit stack of open containers; scalars are skipped by their size
+ * (or length prefix) and never decoded. The children of the open containers are collected in
+ * \a pending, and moved into the child table when their container closes
+ */
+void DocumentIndex::build(const ValueSizePolicy& policy)
+{
+    struct Frame
+    {
+        index_type entry;
+        bool is_object;
+        STCHeader header;
+        std::size_t remaining;
+        std::size_t pending;    //where the children of this container start in pending
+    };
+
+    std::vector<Frame> stack;
+    std::vector<index_type> pending;
+    std::size_t pos = 0;
+
+    //skips a scalar, or opens a container
+    auto open = [&](index_type i)
+    {
+        const byte marker = entries[i].marker;
+        if(not isArrayStart(marker) and not isObjectStart(marker))
+        {
+            pos = scanner.skipPayload(marker, payload(i));
+            entries[i].length = pos - entries[i].offset;
+            return;
+        }
+        if(stack.size() >= policy.max_value_depth)
+            throw parsing_exception("Maximum Parsing depth Exceeded!");
+
+        pos = payload(i);
+        Frame f{i, isObjectStart(marker), scanner.readContainerHeader(pos), 0, pending.size()};
+        if(BufferScanner::exceedsItemLimit(f.header, f.is_object ? policy.max_object_items : policy.max_array_items))
+            throw parsing_exception("Maximum container items exceeded!");
+        f.remaining = f.header.item_count;
+        stack.push_back(f);
+    };
+
+    open(append(scanner.markerAt(0), 0, false, npos));
+
+    while(not stack.empty())
+    {
+        Frame& f = stack.back();
+        const byte end = static_cast<byte>(f.is_object ? Marker::Object_End : Marker::Array_End);
+
+        if(f.header.is_valid ? f.remaining == 0 : scanner.markerAt(pos) == end)
+        {
+            if(not f.header.is_valid)
+                ++pos;      //the end marker
+            Entry& e = entries[f.entry];
+            e.length = pos - e.offset;
+            e.first_child = static_cast<index_type>(children.size());
+            e.child_count = static_cast<index_type>(pending.size() - f.pending);
+            children.insert(children.end(), pending.begin() + f.pending, pending.end());
+            pending.resize(f.pending);
+            stack.pop_back();
+            continue;
+        }
+
+        std::pair<std::size_t, std::size_t> key(0, 0);
+        if(f.is_object)
+        {
+            key = scanner.readSized(pos);
+            if(key.second > std::numeric_limits<std::uint32_t>::max())
+                throw parsing_exception("Key too long to index!");
+        }
+
+        const index_type i = f.header.has_type ? append(static_cast<byte>(f.header.marker), pos, true, f.entry)
+                                               : append(scanner.markerAt(pos), pos, false, f.entry);
+        entries[i].key = key.first;
+        entries[i].key_size = static_cast<std::uint32_t>(key.second);
+        if(pending.size() > f.pending)
+            entries[pending.back()].next_sibling = i;
+        pending.push_back(i);
+        if(f.header.is_valid)
+            --f.remaining;
+
+        open(i);    //may push a frame; f is not used beyond this point
+    }
+}
@@ -0,0 +1,398 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+#include "high_precision.hpp"
+#include "exception.hpp"
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <limits>
+#include <algorithm>
+
+using namespace ubjson;
+
+/////////////////  FREE FUNCTIONS
+
+namespace {
+
+    enum Code : byte
+    {
+        Minus = 10, Plus = 11, Point = 12, Exp_Lower = 13, Exp_Upper = 14, Invalid = 0xff
+    };
+
+    const char code_to_char[] = "0123456789-+.eE";
+
+    struct CodeTable
+    {
+        byte code[256];
+        constexpr CodeTable() : code{}
+        {
+            for(auto& c : code)
+                c = Invalid;
+            for(byte i = 0; i < 15; ++i)
+                code[static_cast<byte>(code_to_char[i])] = i;
+        }
+    };
+
+    constexpr CodeTable char_to_code{};
+
+    inline bool is_digit(byte code) { return code < 10; }
+    inline bool is_exponent(byte code) { return code == Exp_Lower || code == Exp_Upper; }
+
+    //! exactly representable powers of ten
+    const double pow10[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                             1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+}
+
+//////////////// HighPrecisionNumber IMpl
+
+HighPrecisionNumber::HighPrecisionNumber() noexcept
+    : length(0), capacity(inline_capacity)
+{ }
+
+HighPrecisionNumber::HighPrecisionNumber(const char* text, std::size_t size)
+    : HighPrecisionNumber()
+{
+    append(text, size);
+    if(!isValid())
+        throw value_exception("Invalid high precision number!");
+}
+
+HighPrecisionNumber::HighPrecisionNumber(const HighPrecisionNumber& other)
+    : HighPrecisionNumber()
+{
+    reserve(other.length);
+    std::memcpy(packed(), other.packed(), (other.length + 1) / 2);
+    length = other.length;
+}
+
+HighPrecisionNumber::HighPrecisionNumber(HighPrecisionNumber&& other) noexcept
+    : length(other.length), capacity(other.capacity)
+{
+    std::memcpy(storage, other.storage, sizeof(storage));   //inline codes, or the heap pointer
+    other.length = 0;
+    other.capacity = inline_capacity;
+}
+
+HighPrecisionNumber& HighPrecisionNumber::operator = (const HighPrecisionNumber& other)
+{
+    if(this != &other)
+    {
+        length = 0;
+        reserve(other.length);
+        std::memcpy(packed(), other.packed(), (other.length + 1) / 2);
+        length = other.length;
+    }
+    return *this;
+}
+
+HighPrecisionNumber& HighPrecisionNumber::operator = (HighPrecisionNumber&& other) noexcept
+{
+    if(this != &other)
+    {
+        if(on_heap())
+            delete[] packed();
+        std::memcpy(storage, other.storage, sizeof(storage));
+        length = other.length;
+        capacity = other.capacity;
+        other.length = 0;
+        other.capacity = inline_capacity;
+    }
+    return *this;
+}
+
+HighPrecisionNumber::~HighPrecisionNumber()
+{
+    if(on_heap())
+        delete[] packed();
+}
+
+byte* HighPrecisionNumber::packed() noexcept
+{
+    if(!on_heap())
+        return storage;
+    byte* rtn;
+    std::memcpy(&rtn, storage, sizeof(rtn));
+    return rtn;
+}
+
+const byte* HighPrecisionNumber::packed() const noexcept
+{ return const_cast<HighPrecisionNumber*>(this)->packed(); }
+
+inline byte HighPrecisionNumber::code_at(std::size_t idx) const noexcept
+{
+    const byte b = packed()[idx / 2];
+    return (idx % 2 == 0) ? (b >> 4) : (b & 0x0f);
+}
+
+char HighPrecisionNumber::operator [] (std::size_t idx) const noexcept
+{ return code_to_char[code_at(idx)]; }
+
+std::size_t HighPrecisionNumber::copy(char* dest, std::size_t count, std::size_t pos) const noexcept
+{
+    if(pos >= length)
+        return 0;
+    if(count > length - pos)
+        count = length - pos;
+    for(std::size_t i = 0; i < count; ++i)
+        dest[i] = code_to_char[code_at(pos + i)];
+    return count;
+}
+
+std::string HighPrecisionNumber::str() const
+{
+    std::string rtn(length, '\0');
+    copy(&rtn[0], length);
+    return rtn;
+}
+
+void HighPrecisionNumber::reserve(std::size_t size)
+{
+    if(size <= capacity)
+        return;
+    if(size > std::numeric_limits<std::uint32_t>::max())
+        throw value_exception("High precision number is too long!");
+
+    byte* fresh = new byte[(size + 1) / 2];
+    std::memcpy(fresh, packed(), (length + 1) / 2);
+    if(on_heap())
+        delete[] packed();
+    std::memcpy(storage, &fresh, sizeof(fresh));
+    capacity = static_cast<std::uint32_t>(size);
+}
+
+void HighPrecisionNumber::append(const char* text, std::size_t size)
+{
+    if(length + size > capacity)
+        reserve(std::max<std::size_t>(length + size, 2 * capacity));
+
+    byte* p = packed();
+    for(std::size_t i = 0; i < size; ++i, ++length)
+    {
+        const byte code = char_to_code.code[static_cast<byte>(text[i])];
+        if(code == Invalid)
+            throw value_exception("Invalid character in high precision number!");
+        if(length % 2 == 0)
+            p[length / 2] = static_cast<byte>(code << 4);   //also clears the unused low nibble
+        else
+            p[length / 2] |= code;
+    }
+}
+
+//! -? (0 | [1-9][0-9]*) (.[0-9]+)? ([eE][+-]?[0-9]+)?
+bool HighPrecisionNumber::isValid() const noexcept
+{
+    std::size_t i = 0;
+    auto digits = [&]() -> std::size_t
+        {
+            const std::size_t start = i;
+            while(i < length && is_digit(code_at(i)))
+                ++i;
+            return i - start;
+        };
+
+    if(i < length && code_at(i) == Minus)
+        ++i;
+    if(i >= length)
+        return false;
+    if(code_at(i) == 0)
+        ++i;
+    else if(digits() == 0)
+        return false;
+
+    if(i < length && code_at(i) == Point)
+    {
+        ++i;
+        if(digits() == 0)
+            return false;
+    }
+    if(i < length && is_exponent(code_at(i)))
+    {
+        ++i;
+        if(i < length && (code_at(i) == Minus || code_at(i) == Plus))
+            ++i;
+        if(digits() == 0)
+            return false;
+    }
+    return i == length;
+}
+
+double HighPrecisionNumber::toDouble() const noexcept
+{
+    std::size_t i = 0;
+    const bool negative = length > 0 && code_at(0) == Minus;
+    if(negative)
+        ++i;
+
+    std::uint64_t mantissa = 0;
+    int significant = 0;
+    long exponent = 0;
+    long written_exponent = 0;
+    bool truncated = false;
+
+    for(; i < length && is_digit(code_at(i)); ++i)
+    {
+        if(significant < 19)
+        {
+            mantissa = mantissa * 10 + code_at(i);
+            significant += (mantissa != 0);
+        }
+        else
+        {
+            ++exponent;
+            truncated = truncated || code_at(i) != 0;
+        }
+    }
+    if(i < length && code_at(i) == Point)
+    {
+        for(++i; i < length && is_digit(code_at(i)); ++i)
+        {
+            if(significant < 19)
+            {
+                mantissa = mantissa * 10 + code_at(i);
+                significant += (mantissa != 0);
+                --exponent;
+            }
+            else
+                truncated = truncated || code_at(i) != 0;
+        }
+    }
+    if(i < length && is_exponent(code_at(i)))
+    {
+        ++i;
+        const bool negative_exp = i < length && code_at(i) == Minus;
+        if(i < length && (code_at(i) == Minus || code_at(i) == Plus))
+            ++i;
+        long e = 0;
+        for(; i < length && is_digit(code_at(i)); ++i)
+            if(e < 100000)
+                e = e * 10 + code_at(i);
+        written_exponent = negative_exp ? -e : e;
+        exponent += written_exponent;
+    }
+
+    if(mantissa == 0 && !truncated)
+        return negative ? -0.0 : 0.0;
+
+    //Clinger's fast path: both the mantissa and the power of ten are exact doubles
+    if(!truncated && mantissa <= (std::uint64_t(1) << 53) && -22 <= exponent && exponent <= 22)
+    {
+        double rtn = static_cast<double>(mantissa);
+        rtn = exponent < 0 ? rtn / pow10[-exponent] : rtn * pow10[exponent];
+        return negative ? -rtn : rtn;
+    }
+
+    /*
+     * std::strtod is given the significant digits and an exponent, in a buffer on the stack. Beyond
+     * max_digits of them, the digits can't move the result past the midpoint between two doubles;
+     * all that matters is whether any is nonzero, which a single '1' in their place tells strtod
+     */
+    constexpr std::size_t max_digits = 768;
+    char text[max_digits + 32];
+    std::size_t n = 0;
+    if(negative)
+        text[n++] = '-';
+    long scale = 0;     //the power of ten the digits in text are to be multiplied by
+    bool point = false, dropped = false;
+    for(i = negative; i < length; ++i)
+    {
+        const byte code = code_at(i);
+        if(code == Point)
+            point = true;
+        else if(!is_digit(code))
+            break;
+        else if(n == negative && code == 0)     //a leading zero
+            scale -= point;
+        else if(n - negative < max_digits)
+        {
+            text[n++] = static_cast<char>('0' + code);
+            scale -= point;
+        }
+        else
+        {
+            dropped = dropped || code != 0;
+            scale += !point;
+        }
+    }
+    if(dropped)
+    {
+        text[n++] = '1';
+        --scale;
+    }
+    std::snprintf(text + n, sizeof(text) - n, "e%ld", scale + written_exponent);
+    return std::strtod(text, nullptr);
+}
+
+bool HighPrecisionNumber::toUint64(unsigned long long& out) const noexcept
+{
+    using limit = std::numeric_limits<unsigned long long>;
+    if(length == 0)
+        return false;
+
+    unsigned long long rtn = 0;
+    for(std::size_t i = 0; i < length; ++i)
+    {
+        const byte code = code_at(i);
+        if(!is_digit(code) || rtn > (limit::max() - code) / 10)
+            return false;
+        rtn = rtn * 10 + code;
+    }
+    out = rtn;
+    return true;
+}
+
+bool HighPrecisionNumber::toInt64(long long& out) const noexcept
+{
+    using limit = std::numeric_limits<long long>;
+    const bool negative = length > 0 && code_at(0) == Minus;
+    const unsigned long long max_magnitude = negative ? 1ull + limit::max() : limit::max();
+
+    unsigned long long magnitude = 0;
+    std::size_t i = negative ? 1 : 0;
+    if(i == length)
+        return false;
+    for(; i < length; ++i)
+    {
+        const byte code = code_at(i);
+        if(!is_digit(code) || magnitude > (max_magnitude - code) / 10)
+            return false;
+        magnitude = magnitude * 10 + code;
+    }
+    out = negative ? static_cast<long long>(0 - magnitude) : static_cast<long long>(magnitude);
+    return true;
+}
+
+/////////////////////// FREE OPERATORS ////////////
+
+namespace ubjson {
+
+    bool operator == (const HighPrecisionNumber& lhs, const HighPrecisionNumber& rhs) noexcept
+    {
+        return lhs.length == rhs.length &&
+                std::memcmp(lhs.packed(), rhs.packed(), (lhs.length + 1) / 2) == 0;
+    }
+
+    bool operator != (const HighPrecisionNumber& lhs, const HighPrecisionNumber& rhs) noexcept
+    {
+        return !(lhs == rhs);
+    }
+
+    std::ostream& operator << (std::ostream& os, const HighPrecisionNumber& number)
+    {
+        char buffer[64];
+        for(std::size_t pos = 0; pos < number.size(); pos += sizeof(buffer))
+            os.write(buffer, number.copy(buffer, sizeof(buffer), pos));
+        return os;
+    }
+
+}   //end namespace ubjson
@@ -0,0 +1,628 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+#include "json_reader.hpp"
+#include "utf8.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace ubjson;
+
+/////////////////  FREE FUNCTIONS
+
+namespace {
+
+    enum : byte { Op = 1, Space = 2, Quote = 4, Backslash = 8 };
+
+    //! what each byte is to the structural index; bytes with no kind are parts of numbers, literals or garbage
+    struct CharTable
+    {
+        byte kind[256];
+        constexpr CharTable() : kind{}
+        {
+            kind[static_cast<byte>('{')] = kind[static_cast<byte>('}')] = Op;
+            kind[static_cast<byte>('[')] = kind[static_cast<byte>(']')] = Op;
+            kind[static_cast<byte>(':')] = kind[static_cast<byte>(',')] = Op;
+            kind[static_cast<byte>(' ')] = kind[static_cast<byte>('\t')] = Space;
+            kind[static_cast<byte>('\n')] = kind[static_cast<byte>('\r')] = Space;
+            kind[static_cast<byte>('"')] = Quote;
+            kind[static_cast<byte>('\\')] = Backslash;
+        }
+    };
+
+    constexpr CharTable char_table{};
+
+    //! whether \a c would continue a number or literal, rather than end it
+    inline bool is_scalar_byte(char c) noexcept
+    { return (char_table.kind[static_cast<byte>(c)] & (Op | Space | Quote)) == 0; }
+
+    //! one bit per byte of a 64 byte block
+    struct BlockMasks
+    {
+        uint64_t quote;
+        uint64_t backslash;
+        uint64_t op;
+        uint64_t space;
+    };
+
+#ifdef __SSE2__
+    BlockMasks classify(const char* block) noexcept
+    {
+        BlockMasks m{ 0, 0, 0, 0 };
+        for(int k = 0; k < 4; ++k)
+        {
+            const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * k));
+            auto eq = [&](char c) { return _mm_cmpeq_epi8(in, _mm_set1_epi8(c)); };
+            auto bits = [&](__m128i v) { return static_cast<uint64_t>(static_cast<unsigned>(_mm_movemask_epi8(v))) << (16 * k); };
+
+            //'[' and ']' are '{' and '}' with bit 5 clear
+            const __m128i folded = _mm_or_si128(in, _mm_set1_epi8(0x20));
+            const __m128i op = _mm_or_si128(
+                        _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')), _mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))),
+                        _mm_or_si128(eq(':'), eq(',')));
+            const __m128i space = _mm_or_si128(_mm_or_si128(eq(' '), eq('\t')), _mm_or_si128(eq('\n'), eq('\r')));
+
+            m.quote |= bits(eq('"'));
+            m.backslash |= bits(eq('\\'));
+            m.op |= bits(op);
+            m.space |= bits(space);
+        }
+        return m;
+    }
+#else
+    BlockMasks classify(const char* block) noexcept
+    {
+        BlockMasks m{ 0, 0, 0, 0 };
+        for(int i = 0; i < 64; ++i)
+        {
+            const byte kind = char_table.kind[static_cast<byte>(block[i])];
+            const uint64_t bit = uint64_t(1) << i;
+            if(kind & Quote)        m.quote |= bit;
+            if(kind & Backslash)    m.backslash |= bit;
+            if(kind & Op)           m.op |= bit;
+            if(kind & Space)        m.space |= bit;
+        }
+        return m;
+    }
+#endif
+
+    //! bit i of the result is the XOR of bits 0 to i of \a x
+    inline uint64_t prefix_xor(uint64_t x) noexcept
+    {
+        x ^= x << 1;
+        x ^= x << 2;
+        x ^= x << 4;
+        x ^= x << 8;
+        x ^= x << 16;
+        x ^= x << 32;
+        return x;
+    }
+
+    inline int hex_value(char c) noexcept
+    {
+        if(c >= '0' and c <= '9') return c - '0';
+        if(c >= 'a' and c <= 'f') return c - 'a' + 10;
+        if(c >= 'A' and c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    //! the four hex digits at \a p, or -1
+    inline long read_hex4(const char* p) noexcept
+    {
+        long rtn = 0;
+        for(int i = 0; i < 4; ++i)
+        {
+            const int h = hex_value(p[i]);
+            if(h < 0)
+                return -1;
+            rtn = (rtn << 4) | h;
+        }
+        return rtn;
+    }
+
+    void append_utf8(std::string& out, unsigned long cp)
+    {
+        char u[4];
+        std::size_t n;
+        if(cp < 0x80)
+        {
+            u[0] = static_cast<char>(cp);
+            n = 1;
+        }
+        else if(cp < 0x800)
+        {
+            u[0] = static_cast<char>(0xC0 | (cp >> 6));
+            u[1] = static_cast<char>(0x80 | (cp & 0x3F));
+            n = 2;
+        }
+        else if(cp < 0x10000)
+        {
+            u[0] = static_cast<char>(0xE0 | (cp >> 12));
+            u[1] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            u[2] = static_cast<char>(0x80 | (cp & 0x3F));
+            n = 3;
+        }
+        else
+        {
+            u[0] = static_cast<char>(0xF0 | (cp >> 18));
+            u[1] = static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            u[2] = static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            u[3] = static_cast<char>(0x80 | (cp & 0x3F));
+            n = 4;
+        }
+        out.append(u, n);
+    }
+
+    //! powers of ten a double holds exactly
+    const double exact_powers_of_10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    constexpr uint64_t max_exact_mantissa = uint64_t(1) << 53;
+
+}
+
+
+Value JsonReader::parse(const char* text, std::size_t size)
+{
+    if(size > vsz.max_object_size)
+        throw parsing_exception("Maximum Object size exceeded!");
+    if(size >= std::numeric_limits<uint32_t>::max())
+        throw parsing_exception("JSON text too large!");
+
+    index(text, size);
+    doc = text;
+    doc_size = size;
+    cursor = structurals.data();
+
+    Value rtn;
+    parse_value(rtn, 0);
+    if(*cursor != size)
+        throw parsing_exception("Unexpected characters after the JSON value!");
+    return rtn;
+}
+
+//////////////// PRIVATE ////////////////
+/////////////////////////////////////////
+
+/*!
+ * \brief records the position of every structural character of \a text, then \a size as a sentinel.
+ * Quotes escaped by an odd run of backslashes are not quotes; everything between a quote and the
+ * next one is inside a string, and only the opening quote is recorded. Outside strings, the bytes that
+ * are neither operators nor whitespace are numbers and literals, and the first byte of each run is recorded
+ */
+void JsonReader::index(const char* text, std::size_t size)
+{
+    structurals.clear();
+
+    uint64_t escape_carry = 0, in_string_carry = 0, scalar_carry = 0;
+    for(std::size_t base = 0; base < size; base += 64)
+    {
+        const char* block = text + base;
+        char tail[64];
+        if(size - base < 64)
+        {
+            std::memset(tail, ' ', sizeof(tail));
+            std::memcpy(tail, block, size - base);
+            block = tail;
+        }
+        const BlockMasks m = classify(block);
+
+        //backslashes are rare; each one that isn't escaped itself escapes the next byte
+        uint64_t escaped = escape_carry;
+        escape_carry = 0;
+        for(uint64_t bits = m.backslash; bits; bits &= bits - 1)
+        {
+            const int i = __builtin_ctzll(bits);
+            if((escaped >> i) & 1)
+                continue;
+            if(i == 63)
+                escape_carry = 1;
+            else
+                escaped |= uint64_t(1) << (i + 1);
+        }
+
+        const uint64_t quotes = m.quote & ~escaped;
+        const uint64_t in_string = prefix_xor(quotes) ^ in_string_carry;      //with the opening quote, without the closing
+        in_string_carry = static_cast<uint64_t>(static_cast<int64_t>(in_string) >> 63);
+        const uint64_t strings = in_string | quotes;
+
+        const uint64_t scalar = ~(m.op | m.space | strings);
+        const uint64_t scalar_starts = scalar & ~((scalar << 1) | scalar_carry);
+        scalar_carry = scalar >> 63;
+
+        uint64_t found = (m.op & ~strings) | (quotes & in_string) | scalar_starts;
+        const std::size_t at = structurals.size();
+        structurals.resize(at + static_cast<std::size_t>(__builtin_popcountll(found)));
+        for(uint32_t* out = structurals.data() + at; found; found &= found - 1)
+            *out++ = static_cast<uint32_t>(base + static_cast<std::size_t>(__builtin_ctzll(found)));
+    }
+
+    if(in_string_carry)
+        throw parsing_exception("Unterminated string in JSON text!");
+    structurals.push_back(static_cast<uint32_t>(size));
+}
+
+char JsonReader::next_structural() noexcept
+{
+    const uint32_t pos = *cursor;
+    if(pos == doc_size)
+        return '\0';        //the sentinel stays, so every later read fails the same way
+    ++cursor;
+    return doc[pos];
+}
+
+void JsonReader::parse_value(Value& v, std::size_t depth)
+{
+    const uint32_t pos = *cursor;
+    switch (next_structural()) {
+    case '{':
+        parse_object(v, depth);
+        break;
+    case '[':
+        parse_array(v, depth);
+        break;
+    case '"':
+        v.construct_fromString(std::string());
+        v.vtype = Type::String;
+        parse_string(pos + 1, v.value.String);
+        break;
+    case 't':
+    case 'f':
+    case 'n':
+        parse_literal(v, pos);
+        break;
+    case '-': case '0': case '1': case '2': case '3': case '4':
+    case '5': case '6': case '7': case '8': case '9':
+        parse_number(v, pos);
+        break;
+    case '\0':
+        if(pos == doc_size)
+            throw parsing_exception("Unexpected end of JSON text!");
+        //fall through
+    default:
+        throw parsing_exception("Unexpected character in JSON text!");
+    }
+}
+
+void JsonReader::parse_object(Value& v, std::size_t depth)
+{
+    if(depth >= vsz.max_value_depth)
+        throw parsing_exception("Maximum Parsing depth Exceeded!");
+
+    v.construct_fromMap(Value::MapType());
+    v.vtype = Type::Map;
+    if(*cursor != doc_size and doc[*cursor] == '}')
+    {
+        ++cursor;
+        return;
+    }
+
+    for(;;)
+    {
+        const uint32_t pos = *cursor;
+        if(next_structural() != '"')
+            throw parsing_exception("Expected a key in JSON object!");
+        key.clear();
+        parse_string(pos + 1, key);
+        if(next_structural() != ':')
+            throw parsing_exception("Expected ':' after a key in JSON object!");
+
+        Value::Uptr& slot = v.modify_map()[key];
+        if(slot)
+            *slot = Value();
+        else
+            slot = std::make_unique<Value>();
+        parse_value(*slot, depth + 1);
+
+        const char c = next_structural();
+        if(c == '}')
+            return;
+        if(c != ',')
+            throw parsing_exception("Expected ',' or '}' in JSON object!");
+    }
+}
+
+void JsonReader::parse_array(Value& v, std::size_t depth)
+{
+    if(depth >= vsz.max_value_depth)
+        throw parsing_exception("Maximum Parsing depth Exceeded!");
+
+    v.construct_fromArray(Value::ArrayType());
+    v.vtype = Type::Array;
+    if(*cursor != doc_size and doc[*cursor] == ']')
+    {
+        ++cursor;
+        return;
+    }
+
+    auto& items = v.modify_array();
+    for(;;)
+    {
+        items.emplace_back(std::make_unique<Value>());
+        parse_value(*items.back(), depth + 1);
+
+        const char c = next_structural();
+        if(c == ']')
+            return;
+        if(c != ',')
+            throw parsing_exception("Expected ',' or ']' in JSON array!");
+    }
+}
+
+void JsonReader::parse_string(std::size_t pos, std::string& out)
+{
+    const std::size_t begin = out.size();
+    if(not unescape(doc + pos, doc + doc_size, out))
+        throw parsing_exception("Unterminated string in JSON text!");
+    check_string(vsz, out.data() + begin, out.size() - begin);
+}
+
+/*!
+ * \brief appends the unescaped string that starts at \a p, just past its opening quote, to \a out.
+ * Runs of bytes that need no unescaping are appended whole; with SSE2, the runs are found 16 bytes at a time
+ * \return the closing quote, or \c nullptr if \a last comes first
+ */
+const char* JsonReader::unescape(const char* p, const char* last, std::string& out)
+{
+    const char* run = p;
+    for(;;)
+    {
+#ifdef __SSE2__
+        const __m128i quote = _mm_set1_epi8('"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i control = _mm_set1_epi8(0x1f);
+        while(last - p >= 16)
+        {
+            const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            const __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(in, quote), _mm_cmpeq_epi8(in, backslash)),
+                                                 _mm_cmpeq_epi8(_mm_max_epu8(in, control), control));
+            const int mask = _mm_movemask_epi8(special);
+            if(mask != 0)
+            {
+                p += __builtin_ctz(static_cast<unsigned>(mask));
+                break;
+            }
+            p += 16;
+        }
+#endif
+        while(p < last and *p != '"' and *p != '\\' and static_cast<byte>(*p) >= 0x20)
+            ++p;
+        if(p == last)
+            return nullptr;
+
+        out.append(run, p - run);
+        if(*p == '"')
+            return p;
+        if(*p != '\\')
+            throw parsing_exception("Unescaped control character in JSON string!");
+
+        if(last - p < 2)
+            return nullptr;
+        switch (p[1]) {
+        case '"':   out.push_back('"');  break;
+        case '\\':  out.push_back('\\'); break;
+        case '/':   out.push_back('/');  break;
+        case 'b':   out.push_back('\b'); break;
+        case 'f':   out.push_back('\f'); break;
+        case 'n':   out.push_back('\n'); break;
+        case 'r':   out.push_back('\r'); break;
+        case 't':   out.push_back('\t'); break;
+        case 'u':
+        {
+            if(last - p < 6)
+                return nullptr;
+            long cp = read_hex4(p + 2);
+            if(cp >= 0xDC00 and cp <= 0xDFFF)
+                cp = -1;        //a lone low surrogate
+            else if(cp >= 0xD800 and cp <= 0xDBFF)
+            {
+                //must pair with a low surrogate; wait for it while what there is of it may be one
+                const std::ptrdiff_t more = last - p - 6;
+                if(more < 6 and (more == 0 or (p[6] == '\\' and (more == 1 or p[7] == 'u'))))
+                    return nullptr;
+                const long low = more >= 6 and p[6] == '\\' and p[7] == 'u' ? read_hex4(p + 8) : -1;
+                if(low < 0xDC00 or low > 0xDFFF)
+                    cp = -1;
+                else
+                {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    p += 6;
+                }
+            }
+            if(cp < 0)
+                throw parsing_exception("Invalid \\u escape in JSON string!");
+            append_utf8(out, static_cast<unsigned long>(cp));
+            p += 4;
+            break;
+        }
+        default:
+            throw parsing_exception("Invalid escape in JSON string!");
+        }
+        p += 2;
+        run = p;
+    }
+}
+
+//! throws if the unescaped string or key \a str breaks \a policy
+void JsonReader::check_string(const ValueSizePolicy& policy, const char* str, std::size_t size)
+{
+    if(size > policy.max_string_size)
+        throw parsing_exception("Maximum String size exceeded!");
+    if(policy.validate_utf8 and validateUtf8(str, size) != size)
+        throw parsing_exception("Invalid UTF-8 encountered!");
+}
+
+void JsonReader::parse_literal(Value& v, std::size_t pos)
+{
+    auto is = [&](const char* literal, std::size_t n)
+        {
+            return doc_size - pos >= n and std::memcmp(doc + pos, literal, n) == 0 and
+                    (pos + n == doc_size or not is_scalar_byte(doc[pos + n]));
+        };
+
+    if(is("true", 4))
+        v.value.Bool = true;
+    else if(is("false", 5))
+        v.value.Bool = false;
+    else if(is("null", 4))
+        return;
+    else
+        throw parsing_exception("Invalid literal in JSON text!");
+    v.vtype = Type::Bool;
+}
+
+void JsonReader::parse_number(Value& v, std::size_t pos)
+{
+    read_number(doc + pos, doc + doc_size, v);
+}
+
+/*!
+ * \brief parses the number at \a first into \a v, which must be null; it must end at \a last or at a
+ * byte that can't be part of it. Integers are accumulated exactly; a fraction or an exponent makes a Float,
+ * computed exactly when the digits and the power of ten both fit a double, else left to strtod()
+ * \return the end of the number
+ */
+const char* JsonReader::read_number(const char* first, const char* last, Value& v)
+{
+    const char* p = first;
+    auto is_digit = [&](const char* c) { return c < last and *c >= '0' and *c <= '9'; };
+
+    const bool negative = *p == '-';
+    if(negative)
+        ++p;
+    if(not is_digit(p))
+        throw parsing_exception("Invalid number in JSON text!");
+
+    uint64_t mantissa = 0;
+    bool overflow = false;
+    long exponent = 0;
+    auto accumulate = [&](char c)
+        {
+            const unsigned d = static_cast<unsigned>(c - '0');
+            if(mantissa > (std::numeric_limits<uint64_t>::max() - d) / 10)
+                overflow = true;
+            else
+                mantissa = mantissa * 10 + d;
+        };
+
+    if(*p == '0')
+        ++p;
+    else
+        for(; is_digit(p); ++p)
+            accumulate(*p);
+
+    bool is_float = false;
+    if(p < last and *p == '.')
+    {
+        is_float = true;
+        if(not is_digit(++p))
+            throw parsing_exception("Invalid number in JSON text!");
+        for(; is_digit(p); ++p)
+            if(not overflow)
+            {
+                accumulate(*p);
+                if(not overflow)
+                    --exponent;
+            }
+    }
+    if(p < last and (*p == 'e' or *p == 'E'))
+    {
+        is_float = true;
+        ++p;
+        const bool negative_exponent = p < last and *p == '-';
+        if(p < last and (*p == '-' or *p == '+'))
+            ++p;
+        if(not is_digit(p))
+            throw parsing_exception("Invalid number in JSON text!");
+        long e = 0;
+        for(; is_digit(p); ++p)
+            if(e < 100000)
+                e = e * 10 + (*p - '0');
+        exponent += negative_exponent ? -e : e;
+    }
+    if(p < last and is_scalar_byte(*p))
+        throw parsing_exception("Invalid number in JSON text!");
+
+    const std::size_t length = static_cast<std::size_t>(p - first);
+    if(not is_float and not overflow)
+    {
+        constexpr uint64_t max_signed = static_cast<uint64_t>(std::numeric_limits<long long>::max());
+        if(negative and mantissa <= max_signed + 1)
+        {
+            v.value.SignedInt = mantissa == max_signed + 1 ? std::numeric_limits<long long>::min()
+                                                           : -static_cast<long long>(mantissa);
+            v.vtype = Type::SignedInt;
+            return p;
+        }
+        if(not negative)
+        {
+            if(mantissa <= max_signed)
+            {
+                v.value.SignedInt = static_cast<long long>(mantissa);
+                v.vtype = Type::SignedInt;
+            }
+            else
+            {
+                v.value.UnsignedInt = mantissa;
+                v.vtype = Type::UnsignedInt;
+            }
+            return p;
+        }
+    }
+
+    if(is_float)
+    {
+        double d;
+        if(not overflow and mantissa <= max_exact_mantissa and exponent >= -22 and exponent <= 22)
+        {
+            //both operands are exact, so the one rounding of the product or quotient is the correct one
+            d = static_cast<double>(mantissa);
+            d = exponent < 0 ? d / exact_powers_of_10[-exponent] : d * exact_powers_of_10[exponent];
+            if(negative)
+                d = -d;
+        }
+        else
+        {
+            char buffer[64];
+            std::string spill;
+            const char* text = buffer;
+            if(length < sizeof(buffer))
+            {
+                std::memcpy(buffer, first, length);
+                buffer[length] = '\0';
+            }
+            else
+                text = (spill.assign(first, length)).c_str();
+            d = std::strtod(text, nullptr);
+        }
+        if(std::isfinite(d))
+        {
+            v.value.Float = d;
+            v.vtype = Type::Float;
+            return p;
+        }
+    }
+
+    //too large for any of them
+    v.construct_fromHighPrecision(Value::HighPrecisionType(first, length));
+    v.vtype = Type::HighPrecision;
+    return p;
+}
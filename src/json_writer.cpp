@@ -0,0 +1,636 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+#include "json_writer.hpp"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace ubjson;
+
+/////////////////  FREE FUNCTIONS
+
+namespace {
+
+    //! how each byte of a string is escaped: 0 for not at all, 'u' for \\u00XX, else the character after the backslash
+    struct EscapeTable
+    {
+        char escape[256];
+        constexpr EscapeTable() : escape{}
+        {
+            for(int c = 0; c < 0x20; ++c)
+                escape[c] = 'u';
+            escape[static_cast<byte>('\b')] = 'b';
+            escape[static_cast<byte>('\f')] = 'f';
+            escape[static_cast<byte>('\n')] = 'n';
+            escape[static_cast<byte>('\r')] = 'r';
+            escape[static_cast<byte>('\t')] = 't';
+            escape[static_cast<byte>('"')]  = '"';
+            escape[static_cast<byte>('\\')] = '\\';
+        }
+    };
+
+    constexpr EscapeTable escape_table{};
+
+    const char hex_digits[] = "0123456789abcdef";
+
+    const char digit_pairs[] =
+            "00010203040506070809"
+            "10111213141516171819"
+            "20212223242526272829"
+            "30313233343536373839"
+            "40414243444546474849"
+            "50515253545556575859"
+            "60616263646566676869"
+            "70717273747576777879"
+            "80818283848586878889"
+            "90919293949596979899";
+
+    //! integral doubles below this are written through the integer path
+    constexpr double max_exact_integral = 9007199254740992.0;     //2^53
+
+    /*
+     * Shortest round trip doubles, by Grisu2 (Florian Loitsch, "Printing Floating-Point Numbers Quickly
+     * and Accurately with Integers", PLDI 2010). The double and the bounds of its rounding interval are
+     * scaled by a cached power of ten into a range where 64 bit integer arithmetic can generate the
+     * digits; the digits stop as soon as they identify the double. The result always reads back exactly,
+     * and is the shortest such result for all but a tiny fraction of doubles
+     */
+
+    //! a floating point number f * 2^e, with a 64 bit significand
+    struct DiyFp
+    {
+        uint64_t f;
+        int e;
+
+        DiyFp operator - (const DiyFp& rhs) const { return { f - rhs.f, e }; }
+
+        //! the product, rounded to 64 bits
+        DiyFp operator * (const DiyFp& rhs) const
+        {
+            const uint64_t mask = 0xffffffffU;
+            const uint64_t a = f >> 32, b = f & mask, c = rhs.f >> 32, d = rhs.f & mask;
+            const uint64_t ac = a * c, bc = b * c, ad = a * d, bd = b * d;
+            const uint64_t mid = (bd >> 32) + (ad & mask) + (bc & mask) + (1U << 31);
+            return { ac + (ad >> 32) + (bc >> 32) + (mid >> 32), e + rhs.e + 64 };
+        }
+
+        DiyFp normalized() const
+        {
+            const int shift = __builtin_clzll(f);
+            return { f << shift, e - shift };
+        }
+    };
+
+    constexpr uint64_t hidden_bit = 0x0010000000000000ULL;
+    constexpr uint64_t significand_mask = 0x000FFFFFFFFFFFFFULL;
+
+    //! \a d, which must be finite and positive
+    DiyFp to_diyfp(double d)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &d, sizeof(d));
+        const int biased_exponent = static_cast<int>(bits >> 52);
+        const uint64_t significand = bits & significand_mask;
+        if(biased_exponent != 0)
+            return { significand + hidden_bit, biased_exponent - 1075 };
+        return { significand, -1074 };      //subnormal
+    }
+
+    //! the normalized upper bound of the rounding interval of \a v; \a minus gets the lower, at the same exponent
+    DiyFp boundaries(const DiyFp& v, DiyFp& minus)
+    {
+        const DiyFp plus = DiyFp{ (v.f << 1) + 1, v.e - 1 }.normalized();
+        //the interval is lopsided below a power of two
+        minus = v.f == hidden_bit ? DiyFp{ (v.f << 2) - 1, v.e - 2 } : DiyFp{ (v.f << 1) - 1, v.e - 1 };
+        minus.f <<= minus.e - plus.e;
+        minus.e = plus.e;
+        return plus;
+    }
+
+    //! normalized 10^k, for k = -348, -340, ... 340
+    const DiyFp cached_powers[] = {
+        { 0xfa8fd5a0081c0288, -1220 }, { 0xbaaee17fa23ebf76, -1193 }, { 0x8b16fb203055ac76, -1166 },
+        { 0xcf42894a5dce35ea, -1140 }, { 0x9a6bb0aa55653b2d, -1113 }, { 0xe61acf033d1a45df, -1087 },
+        { 0xab70fe17c79ac6ca, -1060 }, { 0xff77b1fcbebcdc4f, -1034 }, { 0xbe5691ef416bd60c, -1007 },
+        { 0x8dd01fad907ffc3c, -980 }, { 0xd3515c2831559a83, -954 }, { 0x9d71ac8fada6c9b5, -927 },
+        { 0xea9c227723ee8bcb, -901 }, { 0xaecc49914078536d, -874 }, { 0x823c12795db6ce57, -847 },
+        { 0xc21094364dfb5637, -821 }, { 0x9096ea6f3848984f, -794 }, { 0xd77485cb25823ac7, -768 },
+        { 0xa086cfcd97bf97f4, -741 }, { 0xef340a98172aace5, -715 }, { 0xb23867fb2a35b28e, -688 },
+        { 0x84c8d4dfd2c63f3b, -661 }, { 0xc5dd44271ad3cdba, -635 }, { 0x936b9fcebb25c996, -608 },
+        { 0xdbac6c247d62a584, -582 }, { 0xa3ab66580d5fdaf6, -555 }, { 0xf3e2f893dec3f126, -529 },
+        { 0xb5b5ada8aaff80b8, -502 }, { 0x87625f056c7c4a8b, -475 }, { 0xc9bcff6034c13053, -449 },
+        { 0x964e858c91ba2655, -422 }, { 0xdff9772470297ebd, -396 }, { 0xa6dfbd9fb8e5b88f, -369 },
+        { 0xf8a95fcf88747d94, -343 }, { 0xb94470938fa89bcf, -316 }, { 0x8a08f0f8bf0f156b, -289 },
+        { 0xcdb02555653131b6, -263 }, { 0x993fe2c6d07b7fac, -236 }, { 0xe45c10c42a2b3b06, -210 },
+        { 0xaa242499697392d3, -183 }, { 0xfd87b5f28300ca0e, -157 }, { 0xbce5086492111aeb, -130 },
+        { 0x8cbccc096f5088cc, -103 }, { 0xd1b71758e219652c, -77 }, { 0x9c40000000000000, -50 },
+        { 0xe8d4a51000000000, -24 }, { 0xad78ebc5ac620000, 3 }, { 0x813f3978f8940984, 30 },
+        { 0xc097ce7bc90715b3, 56 }, { 0x8f7e32ce7bea5c70, 83 }, { 0xd5d238a4abe98068, 109 },
+        { 0x9f4f2726179a2245, 136 }, { 0xed63a231d4c4fb27, 162 }, { 0xb0de65388cc8ada8, 189 },
+        { 0x83c7088e1aab65db, 216 }, { 0xc45d1df942711d9a, 242 }, { 0x924d692ca61be758, 269 },
+        { 0xda01ee641a708dea, 295 }, { 0xa26da3999aef774a, 322 }, { 0xf209787bb47d6b85, 348 },
+        { 0xb454e4a179dd1877, 375 }, { 0x865b86925b9bc5c2, 402 }, { 0xc83553c5c8965d3d, 428 },
+        { 0x952ab45cfa97a0b3, 455 }, { 0xde469fbd99a05fe3, 481 }, { 0xa59bc234db398c25, 508 },
+        { 0xf6c69a72a3989f5c, 534 }, { 0xb7dcbf5354e9bece, 561 }, { 0x88fcf317f22241e2, 588 },
+        { 0xcc20ce9bd35c78a5, 614 }, { 0x98165af37b2153df, 641 }, { 0xe2a0b5dc971f303a, 667 },
+        { 0xa8d9d1535ce3b396, 694 }, { 0xfb9b7cd9a4a7443c, 720 }, { 0xbb764c4ca7a44410, 747 },
+        { 0x8bab8eefb6409c1a, 774 }, { 0xd01fef10a657842c, 800 }, { 0x9b10a4e5e9913129, 827 },
+        { 0xe7109bfba19c0c9d, 853 }, { 0xac2820d9623bf429, 880 }, { 0x80444b5e7aa7cf85, 907 },
+        { 0xbf21e44003acdd2d, 933 }, { 0x8e679c2f5e44ff8f, 960 }, { 0xd433179d9c8cb841, 986 },
+        { 0x9e19db92b4e31ba9, 1013 }, { 0xeb96bf6ebadf77d9, 1039 }, { 0xaf87023b9bf0ee6b, 1066 },
+    };
+
+    //! the cached power that brings a number with binary exponent \a e near 2^-60; \a k gets its negated decimal exponent
+    DiyFp cached_power(int e, int& k)
+    {
+        const double dk = (-61 - e) * 0.30102999566398114 + 347;     //log10(2)
+        int ik = static_cast<int>(dk);
+        if(dk - ik > 0.0)
+            ++ik;
+        const unsigned index = static_cast<unsigned>((ik >> 3) + 1);
+        k = -(-348 + static_cast<int>(index) * 8);
+        return cached_powers[index];
+    }
+
+    const uint64_t powers_of_10[] = {
+        1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+        10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL,
+        1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL,
+        10000000000000000000ULL
+    };
+
+    //! moves the last digit down while that brings the digits closer to the exact value and still inside the interval
+    void round_weed(char* digits, int length, uint64_t delta, uint64_t rest, uint64_t ten_kappa, uint64_t distance)
+    {
+        while(rest < distance and delta - rest >= ten_kappa and
+              (rest + ten_kappa < distance or distance - rest > rest + ten_kappa - distance))
+        {
+            digits[length - 1]--;
+            rest += ten_kappa;
+        }
+    }
+
+    int count_digits(uint32_t n)
+    {
+        int count = 1;
+        while(count < 10 and n >= powers_of_10[count])
+            ++count;
+        return count;
+    }
+
+    /*!
+     * \brief generates the digits of \a upper until they fall within \a delta of it
+     * \return the number of digits; \a k is adjusted so the value is digits * 10^k
+     */
+    int generate_digits(const DiyFp& w, const DiyFp& upper, uint64_t delta, char* digits, int& k)
+    {
+        const int shift = -upper.e;
+        const uint64_t one = uint64_t(1) << shift;
+        const uint64_t distance = (upper - w).f;
+        uint32_t integral = static_cast<uint32_t>(upper.f >> shift);
+        uint64_t fraction = upper.f & (one - 1);
+        int kappa = count_digits(integral);
+        int length = 0;
+
+        while(kappa > 0)
+        {
+            const uint32_t p = static_cast<uint32_t>(powers_of_10[kappa - 1]);
+            const uint32_t d = integral / p;
+            integral %= p;
+            if(d or length)
+                digits[length++] = static_cast<char>('0' + d);
+            --kappa;
+            const uint64_t rest = (static_cast<uint64_t>(integral) << shift) + fraction;
+            if(rest <= delta)
+            {
+                k += kappa;
+                round_weed(digits, length, delta, rest, powers_of_10[kappa] << shift, distance);
+                return length;
+            }
+        }
+
+        for(;;)
+        {
+            fraction *= 10;
+            delta *= 10;
+            const char d = static_cast<char>(fraction >> shift);
+            if(d or length)
+                digits[length++] = static_cast<char>('0' + d);
+            fraction &= one - 1;
+            --kappa;
+            if(fraction < delta)
+            {
+                k += kappa;
+                //past 10^19 the distance is too small to matter
+                round_weed(digits, length, delta, fraction, one, -kappa < 20 ? distance * powers_of_10[-kappa] : 0);
+                return length;
+            }
+        }
+    }
+
+    //! the shortest digits of \a d, which must be finite and positive; the value is digits * 10^k
+    int grisu2(double d, char* digits, int& k)
+    {
+        const DiyFp v = to_diyfp(d);
+        DiyFp minus;
+        const DiyFp plus = boundaries(v, minus);
+        const DiyFp c_mk = cached_power(plus.e, k);
+
+        const DiyFp w = v.normalized() * c_mk;
+        DiyFp upper = plus * c_mk, lower = minus * c_mk;
+        ++lower.f;      //stay inside the interval despite the rounding of the products
+        --upper.f;
+        return generate_digits(w, upper, upper.f - lower.f, digits, k);
+    }
+
+    /*!
+     * \brief lays out \a length \a digits times 10^\a k at \a p, as plain decimals when the exponent
+     * is modest, else in exponent form. A '.' or an 'e' is always there, so it reads back as a float
+     * \return the end of the text
+     */
+    char* layout_digits(char* p, const char* digits, int length, int k)
+    {
+        const int point = length + k;       //where the decimal point goes, counted from the first digit
+        if(k >= 0 and point <= 21)
+        {
+            std::memcpy(p, digits, length);
+            std::memset(p + length, '0', k);
+            p += point;
+            *p++ = '.';
+            *p++ = '0';
+        }
+        else if(point > 0 and point <= 21)
+        {
+            std::memcpy(p, digits, point);
+            p[point] = '.';
+            std::memcpy(p + point + 1, digits + point, length - point);
+            p += length + 1;
+        }
+        else if(point > -6 and point <= 0)
+        {
+            *p++ = '0';
+            *p++ = '.';
+            std::memset(p, '0', -point);
+            std::memcpy(p - point, digits, length);
+            p += length - point;
+        }
+        else
+        {
+            *p++ = digits[0];
+            if(length > 1)
+            {
+                *p++ = '.';
+                std::memcpy(p, digits + 1, length - 1);
+                p += length - 1;
+            }
+            *p++ = 'e';
+            int exponent = point - 1;
+            if(exponent < 0)
+            {
+                *p++ = '-';
+                exponent = -exponent;
+            }
+            if(exponent >= 100)
+            {
+                *p++ = static_cast<char>('0' + exponent / 100);
+                exponent %= 100;
+                *p++ = digit_pairs[exponent * 2];
+                *p++ = digit_pairs[exponent * 2 + 1];
+            }
+            else if(exponent >= 10)
+            {
+                *p++ = digit_pairs[exponent * 2];
+                *p++ = digit_pairs[exponent * 2 + 1];
+            }
+            else
+                *p++ = static_cast<char>('0' + exponent);
+        }
+        return p;
+    }
+
+}
+
+
+JsonWriter& JsonWriter::writeValue(const Value& value)
+{
+    write_value(value);
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginObject()
+{
+    separate();
+    out.push_back('{');
+    open.push_back(in_object);
+    return *this;
+}
+
+JsonWriter& JsonWriter::endObject()
+{
+    open.pop_back();
+    if(ppretty)
+    {
+        out.push_back('\n');
+        indent();
+    }
+    out.push_back('}');
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginArray()
+{
+    separate();
+    out.push_back('[');
+    open.push_back(0);
+    return *this;
+}
+
+JsonWriter& JsonWriter::endArray()
+{
+    open.pop_back();
+    out.push_back(']');
+    return *this;
+}
+
+JsonWriter& JsonWriter::writeKey(const char* key, std::size_t size)
+{
+    if(open.back() & has_items)
+        out.push_back(',');
+    open.back() |= has_items;
+    if(ppretty)
+    {
+        out.push_back('\n');
+        indent();
+    }
+    write_string(key, size);
+    if(ppretty)
+        out.append(" : ", 3);
+    else
+        out.push_back(':');
+    return *this;
+}
+
+JsonWriter& JsonWriter::writeNull()
+{
+    separate();
+    out.append("null", 4);
+    return *this;
+}
+
+JsonWriter& JsonWriter::writeBool(bool b)
+{
+    separate();
+    if(b)
+        out.append("true", 4);
+    else
+        out.append("false", 5);
+    return *this;
+}
+
+JsonWriter& JsonWriter::writeInteger(long long i)
+{
+    separate();
+    if(i < 0)
+        write_integer(0ULL - static_cast<unsigned long long>(i), true);
+    else
+        write_integer(static_cast<unsigned long long>(i), false);
+    return *this;
+}
+
+JsonWriter& JsonWriter::writeUnsigned(unsigned long long u)
+{
+    separate();
+    write_integer(u, false);
+    return *this;
+}
+
+JsonWriter& JsonWriter::writeFloat(double d)
+{
+    separate();
+    write_double(d);
+    return *this;
+}
+
+JsonWriter& JsonWriter::writeString(const char* str, std::size_t size)
+{
+    separate();
+    write_string(str, size);
+    return *this;
+}
+
+JsonWriter& JsonWriter::writeNumber(const char* text, std::size_t size)
+{
+    separate();
+    out.append(text, size);
+    return *this;
+}
+
+//////////////// PRIVATE ////////////////
+/////////////////////////////////////////
+
+void JsonWriter::write_value(const Value& v)
+{
+    switch (v.type()) {
+    case Type::Null:
+        writeNull();
+        break;
+    case Type::Bool:
+        writeBool(v.value.Bool);
+        break;
+    case Type::Char:
+        writeString(&v.value.Char, 1);
+        break;
+    case Type::SignedInt:
+        writeInteger(v.value.SignedInt);
+        break;
+    case Type::UnsignedInt:
+        writeUnsigned(v.value.UnsignedInt);
+        break;
+    case Type::Float:
+        writeFloat(v.value.Float);
+        break;
+    case Type::String:
+        writeString(v.value.String.data(), v.value.String.size());
+        break;
+    case Type::HighPrecision:
+    {
+        separate();
+        const std::size_t at = out.size();
+        out.resize(at + v.value.HighPrecision.size());
+        v.value.HighPrecision.copy(&out[at], v.value.HighPrecision.size());
+        break;
+    }
+    case Type::Binary:
+        write_binary(v.value.Binary);
+        break;
+    case Type::Array:
+        beginArray();
+        for(const auto& item : v.array())
+            write_value(*item);
+        endArray();
+        break;
+    case Type::Map:
+        beginObject();
+        for(const auto& member : v.map())
+        {
+            writeKey(member.first.data(), member.first.size());
+            write_value(*member.second);
+        }
+        endObject();
+        break;
+    }
+}
+
+void JsonWriter::write_binary(const Value::BinaryType& b)
+{
+    beginArray();
+    for(byte item : b)
+        writeUnsigned(item);
+    endArray();
+}
+
+//! the comma before the second and later items of an array; members of objects get theirs from writeKey()
+void JsonWriter::separate()
+{
+    if(open.empty() or (open.back() & in_object))
+        return;
+    if(open.back() & has_items)
+    {
+        if(ppretty)
+            out.append(", ", 2);
+        else
+            out.push_back(',');
+    }
+    open.back() |= has_items;
+}
+
+/*!
+ * \brief writes \a str quoted and escaped. Runs of bytes that need no escaping are appended whole;
+ * with SSE2, the runs are found 16 bytes at a time
+ */
+void JsonWriter::write_string(const char* str, std::size_t size)
+{
+    out.reserve(out.size() + size + 2);
+    out.push_back('"');
+
+    std::size_t i = 0, run = 0;
+    auto escape = [&](byte b)
+        {
+            out.append(str + run, i - run);
+            const char e = escape_table.escape[b];
+            if(e == 'u')
+            {
+                const char u[] = { '\\', 'u', '0', '0', hex_digits[b >> 4], hex_digits[b & 0x0f] };
+                out.append(u, sizeof(u));
+            }
+            else
+            {
+                out.push_back('\\');
+                out.push_back(e);
+            }
+            run = ++i;
+        };
+
+#ifdef __SSE2__
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1f);
+    while(i + 16 <= size)
+    {
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(str + i));
+        const __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(in, quote), _mm_cmpeq_epi8(in, backslash)),
+                                             _mm_cmpeq_epi8(_mm_max_epu8(in, control), control));
+        const int mask = _mm_movemask_epi8(special);
+        if(mask == 0)
+        {
+            i += 16;
+            continue;
+        }
+        i += __builtin_ctz(static_cast<unsigned>(mask));
+        escape(static_cast<byte>(str[i]));
+    }
+#endif
+
+    while(i < size)
+    {
+        const byte b = static_cast<byte>(str[i]);
+        if(escape_table.escape[b])
+            escape(b);
+        else
+            ++i;
+    }
+    out.append(str + run, i - run);
+    out.push_back('"');
+}
+
+//! two digits at a time, from the right
+void JsonWriter::write_integer(unsigned long long u, bool negative)
+{
+    char buffer[24];
+    char* p = buffer + sizeof(buffer);
+    while(u >= 100)
+    {
+        const unsigned pair = static_cast<unsigned>(u % 100) * 2;
+        u /= 100;
+        *--p = digit_pairs[pair + 1];
+        *--p = digit_pairs[pair];
+    }
+    if(u >= 10)
+    {
+        const unsigned pair = static_cast<unsigned>(u) * 2;
+        *--p = digit_pairs[pair + 1];
+        *--p = digit_pairs[pair];
+    }
+    else
+        *--p = static_cast<char>('0' + u);
+    if(negative)
+        *--p = '-';
+    out.append(p, buffer + sizeof(buffer) - p);
+}
+
+void JsonWriter::write_double(double d)
+{
+    if(not std::isfinite(d))
+    {
+        out.append("null", 4);
+        return;
+    }
+    if(std::fabs(d) < max_exact_integral and d == std::trunc(d))
+    {
+        write_integer(static_cast<unsigned long long>(std::fabs(d)), std::signbit(d));
+        out.append(".0", 2);
+        return;
+    }
+
+    char digits[18], buffer[40];
+    char* p = buffer;
+    if(d < 0)
+    {
+        *p++ = '-';
+        d = -d;
+    }
+    int k;
+    const int length = grisu2(d, digits, k);
+    p = layout_digits(p, digits, length, k);
+    out.append(buffer, p - buffer);
+}
+
+void JsonWriter::indent()
+{
+    out.append(open.size(), '\t');
+}
@@ -0,0 +1,129 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+#include "parallel_reader.hpp"
+#include "parallel_tasks.hpp"
+#include <vector>
+#include <algorithm>
+
+using namespace ubjson;
+
+/////////////////  FREE FUNCTIONS
+
+namespace {
+
+    //! the least work a decoding thread is given: this many elements, of at least this many bytes in all
+    constexpr std::size_t min_elements_per_thread = 64;
+    constexpr std::size_t min_bytes_per_thread = 64 * 1024;
+
+}
+
+
+ParallelReader::ParallelReader(const byte* data, std::size_t size, ValueSizePolicy policy, unsigned threads)
+    : scanner(data, size, policy.max_value_depth), vsz(policy),
+      max_threads(threadCount(threads))
+{  /**/ }
+
+ParallelReader::ParallelReader(const char* data, std::size_t size, ValueSizePolicy policy, unsigned threads)
+    : ParallelReader(reinterpret_cast<const byte*>(data), size, policy, threads)
+{  /**/ }
+
+Value ParallelReader::getValue()
+{
+    Value v;        getValue(v);        return v;
+}
+
+bool ParallelReader::getValue(Value& v)
+{
+    bool good = false;
+
+    try
+    {
+        bytes_read = 0;
+        threads_used = 1;
+        std::size_t pos = 1;
+        const byte marker = scanner.markerAt(0);
+        if(isArrayStart(marker))
+            v = decodeArray(pos);
+        else
+            v = scanner.decodeValue(marker, pos, vsz);
+        if(pos > vsz.max_object_size)
+            throw parsing_exception("Maximum Object size exceeded!");
+        bytes_read = pos;
+        good = true;
+    }
+    catch(parsing_exception& pexecpt)
+    {
+        last_error = pexecpt.what();
+    }
+    return good;
+}
+
+//////////////// PRIVATE ////////////////
+/////////////////////////////////////////
+
+/*!
+ * \brief decodes the top-level Array whose header starts at \a pos
+ * \post \a pos is just past the Array
+ */
+Value ParallelReader::decodeArray(std::size_t& pos)
+{
+    const STCHeader header = scanner.readContainerHeader(pos);
+    if(BufferScanner::exceedsItemLimit(header, vsz.max_array_items))
+        throw parsing_exception("Maximum container items exceeded!");
+    const byte type = static_cast<byte>(header.marker);
+
+    //boundary pre-scan: skips every element without decoding it
+    std::vector<std::size_t> starts;
+    if(header.is_valid)
+        starts.reserve(header.item_count + 1);
+    while(header.is_valid ? starts.size() < header.item_count : not isArrayEnd(scanner.markerAt(pos)))
+    {
+        starts.push_back(pos);
+        pos = header.has_type ? scanner.skipPayload(type, pos) : scanner.skipValue(pos);
+    }
+    starts.push_back(pos);      //the end of the last element
+    if(not header.is_valid)
+        ++pos;                  //the end marker
+    if(pos > vsz.max_object_size)
+        throw parsing_exception("Maximum Object size exceeded!");
+
+    const std::size_t count = starts.size() - 1;
+    if(count == 0)
+        return Value();         //like StreamReader, an empty Array decodes as Null
+
+    const std::size_t bytes = starts.back() - starts.front();
+    const std::size_t workers = std::max<std::size_t>(1, std::min<std::size_t>({ max_threads,
+                                       count / min_elements_per_thread, bytes / min_bytes_per_thread }));
+
+    //contiguous ranges of about the same encoded size
+    std::vector<std::size_t> cuts{0};
+    for(std::size_t w = 1; w < workers; ++w)
+    {
+        const std::size_t target = starts.front() + bytes / workers * w;
+        cuts.push_back(std::lower_bound(starts.begin() + cuts.back(), starts.end() - 1, target) - starts.begin());
+    }
+    cuts.push_back(count);
+
+    Value::ArrayType items(count);
+    threads_used = runTasks(workers, [&](std::size_t w)
+    {
+        for(std::size_t k = cuts[w]; k < cuts[w + 1]; ++k)
+        {
+            std::size_t p = starts[k];
+            const byte m = header.has_type ? type : scanner.markerAt(p++);
+            items[k] = std::make_unique<Value>(scanner.decodeValue(m, p, vsz, 1));
+        }
+    });
+    return Value(std::move(items));
+}
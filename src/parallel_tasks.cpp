@@ -0,0 +1,59 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+#include "parallel_tasks.hpp"
+#include <thread>
+#include <vector>
+#include <algorithm>
+#include <exception>
+#include <system_error>
+
+using namespace ubjson;
+
+
+unsigned ubjson::threadCount(unsigned threads) noexcept
+{
+    return threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+}
+
+unsigned ubjson::runTasks(std::size_t count, const std::function<void(std::size_t)>& task)
+{
+    std::vector<std::exception_ptr> errors(count);
+    auto guarded = [&](std::size_t t)
+    {
+        try { task(t); }
+        catch(...) { errors[t] = std::current_exception(); }
+    };
+
+    std::vector<std::thread> pool;
+    std::size_t launched = 1;
+    try
+    {
+        for(; launched < count; ++launched)
+            pool.emplace_back(guarded, launched);
+    }
+    catch(std::system_error&)
+    {   /* out of threads; the tasks that weren't handed out run below */ }
+
+    if(count > 0)
+        guarded(0);
+    for(std::size_t t = launched; t < count; ++t)
+        guarded(t);
+    for(auto& t : pool)
+        t.join();
+
+    for(const auto& e : errors)
+        if(e)
+            std::rethrow_exception(e);
+    return static_cast<unsigned>(pool.size() + 1);
+}
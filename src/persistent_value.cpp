@@ -0,0 +1,531 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+#include "persistent_value.hpp"
+#include <limits>
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include <functional>
+
+using namespace ubjson;
+
+/////////////////  NODES
+///
+/// Nodes are built once, then only ever read. An update copies the nodes on the path to what
+/// changed, and the copies point at the same children as the originals
+
+namespace {
+
+    constexpr unsigned bits = 5;                        //!< of an index or a hash, per level of a trie
+    constexpr std::size_t width = std::size_t(1) << bits;
+    constexpr std::size_t mask = width - 1;
+
+    //! a node of the trie of an Array; inner nodes hold children, the last level holds items
+    struct Chunk
+    {
+        std::vector<std::shared_ptr<const Chunk>> children;
+        std::vector<PersistentValue> items;
+    };
+    using ChunkPtr = std::shared_ptr<const Chunk>;
+
+    struct TrieNode;
+    using TrieNodePtr = std::shared_ptr<const TrieNode>;
+
+    //! a member of a Map, or a subtrie of the members whose hashes share a prefix
+    struct Entry
+    {
+        std::size_t hash;
+        std::string key;
+        PersistentValue value;
+        TrieNodePtr child;      //!< set for a subtrie, in which case \a key and \a value are unused
+    };
+
+    /*!
+     * \brief a node of the hash array mapped trie of a Map.
+     * \a bitmap has a bit for each of the 32 slots that are used, and \a entries has an Entry for each,
+     * in order. Once the hash is used up, the node just lists the members whose hashes are equal
+     */
+    struct TrieNode
+    {
+        uint32_t bitmap = 0;
+        std::vector<Entry> entries;
+    };
+
+    constexpr unsigned hash_bits = std::numeric_limits<std::size_t>::digits;
+
+    inline std::size_t hash_of(const std::string& key) noexcept
+    { return std::hash<std::string>()(key); }
+
+    inline uint32_t slot_bit(std::size_t hash, unsigned shift) noexcept
+    { return uint32_t(1) << ((hash >> shift) & mask); }
+
+    inline std::size_t slot_index(uint32_t bitmap, uint32_t bit) noexcept
+    { return static_cast<std::size_t>(__builtin_popcount(bitmap & (bit - 1))); }
+
+    const PersistentValue* trie_find(const TrieNode* n, std::size_t hash, const std::string& key) noexcept
+    {
+        for(unsigned shift = 0; n; shift += bits)
+        {
+            if(shift >= hash_bits)
+            {
+                for(const Entry& e : n->entries)
+                    if(e.key == key)
+                        return &e.value;
+                return nullptr;
+            }
+
+            const uint32_t bit = slot_bit(hash, shift);
+            if(not (n->bitmap & bit))
+                return nullptr;
+            const Entry& e = n->entries[slot_index(n->bitmap, bit)];
+            if(not e.child)
+                return (e.hash == hash and e.key == key) ? &e.value : nullptr;
+            n = e.child.get();
+        }
+        return nullptr;
+    }
+
+    //! \a n (which may be nullptr) with \a leaf set; \a added is set when the key wasn't there before
+    TrieNodePtr trie_with(const TrieNode* n, Entry&& leaf, unsigned shift, bool& added)
+    {
+        auto copy = n ? std::make_shared<TrieNode>(*n) : std::make_shared<TrieNode>();
+        if(shift >= hash_bits)
+        {
+            for(Entry& e : copy->entries)
+                if(e.key == leaf.key)
+                {
+                    e.value = std::move(leaf.value);
+                    return copy;
+                }
+            copy->entries.push_back(std::move(leaf));
+            added = true;
+            return copy;
+        }
+
+        const uint32_t bit = slot_bit(leaf.hash, shift);
+        const std::size_t idx = slot_index(copy->bitmap, bit);
+        if(not (copy->bitmap & bit))
+        {
+            copy->entries.insert(copy->entries.begin() + idx, std::move(leaf));
+            copy->bitmap |= bit;
+            added = true;
+            return copy;
+        }
+
+        Entry& e = copy->entries[idx];
+        if(e.child)
+            e.child = trie_with(e.child.get(), std::move(leaf), shift + bits, added);
+        else if(e.hash == leaf.hash and e.key == leaf.key)
+            e.value = std::move(leaf.value);
+        else
+        {
+            //two members in one slot: push both a level down
+            bool ignored = false;
+            const TrieNodePtr sub = trie_with(nullptr, std::move(e), shift + bits, ignored);
+            e = Entry();
+            e.child = trie_with(sub.get(), std::move(leaf), shift + bits, added);
+        }
+        return copy;
+    }
+
+    //! \a n without \a key; \a n itself if it isn't there, nullptr if nothing is left
+    TrieNodePtr trie_without(const TrieNodePtr& n, std::size_t hash, const std::string& key, unsigned shift, bool& removed)
+    {
+        if(shift >= hash_bits)
+        {
+            for(std::size_t i = 0; i < n->entries.size(); ++i)
+                if(n->entries[i].key == key)
+                {
+                    removed = true;
+                    if(n->entries.size() == 1)
+                        return nullptr;
+                    auto copy = std::make_shared<TrieNode>(*n);
+                    copy->entries.erase(copy->entries.begin() + i);
+                    return copy;
+                }
+            return n;
+        }
+
+        const uint32_t bit = slot_bit(hash, shift);
+        if(not (n->bitmap & bit))
+            return n;
+        const std::size_t idx = slot_index(n->bitmap, bit);
+        const Entry& e = n->entries[idx];
+
+        TrieNodePtr child;
+        if(e.child)
+        {
+            child = trie_without(e.child, hash, key, shift + bits, removed);
+            if(not removed)
+                return n;
+        }
+        else if(e.hash != hash or e.key != key)
+            return n;
+        removed = true;
+
+        auto copy = std::make_shared<TrieNode>(*n);
+        if(child and child->entries.size() == 1 and not child->entries.front().child)
+            copy->entries[idx] = child->entries.front();       //a lone member moves back up
+        else if(child)
+            copy->entries[idx].child = std::move(child);
+        else
+        {
+            copy->entries.erase(copy->entries.begin() + idx);
+            copy->bitmap &= ~bit;
+            if(copy->entries.empty())
+                return nullptr;
+        }
+        return copy;
+    }
+
+    template<typename Function>
+    void trie_for_each(const TrieNode* n, Function&& fn)
+    {
+        if(not n)
+            return;
+        for(const Entry& e : n->entries)
+        {
+            if(e.child)
+                trie_for_each(e.child.get(), fn);
+            else
+                fn(e.key, e.value);
+        }
+    }
+
+    //! a new path of chunks from \a shift down to a last level that holds only \a v
+    ChunkPtr chunk_path(unsigned shift, PersistentValue&& v)
+    {
+        auto c = std::make_shared<Chunk>();
+        if(shift == 0)
+            c->items.push_back(std::move(v));
+        else
+            c->children.push_back(chunk_path(shift - bits, std::move(v)));
+        return c;
+    }
+
+    ChunkPtr chunk_with(const Chunk* c, unsigned shift, std::size_t i, PersistentValue&& v)
+    {
+        auto copy = std::make_shared<Chunk>(*c);
+        if(shift == 0)
+            copy->items[i & mask] = std::move(v);
+        else
+        {
+            ChunkPtr& child = copy->children[(i >> shift) & mask];
+            child = chunk_with(child.get(), shift - bits, i, std::move(v));
+        }
+        return copy;
+    }
+
+    //! \a c with \a v appended as item \a i, given that \a c has room for it
+    ChunkPtr chunk_push(const Chunk* c, unsigned shift, std::size_t i, PersistentValue&& v)
+    {
+        auto copy = std::make_shared<Chunk>(*c);
+        if(shift == 0)
+            copy->items.push_back(std::move(v));
+        else
+        {
+            const std::size_t slot = (i >> shift) & mask;
+            if(slot < copy->children.size())
+                copy->children[slot] = chunk_push(copy->children[slot].get(), shift - bits, i, std::move(v));
+            else
+                copy->children.push_back(chunk_path(shift - bits, std::move(v)));
+        }
+        return copy;
+    }
+
+    template<typename Function>
+    void chunk_for_each(const Chunk* c, Function&& fn)
+    {
+        for(const ChunkPtr& child : c->children)
+            chunk_for_each(child.get(), fn);
+        for(const PersistentValue& item : c->items)
+            fn(item);
+    }
+
+}
+
+struct PersistentValue::Node
+{
+    explicit Node(Type t) noexcept : type(t) {}
+    const Type type;
+};
+
+struct PersistentValue::Scalar : PersistentValue::Node
+{
+    explicit Scalar(const Value& v) : Node(v.type()), value(v) {}
+    const Value value;
+};
+
+struct PersistentValue::Vector : PersistentValue::Node
+{
+    Vector() : Node(Type::Array) {}
+    std::size_t count = 0;
+    unsigned shift = 0;         //!< of the index, at the root
+    ChunkPtr root = std::make_shared<Chunk>();
+};
+
+struct PersistentValue::Trie : PersistentValue::Node
+{
+    Trie() : Node(Type::Map) {}
+    std::size_t count = 0;
+    TrieNodePtr root;           //!< nullptr when empty
+};
+
+
+/////////////////  PUBLIC
+
+PersistentValue::PersistentValue(const Value& v)
+{
+    switch (v.type()) {
+    case Type::Null:
+        break;
+    case Type::Array:
+    {
+        //packed a level at a time, bottom up, just as appending one by one would lay them out
+        auto vec = std::make_shared<Vector>();
+        std::vector<ChunkPtr> level;
+        for(std::size_t i = 0; i < v.size(); i += width)
+        {
+            auto c = std::make_shared<Chunk>();
+            for(std::size_t k = i; k < v.size() and k < i + width; ++k)
+                c->items.emplace_back(v[static_cast<int>(k)]);
+            level.push_back(std::move(c));
+        }
+        for(; level.size() > 1; vec->shift += bits)
+        {
+            std::vector<ChunkPtr> parents;
+            for(std::size_t i = 0; i < level.size(); i += width)
+            {
+                auto c = std::make_shared<Chunk>();
+                c->children.assign(level.begin() + i, level.begin() + std::min(level.size(), i + width));
+                parents.push_back(std::move(c));
+            }
+            level.swap(parents);
+        }
+        if(not level.empty())
+            vec->root = std::move(level.front());
+        vec->count = v.size();
+        node = std::move(vec);
+        break;
+    }
+    case Type::Map:
+    {
+        auto trie = std::make_shared<Trie>();
+        for(auto member : v.items())
+        {
+            bool added = false;
+            trie->root = trie_with(trie->root.get(), Entry{ hash_of(member.key), member.key, PersistentValue(member.value), nullptr },
+                                   0, added);
+        }
+        trie->count = v.size();
+        node = std::move(trie);
+        break;
+    }
+    default:
+        node = std::make_shared<Scalar>(v);
+        break;
+    }
+}
+
+Type PersistentValue::type() const noexcept
+{ return node ? node->type : Type::Null; }
+
+std::size_t PersistentValue::size() const noexcept
+{
+    switch (type()) {
+    case Type::Null:
+        return 0;
+    case Type::Array:
+        return static_cast<const Vector&>(*node).count;
+    case Type::Map:
+        return static_cast<const Trie&>(*node).count;
+    default:
+        return 1;
+    }
+}
+
+bool PersistentValue::asBool() const
+{ return scalar().asBool(); }
+
+int PersistentValue::asInt() const
+{ return scalar().asInt(); }
+
+long long PersistentValue::asInt64() const
+{ return scalar().asInt64(); }
+
+unsigned long long PersistentValue::asUint64() const
+{ return scalar().asUint64(); }
+
+double PersistentValue::asFloat() const
+{ return scalar().asFloat(); }
+
+std::string PersistentValue::asString() const
+{ return scalar().asString(); }
+
+const PersistentValue& PersistentValue::operator [] (int index) const
+{
+    const Vector& vec = vector();
+    const std::size_t i = static_cast<std::size_t>(index);
+    if(index < 0 or i >= vec.count)
+        throw std::out_of_range("PersistentValue: Array index out of range");
+
+    const Chunk* c = vec.root.get();
+    for(unsigned shift = vec.shift; shift > 0; shift -= bits)
+        c = c->children[(i >> shift) & mask].get();
+    return c->items[i & mask];
+}
+
+const PersistentValue& PersistentValue::operator [] (const char* key) const
+{ return operator [] (std::string(key)); }
+
+const PersistentValue& PersistentValue::operator [] (const std::string& key) const
+{
+    const Trie& t = trie();
+    const PersistentValue* found = trie_find(t.root.get(), hash_of(key), key);
+    if(not found)
+        throw std::out_of_range("PersistentValue: key not found");
+    return *found;
+}
+
+const PersistentValue* PersistentValue::find(const std::string& key) const noexcept
+{
+    if(not isMap())
+        return nullptr;
+    return trie_find(static_cast<const Trie&>(*node).root.get(), hash_of(key), key);
+}
+
+Value::Keys PersistentValue::keys() const
+{
+    Value::Keys rtn;
+    if(isMap())
+        trie_for_each(static_cast<const Trie&>(*node).root.get(),
+                      [&rtn](const std::string& key, const PersistentValue&){ rtn.push_back(key); });
+    return rtn;
+}
+
+PersistentValue PersistentValue::with(const std::string& key, PersistentValue v) const
+{
+    if(not isNull() and not isMap())
+        throw value_exception("Attempt to update 'PersistentValue'; 'PersistentValue' is not a Key-Value pair (aka Object) !");
+
+    auto t = isMap() ? std::make_shared<Trie>(static_cast<const Trie&>(*node)) : std::make_shared<Trie>();
+    bool added = false;
+    t->root = trie_with(t->root.get(), Entry{ hash_of(key), key, std::move(v), nullptr }, 0, added);
+    if(added)
+        ++t->count;
+    return PersistentValue(std::move(t));
+}
+
+PersistentValue PersistentValue::with(int index, PersistentValue v) const
+{
+    const Vector& vec = vector();
+    const std::size_t i = static_cast<std::size_t>(index);
+    if(index < 0 or i >= vec.count)
+        throw std::out_of_range("PersistentValue: Array index out of range");
+
+    auto copy = std::make_shared<Vector>(vec);
+    copy->root = chunk_with(vec.root.get(), vec.shift, i, std::move(v));
+    return PersistentValue(std::move(copy));
+}
+
+PersistentValue PersistentValue::without(const std::string& key) const
+{
+    const Trie& t = trie();
+    if(not t.root)
+        return *this;
+
+    bool removed = false;
+    TrieNodePtr root = trie_without(t.root, hash_of(key), key, 0, removed);
+    if(not removed)
+        return *this;
+
+    auto copy = std::make_shared<Trie>();
+    copy->root = std::move(root);
+    copy->count = t.count - 1;
+    return PersistentValue(std::move(copy));
+}
+
+PersistentValue PersistentValue::pushBack(PersistentValue v) const
+{
+    if(not isNull() and not isArray())
+        throw value_exception("Attempt to append to 'PersistentValue'; 'PersistentValue' is not an Array!");
+
+    auto copy = isArray() ? std::make_shared<Vector>(static_cast<const Vector&>(*node)) : std::make_shared<Vector>();
+
+    if(copy->count == (std::size_t(1) << (copy->shift + bits)))
+    {
+        //the trie is full; it becomes the first child of a new root
+        auto root = std::make_shared<Chunk>();
+        root->children.push_back(std::move(copy->root));
+        root->children.push_back(chunk_path(copy->shift, std::move(v)));
+        copy->root = std::move(root);
+        copy->shift += bits;
+    }
+    else
+        copy->root = chunk_push(copy->root.get(), copy->shift, copy->count, std::move(v));
+    ++copy->count;
+    return PersistentValue(std::move(copy));
+}
+
+Value PersistentValue::toValue() const
+{
+    switch (type()) {
+    case Type::Null:
+        return Value();
+    case Type::Array:
+    {
+        Value::ArrayType items;
+        items.reserve(size());
+        chunk_for_each(static_cast<const Vector&>(*node).root.get(),
+                       [&items](const PersistentValue& item){ items.push_back(std::make_unique<Value>(item.toValue())); });
+        return Value(std::move(items));
+    }
+    case Type::Map:
+    {
+        Value::MapType members;
+        members.reserve(size());
+        trie_for_each(static_cast<const Trie&>(*node).root.get(),
+                      [&members](const std::string& key, const PersistentValue& v){ members[key] = std::make_unique<Value>(v.toValue()); });
+        return Value(std::move(members));
+    }
+    default:
+        return static_cast<const Scalar&>(*node).value;
+    }
+}
+
+
+//////////////// PRIVATE ////////////////
+/////////////////////////////////////////
+
+const PersistentValue::Vector& PersistentValue::vector() const
+{
+    if(not isArray())
+        throw value_exception("Attempt to index 'PersistentValue'; 'PersistentValue' is not an Array!");
+    return static_cast<const Vector&>(*node);
+}
+
+const PersistentValue::Trie& PersistentValue::trie() const
+{
+    if(not isMap())
+        throw value_exception("Attempt to index 'PersistentValue'; 'PersistentValue' is not a Key-Value pair (aka Object) !");
+    return static_cast<const Trie&>(*node);
+}
+
+//! the Value that the asX() conversions apply to
+Value PersistentValue::scalar() const
+{
+    if(not node or isArray() or isMap())
+        return toValue();
+    return static_cast<const Scalar&>(*node).value;
+}
@@ -0,0 +1,183 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+#include "record_reader.hpp"
+#include "parallel_tasks.hpp"
+#include <algorithm>
+
+using namespace ubjson;
+
+/////////////////  FREE FUNCTIONS
+
+namespace {
+
+    //! the most frames a worker takes at once; fewer lock round trips for small records
+    constexpr std::size_t max_batch = 32;
+
+}
+
+
+RecordReader::RecordReader(const byte* data, std::size_t size, ValueSizePolicy policy, RecordReaderPolicy rpolicy)
+    : scanner(data, size, policy.max_value_depth), vsz(policy),
+      workers(threadCount(rpolicy.workers)),
+      slots(std::max<std::size_t>(1, rpolicy.max_pending))
+{
+    try
+    {
+        threads.emplace_back(&RecordReader::frame, this);
+        for(unsigned i = 0; i < workers; ++i)
+            threads.emplace_back(&RecordReader::decode, this);
+    }
+    catch(...)
+    {
+        shutdown();
+        throw;
+    }
+}
+
+RecordReader::RecordReader(const char* data, std::size_t size, ValueSizePolicy policy, RecordReaderPolicy rpolicy)
+    : RecordReader(reinterpret_cast<const byte*>(data), size, policy, rpolicy)
+{  /**/ }
+
+RecordReader::~RecordReader()
+{
+    shutdown();
+}
+
+Value RecordReader::getNextValue()
+{
+    Value v;        getNextValue(v);        return v;
+}
+
+bool RecordReader::getNextValue(Value& v)
+{
+    std::unique_lock<std::mutex> lock(mtx);
+    Slot& slot = slots[delivered % slots.size()];
+    ready_cv.wait(lock, [&]{ return slot.ready or (framing_done and delivered == framed); });
+
+    if(not slot.ready)      //no more records
+    {
+        last_error = framing_error;
+        return false;
+    }
+
+    v = std::move(slot.value);
+    slot.value = Value();
+    last_error = std::move(slot.error);
+    slot.error.clear();
+    slot.ready = false;
+    bytes_so_far += slot.size;
+    ++delivered;
+    lock.unlock();
+    space_cv.notify_one();
+
+    return last_error.empty();
+}
+
+//////////////// PRIVATE ////////////////
+/////////////////////////////////////////
+
+//! the framing stage: finds where each document ends, without decoding it
+void RecordReader::frame()
+{
+    std::string error;
+    try
+    {
+        std::size_t pos = 0;
+        while(pos < scanner.size())
+        {
+            const std::size_t begin = pos;
+            pos = scanner.skipValue(pos);
+
+            std::unique_lock<std::mutex> lock(mtx);
+            space_cv.wait(lock, [&]{ return stopping or framed - delivered < slots.size(); });
+            if(stopping)
+                return;
+            frames.push_back(Frame{framed++, begin, pos});
+            lock.unlock();
+            work_cv.notify_one();
+        }
+    }
+    catch(parsing_exception& pexecpt)
+    {
+        error = pexecpt.what();
+    }
+
+    std::lock_guard<std::mutex> lock(mtx);
+    framing_error = error;
+    framing_done = true;
+    work_cv.notify_all();
+    ready_cv.notify_all();
+}
+
+//! a decoding worker: takes a batch of frames, decodes them unlocked, then publishes the results
+void RecordReader::decode()
+{
+    std::vector<Frame> batch;
+    std::vector<Slot> results;
+
+    for(;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            work_cv.wait(lock, [&]{ return stopping or framing_done or not frames.empty(); });
+            if(stopping or frames.empty())
+                return;
+
+            const std::size_t take = std::min(max_batch, std::max<std::size_t>(1, frames.size() / workers));
+            batch.assign(frames.begin(), frames.begin() + take);
+            frames.erase(frames.begin(), frames.begin() + take);
+        }
+
+        results.clear();
+        results.resize(batch.size());
+        for(std::size_t i = 0; i < batch.size(); ++i)
+        {
+            const Frame& f = batch[i];
+            Slot& r = results[i];
+            r.size = f.end - f.begin;
+            try
+            {
+                if(r.size > vsz.max_object_size)
+                    throw parsing_exception("Maximum Object size exceeded!");
+                std::size_t pos = f.begin + 1;
+                r.value = scanner.decodeValue(scanner.markerAt(f.begin), pos, vsz);
+            }
+            catch(parsing_exception& pexecpt)
+            {
+                r.error = pexecpt.what();
+            }
+            r.ready = true;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            for(std::size_t i = 0; i < batch.size(); ++i)
+                slots[batch[i].seq % slots.size()] = std::move(results[i]);
+        }
+        ready_cv.notify_one();
+    }
+}
+
+void RecordReader::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    work_cv.notify_all();
+    space_cv.notify_all();
+    for(auto& t : threads)
+        t.join();
+    threads.clear();
+}
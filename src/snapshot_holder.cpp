@@ -0,0 +1,118 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+#include "snapshot_holder.hpp"
+#include <limits>
+#include <stdexcept>
+#include <algorithm>
+
+using namespace ubjson;
+
+/*
+ * Every atomic operation below is sequentially consistent, and the argument rests on it.
+ * A version retired in epoch e was replaced before the epoch moved past e. So a reader that
+ * loaded it announced an epoch of at most e before loading it, and a reader that announced
+ * a later epoch, or announced it after reclaim() saw its slot empty, loads a newer version
+ */
+
+SnapshotHolder::SnapshotHolder(Value initial, std::size_t max_readers)
+    : current(new Value(std::move(initial))), slots(max_readers)
+{}
+
+SnapshotHolder::~SnapshotHolder()
+{
+    delete current.load();
+    for(auto& r : retired)
+        delete r.first;
+}
+
+void SnapshotHolder::publish(Value v)
+{
+    std::unique_ptr<const Value> fresh(new Value(std::move(v)));
+
+    std::lock_guard<std::mutex> lock(writer);
+    retired.reserve(retired.size() + 1);
+    const Value* old = current.exchange(fresh.release());
+    retired.emplace_back(old, epoch.fetch_add(1));
+    reclaim_locked();
+}
+
+void SnapshotHolder::reclaim()
+{
+    std::lock_guard<std::mutex> lock(writer);
+    reclaim_locked();
+}
+
+std::size_t SnapshotHolder::getRetiredCount() const
+{
+    std::lock_guard<std::mutex> lock(writer);
+    return retired.size();
+}
+
+//////////////// PRIVATE ////////////////
+/////////////////////////////////////////
+
+void SnapshotHolder::reclaim_locked()
+{
+    uint64_t oldest = std::numeric_limits<uint64_t>::max();
+    for(const Slot& s : slots)
+    {
+        const uint64_t e = s.epoch.load();
+        if(e != 0)
+            oldest = std::min(oldest, e);
+    }
+
+    auto still_visible = std::partition(retired.begin(), retired.end(),
+                                        [oldest](const std::pair<const Value*, uint64_t>& r){ return r.second >= oldest; });
+    for(auto it = still_visible; it != retired.end(); ++it)
+        delete it->first;
+    retired.erase(still_visible, retired.end());
+}
+
+
+/////////////////  READER
+
+SnapshotHolder::Reader::Reader(SnapshotHolder& h)
+    : holder(h), slot(nullptr)
+{
+    for(Slot& s : holder.slots)
+    {
+        bool expected = false;
+        if(s.claimed.compare_exchange_strong(expected, true))
+        {
+            slot = &s;
+            return;
+        }
+    }
+    throw std::length_error("SnapshotHolder: every reader slot is taken");
+}
+
+SnapshotHolder::Reader::~Reader()
+{
+    slot->epoch.store(0);
+    slot->claimed.store(false);
+}
+
+//! a nested Snapshot keeps the epoch of the outermost one, which protects everything it loads too
+SnapshotHolder::Snapshot SnapshotHolder::Reader::acquire() noexcept
+{
+    if(depth++ == 0)
+        slot->epoch.store(holder.epoch.load());
+    return Snapshot(this, holder.current.load());
+}
+
+void SnapshotHolder::Reader::release() noexcept
+{
+    if(--depth == 0)
+        slot->epoch.store(0);
+}
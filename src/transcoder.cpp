@@ -0,0 +1,617 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+#include "transcoder.hpp"
+#include "buffer_scanner.hpp"
+#include "json_reader.hpp"
+#include "utf8.hpp"
+#include <algorithm>
+#include <cstring>
+
+using namespace ubjson;
+
+/////////////////  FREE FUNCTIONS
+
+namespace {
+
+    inline bool is_json_space(char c) noexcept
+    { return c == ' ' or c == '\n' or c == '\r' or c == '\t'; }
+
+    //! whether \a c ends a number or literal
+    inline bool ends_token(char c) noexcept
+    {
+        return is_json_space(c) or c == ',' or c == ':' or c == ']' or c == '}' or
+                c == '[' or c == '{' or c == '"';
+    }
+
+    inline bool is_number_byte(char c) noexcept
+    { return (c >= '0' and c <= '9') or c == '-' or c == '+' or c == '.' or c == 'e' or c == 'E'; }
+
+}
+
+constexpr std::size_t StreamTranscoder::chunk_size;
+
+/*!
+ * \brief moves the unread bytes to the front of the window, growing it if \a n bytes wouldn't fit,
+ * and reads as much as fits after them
+ */
+bool StreamTranscoder::fill(std::size_t n, std::size_t lookahead)
+{
+    if(window_offset + pos + n - lookahead - document_start > vsz.max_object_size)
+        throw parsing_exception("Maximum Object size exceeded!");
+
+    if(pos > 0)
+    {
+        std::memmove(&window[0], window.data() + pos, end - pos);
+        window_offset += pos;
+        end -= pos;
+        pos = 0;
+    }
+    if(window.size() < n or window.empty())
+        window.resize(std::max({ n, chunk_size, window.size() * 2 }));
+
+    while(end < n)
+    {
+        input.read(&window[end], static_cast<std::streamsize>(window.size() - end));
+        const std::size_t got = static_cast<std::size_t>(input.gcount());
+        if(got == 0)
+            return false;
+        end += got;
+    }
+    return true;
+}
+
+void StreamTranscoder::end_document() const
+{
+    if(window_offset + pos - document_start > vsz.max_object_size)
+        throw parsing_exception("Maximum Object size exceeded!");
+}
+
+
+/////////////////  UBJSON TO JSON
+
+bool UbjsonToJson::transcodeNext()
+{
+    begin_document();
+    if(pos == end and not fill(1))
+        return false;
+
+    convert_value(next_byte(), 0);
+    end_document();
+    output.write(json.data(), static_cast<std::streamsize>(json.size()));
+    output.put('\n');
+    json.clear();
+    return true;
+}
+
+std::size_t UbjsonToJson::transcodeAll()
+{
+    std::size_t documents = 0;
+    while(transcodeNext())
+        ++documents;
+    flush();
+    return documents;
+}
+
+void UbjsonToJson::flush()
+{
+    output.write(json.data(), static_cast<std::streamsize>(json.size()));
+    json.clear();
+    output.flush();
+}
+
+//////////////// PRIVATE ////////////////
+/////////////////////////////////////////
+
+byte UbjsonToJson::next_byte()
+{
+    require(1);
+    return static_cast<byte>(window[pos++]);
+}
+
+long long UbjsonToJson::read_integer(byte marker)
+{
+    if(not isInteger(marker))
+        throw parsing_exception("Invalid integer marker encountered!");
+    const int width = BufferScanner::fixedPayloadSize(marker);
+    require(width);
+
+    byte* b = reinterpret_cast<byte*>(&window[pos]);
+    pos += width;
+    switch (static_cast<Marker>(marker)) {
+    case Marker::Uint8:
+        return fromBigEndian8(b);
+    case Marker::Int8:
+        return static_cast<int8_t>(fromBigEndian8(b));
+    case Marker::Int16:
+        return static_cast<int16_t>(fromBigEndian16(b));
+    case Marker::Int32:
+        return static_cast<int32_t>(fromBigEndian32(b));
+    default:
+        return static_cast<int64_t>(fromBigEndian64(b));
+    }
+}
+
+std::size_t UbjsonToJson::read_count()
+{
+    return read_count(next_byte());
+}
+
+std::size_t UbjsonToJson::read_count(byte marker)
+{
+    const long long count = read_integer(marker);
+    if(count < 0)
+        throw parsing_exception("Negative count token encountered!");
+    return static_cast<std::size_t>(count);
+}
+
+void UbjsonToJson::convert_value(byte marker, std::size_t depth)
+{
+    switch (static_cast<Marker>(marker)) {
+    case Marker::Null:
+    case Marker::No_Op:
+        json.writeNull();
+        break;
+    case Marker::True:
+        json.writeBool(true);
+        break;
+    case Marker::False:
+        json.writeBool(false);
+        break;
+    case Marker::Char:
+        require(1);
+        json.writeString(at(), 1);
+        ++pos;
+        break;
+    case Marker::Uint8:
+        json.writeUnsigned(static_cast<unsigned long long>(read_integer(marker)));
+        break;
+    case Marker::Int8:
+    case Marker::Int16:
+    case Marker::Int32:
+    case Marker::Int64:
+        json.writeInteger(read_integer(marker));
+        break;
+    case Marker::Float32:
+        require(4);
+        json.writeFloat(static_cast<double>(fromBigEndianFloat32(reinterpret_cast<byte*>(&window[pos]))));
+        pos += 4;
+        break;
+    case Marker::Float64:
+        require(8);
+        json.writeFloat(fromBigEndianFloat64(reinterpret_cast<byte*>(&window[pos])));
+        pos += 8;
+        break;
+    case Marker::String:
+        convert_string(read_count(), false);
+        break;
+    case Marker::HighPrecision:
+        convert_high_precision();
+        break;
+    case Marker::Binary:
+        convert_binary();
+        break;
+    case Marker::Array_Start:
+        convert_container(false, depth);
+        break;
+    case Marker::Object_Start:
+        convert_container(true, depth);
+        break;
+    default:
+        throw parsing_exception("Invalid marker encountered!");
+    }
+    spill();
+}
+
+void UbjsonToJson::convert_container(bool is_object, std::size_t depth)
+{
+    if(depth >= vsz.max_value_depth)
+        throw parsing_exception("Maximum Parsing depth Exceeded!");
+
+    STCHeader header;
+    require(1);
+    if(isOptimized_Type(static_cast<byte>(window[pos])))
+    {
+        ++pos;
+        header.has_type = true;
+        header.marker = static_cast<Marker>(next_byte());
+        if(not isOptimized_Count(next_byte()))
+            throw parsing_exception("A typed container must be followed by a count!");
+        header.item_count = read_count();
+        header.is_valid = true;
+    }
+    else if(isOptimized_Count(static_cast<byte>(window[pos])))
+    {
+        ++pos;
+        header.item_count = read_count();
+        header.is_valid = true;
+    }
+    if(BufferScanner::exceedsItemLimit(header, is_object ? vsz.max_object_items : vsz.max_array_items))
+        throw parsing_exception("Maximum container items exceeded!");
+
+    const byte type = static_cast<byte>(header.marker);
+    if(is_object)
+        json.beginObject();
+    else
+        json.beginArray();
+
+    if(header.has_type and not is_object and BufferScanner::fixedPayloadSize(type) > 0)
+        convert_typed_array(type, header.item_count);
+    else if(header.is_valid)
+        for(std::size_t i = 0; i < header.item_count; ++i)
+        {
+            if(is_object)
+                convert_string(read_count(), true);
+            convert_value(header.has_type ? type : next_byte(), depth + 1);
+        }
+    else
+    {
+        const byte end_marker = static_cast<byte>(is_object ? Marker::Object_End : Marker::Array_End);
+        for(byte m = next_byte(); m != end_marker; m = next_byte())
+        {
+            if(is_object)
+            {
+                convert_string(read_count(m), true);
+                m = next_byte();
+            }
+            convert_value(m, depth + 1);
+        }
+    }
+
+    if(is_object)
+        json.endObject();
+    else
+        json.endArray();
+}
+
+//! the items of a typed array of fixed size items, a window full at a time
+void UbjsonToJson::convert_typed_array(byte marker, std::size_t count)
+{
+    const std::size_t width = static_cast<std::size_t>(BufferScanner::fixedPayloadSize(marker));
+    for(std::size_t left = count; left > 0; )
+    {
+        const std::size_t n = std::min(left, chunk_size / width);
+        require(n * width);
+        byte* b = reinterpret_cast<byte*>(&window[pos]);
+
+        switch (static_cast<Marker>(marker)) {
+        case Marker::Char:
+            for(std::size_t i = 0; i < n; ++i)
+                json.writeString(reinterpret_cast<const char*>(b + i), 1);
+            break;
+        case Marker::Uint8:
+            for(std::size_t i = 0; i < n; ++i)
+                json.writeUnsigned(b[i]);
+            break;
+        case Marker::Int8:
+            for(std::size_t i = 0; i < n; ++i)
+                json.writeInteger(static_cast<int8_t>(b[i]));
+            break;
+        case Marker::Int16:
+            for(std::size_t i = 0; i < n; ++i)
+                json.writeInteger(static_cast<int16_t>(fromBigEndian16(b + 2 * i)));
+            break;
+        case Marker::Int32:
+            for(std::size_t i = 0; i < n; ++i)
+                json.writeInteger(static_cast<int32_t>(fromBigEndian32(b + 4 * i)));
+            break;
+        case Marker::Int64:
+            for(std::size_t i = 0; i < n; ++i)
+                json.writeInteger(static_cast<int64_t>(fromBigEndian64(b + 8 * i)));
+            break;
+        case Marker::Float32:
+            for(std::size_t i = 0; i < n; ++i)
+                json.writeFloat(static_cast<double>(fromBigEndianFloat32(b + 4 * i)));
+            break;
+        default:
+            for(std::size_t i = 0; i < n; ++i)
+                json.writeFloat(fromBigEndianFloat64(b + 8 * i));
+            break;
+        }
+
+        pos += n * width;
+        left -= n;
+        spill();
+    }
+}
+
+void UbjsonToJson::convert_string(std::size_t size, bool is_key)
+{
+    if(size > vsz.max_string_size)
+        throw parsing_exception("Maximum String size exceeded!");
+    require(size);
+    if(vsz.validate_utf8 and validateUtf8(at(), size) != size)
+        throw parsing_exception("Invalid UTF-8 encountered!");
+
+    if(is_key)
+        json.writeKey(at(), size);
+    else
+        json.writeString(at(), size);
+    pos += size;
+}
+
+//! as an array of the byte values, a window full at a time
+void UbjsonToJson::convert_binary()
+{
+    const std::size_t size = read_count();
+    if(size > vsz.max_binary_size)
+        throw parsing_exception("Maximum Binary size exceeded!");
+
+    json.beginArray();
+    for(std::size_t left = size; left > 0; )
+    {
+        const std::size_t n = std::min(left, chunk_size);
+        require(n);
+        for(std::size_t i = 0; i < n; ++i)
+            json.writeUnsigned(static_cast<byte>(window[pos + i]));
+        pos += n;
+        left -= n;
+        spill();
+    }
+    json.endArray();
+}
+
+//! integers that fit into an \e unsigned \e long \e long are written as such, the same as StreamReader reads them
+void UbjsonToJson::convert_high_precision()
+{
+    const std::size_t size = read_count();
+    if(size > vsz.max_string_size)
+        throw parsing_exception("Maximum String size exceeded!");
+    require(size);
+
+    unsigned long long integral;
+    try
+    {
+        const Value::HighPrecisionType number(at(), size);
+        if(number.toUint64(integral))
+            json.writeUnsigned(integral);
+        else
+            json.writeNumber(at(), size);
+    }
+    catch(value_exception&)
+    {
+        throw parsing_exception("Invalid high precision number encountered!");
+    }
+    pos += size;
+}
+
+void UbjsonToJson::spill()
+{
+    if(json.size() < chunk_size)
+        return;
+    output.write(json.data(), static_cast<std::streamsize>(json.size()));
+    json.clear();
+}
+
+
+/////////////////  JSON TO UBJSON
+
+bool JsonToUbjson::transcodeNext()
+{
+    begin_document();
+    if(peek_token() < 0)
+        return false;
+
+    begin_document();       //whitespace before a value isn't part of it
+    convert_value(0);
+    end_document();
+    spill();
+    return true;
+}
+
+std::size_t JsonToUbjson::transcodeAll()
+{
+    std::size_t documents = 0;
+    while(transcodeNext())
+        ++documents;
+    flush();
+    return documents;
+}
+
+void JsonToUbjson::flush()
+{
+    output.write(sink.bytes.data(), static_cast<std::streamsize>(sink.bytes.size()));
+    sink.bytes.clear();
+    output.flush();
+}
+
+//////////////// PRIVATE ////////////////
+/////////////////////////////////////////
+
+//! skips whitespace \return the byte after it, or -1 at the end of the input
+int JsonToUbjson::peek_token()
+{
+    for(;;)
+    {
+        if(pos == end and not fill(1))
+            return -1;
+        const char c = window[pos];
+        if(not is_json_space(c))
+            return static_cast<byte>(c);
+        ++pos;
+    }
+}
+
+void JsonToUbjson::convert_value(std::size_t depth)
+{
+    switch (peek_token()) {
+    case '{':
+        ++pos;
+        convert_object(depth);
+        break;
+    case '[':
+        ++pos;
+        convert_array(depth);
+        break;
+    case '"':
+        read_string(text);
+        sink.bytes.push_back(static_cast<char>(Marker::String));
+        write_sized(text);
+        break;
+    case 't':
+    case 'f':
+    case 'n':
+        convert_literal();
+        break;
+    case '-': case '0': case '1': case '2': case '3': case '4':
+    case '5': case '6': case '7': case '8': case '9':
+        convert_number();
+        break;
+    case -1:
+        throw parsing_exception("Unexpected end of JSON text!");
+    default:
+        throw parsing_exception("Unexpected character in JSON text!");
+    }
+}
+
+void JsonToUbjson::convert_object(std::size_t depth)
+{
+    if(depth >= vsz.max_value_depth)
+        throw parsing_exception("Maximum Parsing depth Exceeded!");
+
+    sink.bytes.push_back(static_cast<char>(Marker::Object_Start));
+    int c = peek_token();
+    if(c == '}')
+        ++pos;
+    else
+        for(;;)
+        {
+            if(c != '"')
+                throw parsing_exception("Expected a key in JSON object!");
+            read_string(text);
+            write_sized(text);
+            if(peek_token() != ':')
+                throw parsing_exception("Expected ':' after a key in JSON object!");
+            ++pos;
+            convert_value(depth + 1);
+
+            c = peek_token();
+            ++pos;
+            if(c == '}')
+                break;
+            if(c != ',')
+                throw parsing_exception("Expected ',' or '}' in JSON object!");
+            c = peek_token();
+        }
+    sink.bytes.push_back(static_cast<char>(Marker::Object_End));
+    spill();
+}
+
+void JsonToUbjson::convert_array(std::size_t depth)
+{
+    if(depth >= vsz.max_value_depth)
+        throw parsing_exception("Maximum Parsing depth Exceeded!");
+
+    sink.bytes.push_back(static_cast<char>(Marker::Array_Start));
+    if(peek_token() == ']')
+        ++pos;
+    else
+        for(;;)
+        {
+            convert_value(depth + 1);
+
+            const int c = peek_token();
+            ++pos;
+            if(c == ']')
+                break;
+            if(c != ',')
+                throw parsing_exception("Expected ',' or ']' in JSON array!");
+        }
+    sink.bytes.push_back(static_cast<char>(Marker::Array_End));
+    spill();
+}
+
+/*!
+ * \brief unescapes the string whose opening quote is at \a pos into \a out.
+ * While the closing quote isn't in the window, the window is refilled, and grown, and the string started over
+ */
+void JsonToUbjson::read_string(std::string& out)
+{
+    for(;;)
+    {
+        out.clear();
+        const char* close = JsonReader::unescape(at() + 1, window.data() + end, out);
+        if(close)
+        {
+            pos = static_cast<std::size_t>(close - window.data()) + 1;
+            break;
+        }
+        if(not fill(end - pos + 1))
+            throw parsing_exception("Unterminated string in JSON text!");
+    }
+    JsonReader::check_string(vsz, out.data(), out.size());
+}
+
+void JsonToUbjson::convert_number()
+{
+    std::size_t n = 0;
+    for(;;)
+    {
+        while(pos + n < end and is_number_byte(window[pos + n]))
+            ++n;
+        if(pos + n < end or not fill(n + 1, 1))     //the byte after the number ends it
+            break;
+    }
+
+    Value number;
+    const char* last = JsonReader::read_number(at(), window.data() + end, number);
+    pos = static_cast<std::size_t>(last - window.data());
+    writer.writeValue(number);
+}
+
+void JsonToUbjson::convert_literal()
+{
+    //the literal, and the byte after it; fewer at the end of the input
+    const std::size_t size = window[pos] == 'f' ? 5 : 4;
+    if(end - pos <= size)
+        fill(size + 1, 1);
+    const std::size_t available = end - pos;
+    auto is = [&](const char* literal, std::size_t n)
+        {
+            return available >= n and std::memcmp(at(), literal, n) == 0 and
+                    (available == n or ends_token(window[pos + n]));
+        };
+
+    if(is("true", 4))
+    {
+        sink.bytes.push_back(static_cast<char>(Marker::True));
+        pos += 4;
+    }
+    else if(is("false", 5))
+    {
+        sink.bytes.push_back(static_cast<char>(Marker::False));
+        pos += 5;
+    }
+    else if(is("null", 4))
+    {
+        sink.bytes.push_back(static_cast<char>(Marker::Null));
+        pos += 4;
+    }
+    else
+        throw parsing_exception("Invalid literal in JSON text!");
+}
+
+//! the count then the bytes, as StreamWriter writes the payload of strings and keys
+void JsonToUbjson::write_sized(const std::string& bytes)
+{
+    writer.writeValue(static_cast<long long>(bytes.size()));
+    sink.write(bytes.data(), bytes.size());
+}
+
+void JsonToUbjson::spill()
+{
+    if(sink.bytes.size() < chunk_size)
+        return;
+    output.write(sink.bytes.data(), static_cast<std::streamsize>(sink.bytes.size()));
+    sink.bytes.clear();
+}
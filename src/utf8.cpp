@@ -0,0 +1,273 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+#include "utf8.hpp"
+#include "types.hpp"
+#include <cstring>
+#include <cstdint>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define UBJSON_UTF8_X86
+#include <immintrin.h>
+#endif
+
+using namespace ubjson;
+
+/////////////////  FREE FUNCTIONS
+
+namespace {
+
+    std::size_t validate_scalar(const byte* s, std::size_t size) noexcept
+    {
+        std::size_t i = 0;
+        while(i < size)
+        {
+            if(s[i] < 0x80)
+            {
+                //ASCII, eight bytes at a time
+                for(uint64_t word; i + 8 <= size; i += 8)
+                {
+                    std::memcpy(&word, s + i, 8);
+                    if(word & 0x8080808080808080ULL)
+                        break;
+                }
+                while(i < size && s[i] < 0x80)
+                    ++i;
+                continue;
+            }
+
+            //the second byte has a narrower range after some leading bytes; that rules out
+            //overlong forms (E0, F0), surrogates (ED) and code points beyond U+10FFFF (F4)
+            const byte lead = s[i];
+            std::size_t length;
+            byte low = 0x80, high = 0xBF;
+            if(lead >= 0xC2 && lead <= 0xDF)
+                length = 2;
+            else if(lead >= 0xE0 && lead <= 0xEF)
+            {
+                length = 3;
+                if(lead == 0xE0)
+                    low = 0xA0;
+                else if(lead == 0xED)
+                    high = 0x9F;
+            }
+            else if(lead >= 0xF0 && lead <= 0xF4)
+            {
+                length = 4;
+                if(lead == 0xF0)
+                    low = 0x90;
+                else if(lead == 0xF4)
+                    high = 0x8F;
+            }
+            else
+                return i;
+
+            if(size - i < length or s[i + 1] < low or s[i + 1] > high)
+                return i;
+            for(std::size_t k = 2; k < length; ++k)
+                if((s[i + k] & 0xC0) != 0x80)
+                    return i;
+            i += length;
+        }
+        return size;
+    }
+
+#ifdef UBJSON_UTF8_X86
+
+    /*
+     * The vector checks classify each pair of adjacent bytes by three table lookups: the high and low
+     * nibbles of the first byte and the high nibble of the second. A pair is an error when all three
+     * lookups share a bit. The bits are the ways a sequence can be wrong; whether the byte two or three
+     * back starts a 3 or 4 byte sequence is checked separately, as those continuations aren't errors.
+     */
+    enum : byte
+    {
+        TooShort = 1 << 0,      //a leading byte, or ASCII, where a continuation is due
+        TooLong = 1 << 1,       //a continuation after ASCII
+        Overlong3 = 1 << 2,
+        TooLarge = 1 << 3,
+        Surrogate = 1 << 4,
+        Overlong2 = 1 << 5,
+        TooLarge1000 = 1 << 6,
+        Overlong4 = 1 << 6,
+        TwoConts = 1 << 7,      //a continuation after a continuation; fine only inside 3 and 4 byte sequences
+        Carry = TooShort | TooLong | TwoConts
+    };
+
+    alignas(16) const byte first_high[16] = {
+        TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong, TooLong,
+        TwoConts, TwoConts, TwoConts, TwoConts,
+        TooShort | Overlong2,
+        TooShort,
+        TooShort | Overlong3 | Surrogate,
+        TooShort | TooLarge | TooLarge1000 | Overlong4
+    };
+
+    alignas(16) const byte first_low[16] = {
+        Carry | Overlong3 | Overlong2 | Overlong4,
+        Carry | Overlong2,
+        Carry,
+        Carry,
+        Carry | TooLarge,
+        Carry | TooLarge | TooLarge1000,
+        Carry | TooLarge | TooLarge1000,
+        Carry | TooLarge | TooLarge1000,
+        Carry | TooLarge | TooLarge1000,
+        Carry | TooLarge | TooLarge1000,
+        Carry | TooLarge | TooLarge1000,
+        Carry | TooLarge | TooLarge1000,
+        Carry | TooLarge | TooLarge1000,
+        Carry | TooLarge | TooLarge1000 | Surrogate,
+        Carry | TooLarge | TooLarge1000,
+        Carry | TooLarge | TooLarge1000
+    };
+
+    alignas(16) const byte second_high[16] = {
+        TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort, TooShort,
+        TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge1000 | Overlong4,
+        TooLong | Overlong2 | TwoConts | Overlong3 | TooLarge,
+        TooLong | Overlong2 | TwoConts | Surrogate | TooLarge,
+        TooLong | Overlong2 | TwoConts | Surrogate | TooLarge,
+        TooShort, TooShort, TooShort, TooShort
+    };
+
+    //! a block ending in any byte above these ends inside a sequence
+    alignas(32) const byte incomplete_above[32] = {
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xef, 0xdf, 0xbf
+    };
+
+    /*!
+     * \brief the offset where a scalar check may resume, when the vector check stopped at \a i.
+     * Everything before \a i was valid, but the last sequence there may not be complete
+     */
+    std::size_t resume_point(const byte* s, std::size_t i) noexcept
+    {
+        if(i == 0)
+            return 0;
+        std::size_t b = i - 1;
+        while(b > 0 && i - b < 4 && (s[b] & 0xC0) == 0x80)
+            --b;
+        const std::size_t length = s[b] >= 0xF0 ? 4 : s[b] >= 0xE0 ? 3 : s[b] >= 0xC0 ? 2 : 1;
+        return b + length > i ? b : i;
+    }
+
+    /*!
+     * \brief checks whole blocks of 16 bytes, until the first block with an error
+     * \return where the scalar check should take over
+     */
+    __attribute__((target("ssse3")))
+    std::size_t validate_ssse3(const byte* s, std::size_t size) noexcept
+    {
+        const __m128i t1 = _mm_load_si128(reinterpret_cast<const __m128i*>(first_high));
+        const __m128i t2 = _mm_load_si128(reinterpret_cast<const __m128i*>(first_low));
+        const __m128i t3 = _mm_load_si128(reinterpret_cast<const __m128i*>(second_high));
+        const __m128i last = _mm_loadu_si128(reinterpret_cast<const __m128i*>(incomplete_above + 16));
+        const __m128i nibble = _mm_set1_epi8(0x0f);
+        const __m128i zero = _mm_setzero_si128();
+
+        __m128i prev = zero, incomplete = zero;
+        std::size_t i = 0;
+        for(; i + 16 <= size; i += 16)
+        {
+            const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+            __m128i error = incomplete;
+            if(_mm_movemask_epi8(in) != 0)
+            {
+                const __m128i prev1 = _mm_alignr_epi8(in, prev, 15);
+                const __m128i special = _mm_and_si128(
+                            _mm_and_si128(_mm_shuffle_epi8(t1, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+                                          _mm_shuffle_epi8(t2, _mm_and_si128(prev1, nibble))),
+                            _mm_shuffle_epi8(t3, _mm_and_si128(_mm_srli_epi16(in, 4), nibble)));
+                const __m128i third = _mm_subs_epu8(_mm_alignr_epi8(in, prev, 14), _mm_set1_epi8(0xe0 - 0x80));
+                const __m128i fourth = _mm_subs_epu8(_mm_alignr_epi8(in, prev, 13), _mm_set1_epi8(0xf0 - 0x80));
+                const __m128i must23 = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8(char(0x80)));
+                error = _mm_xor_si128(must23, special);
+            }
+            if(_mm_movemask_epi8(_mm_cmpeq_epi8(error, zero)) != 0xffff)
+                break;
+            incomplete = _mm_subs_epu8(in, last);
+            prev = in;
+        }
+        return resume_point(s, i);
+    }
+
+    //! the same as validate_ssse3(), 32 bytes at a time
+    __attribute__((target("avx2")))
+    std::size_t validate_avx2(const byte* s, std::size_t size) noexcept
+    {
+        const __m256i t1 = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(first_high)));
+        const __m256i t2 = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(first_low)));
+        const __m256i t3 = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(second_high)));
+        const __m256i last = _mm256_load_si256(reinterpret_cast<const __m256i*>(incomplete_above));
+        const __m256i nibble = _mm256_set1_epi8(0x0f);
+
+        __m256i prev = _mm256_setzero_si256(), incomplete = _mm256_setzero_si256();
+        std::size_t i = 0;
+        for(; i + 32 <= size; i += 32)
+        {
+            const __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+            __m256i error = incomplete;
+            if(_mm256_movemask_epi8(in) != 0)
+            {
+                //the last 16 bytes of prev, then the first 16 of in; alignr works within 128 bit lanes
+                const __m256i carried = _mm256_permute2x128_si256(prev, in, 0x21);
+                const __m256i prev1 = _mm256_alignr_epi8(in, carried, 15);
+                const __m256i special = _mm256_and_si256(
+                            _mm256_and_si256(_mm256_shuffle_epi8(t1, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+                                             _mm256_shuffle_epi8(t2, _mm256_and_si256(prev1, nibble))),
+                            _mm256_shuffle_epi8(t3, _mm256_and_si256(_mm256_srli_epi16(in, 4), nibble)));
+                const __m256i third = _mm256_subs_epu8(_mm256_alignr_epi8(in, carried, 14), _mm256_set1_epi8(0xe0 - 0x80));
+                const __m256i fourth = _mm256_subs_epu8(_mm256_alignr_epi8(in, carried, 13), _mm256_set1_epi8(0xf0 - 0x80));
+                const __m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8(char(0x80)));
+                error = _mm256_xor_si256(must23, special);
+            }
+            if(not _mm256_testz_si256(error, error))
+                break;
+            incomplete = _mm256_subs_epu8(in, last);
+            prev = in;
+        }
+        return resume_point(s, i);
+    }
+
+    using VectorCheck = std::size_t (*)(const byte*, std::size_t);
+
+    VectorCheck pick_vector_check()
+    {
+        __builtin_cpu_init();
+        if(__builtin_cpu_supports("avx2"))
+            return validate_avx2;
+        if(__builtin_cpu_supports("ssse3"))
+            return validate_ssse3;
+        return nullptr;
+    }
+
+#endif // UBJSON_UTF8_X86
+
+    //! below this, the scalar check with its ASCII fast path is as quick
+    constexpr std::size_t min_vector_size = 32;
+
+}
+
+
+std::size_t ubjson::validateUtf8(const char* text, std::size_t size) noexcept
+{
+    const byte* s = reinterpret_cast<const byte*>(text);
+    std::size_t i = 0;
+#ifdef UBJSON_UTF8_X86
+    static const VectorCheck vector_check = pick_vector_check();
+    if(size >= min_vector_size and vector_check)
+        i = vector_check(s, size);
+#endif
+    return i + validate_scalar(s + i, size - i);
+}
@@ -0,0 +1,375 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+#include "validator.hpp"
+#include <cstdint>
+
+using namespace ubjson;
+
+/////////////////  FREE FUNCTIONS
+
+namespace {
+
+    //! what follows a marker: a payload of 0 to 8 bytes, or one of these
+    enum Kind : signed char
+    {
+        Bad = -1, Sized = -2, ArrayKind = -3, ObjectKind = -4
+    };
+
+    struct KindTable
+    {
+        signed char kind[256];
+        constexpr KindTable() : kind{}
+        {
+            for(auto& k : kind)
+                k = Bad;
+            kind[static_cast<byte>(Marker::Null)]    = 0;
+            kind[static_cast<byte>(Marker::No_Op)]   = 0;
+            kind[static_cast<byte>(Marker::True)]    = 0;
+            kind[static_cast<byte>(Marker::False)]   = 0;
+            kind[static_cast<byte>(Marker::Char)]    = 1;
+            kind[static_cast<byte>(Marker::Int8)]    = 1;
+            kind[static_cast<byte>(Marker::Uint8)]   = 1;
+            kind[static_cast<byte>(Marker::Int16)]   = 2;
+            kind[static_cast<byte>(Marker::Int32)]   = 4;
+            kind[static_cast<byte>(Marker::Float32)] = 4;
+            kind[static_cast<byte>(Marker::Int64)]   = 8;
+            kind[static_cast<byte>(Marker::Float64)] = 8;
+            kind[static_cast<byte>(Marker::HighPrecision)] = Sized;
+            kind[static_cast<byte>(Marker::String)]  = Sized;
+            kind[static_cast<byte>(Marker::Binary)]  = Sized;
+            kind[static_cast<byte>(Marker::Array_Start)]  = ArrayKind;
+            kind[static_cast<byte>(Marker::Object_Start)] = ObjectKind;
+        }
+    };
+
+    constexpr KindTable marker_kind{};
+
+    const char* const end_of_buffer = "Unexpected end of buffer!";
+    const char* const object_too_big = "Maximum Object size exceeded!";
+    const char* const string_too_big = "Maximum String size exceeded!";
+    const char* const too_many_items = "Maximum container items exceeded!";
+    const char* const invalid_marker = "Invalid marker encountered!";
+
+    inline bool is_digit(byte b) { return b >= '0' && b <= '9'; }
+
+    //! -? (0 | [1-9][0-9]*) (.[0-9]+)? ([eE][+-]?[0-9]+)?  ; the same grammar as HighPrecisionNumber::isValid()
+    bool is_number(const byte* s, std::size_t size)
+    {
+        std::size_t i = 0;
+        auto digits = [&]() -> std::size_t
+            {
+                const std::size_t start = i;
+                while(i < size && is_digit(s[i]))
+                    ++i;
+                return i - start;
+            };
+
+        if(i < size && s[i] == '-')
+            ++i;
+        if(i >= size)
+            return false;
+        if(s[i] == '0')
+            ++i;
+        else if(digits() == 0)
+            return false;
+
+        if(i < size && s[i] == '.')
+        {
+            ++i;
+            if(digits() == 0)
+                return false;
+        }
+        if(i < size && (s[i] == 'e' || s[i] == 'E'))
+        {
+            ++i;
+            if(i < size && (s[i] == '+' || s[i] == '-'))
+                ++i;
+            if(digits() == 0)
+                return false;
+        }
+        return i == size;
+    }
+
+    /*!
+     * \brief walks one document, recursively; nothing throws and nothing is allocated.
+     * The first failure is kept in \ref where and \ref error
+     */
+    class Walker
+    {
+    public:
+        Walker(const byte* limit, bool clipped, const ValueSizePolicy& policy, bool check_utf8)
+            : end(limit), size_limited(clipped), vsz(policy), utf8(check_utf8) {}
+
+        //! walks the document at \a p; \post \a p is just past it
+        bool document(const byte*& p)
+        {
+            if(p == end)
+                return truncated(p);
+            const byte* at = p;
+            const byte m = *p++;
+            if(marker_kind.kind[m] == Bad)
+                return fail(at, invalid_marker);
+            return value(p, m, at, 0);
+        }
+
+        const byte* where = nullptr;
+        const char* error = nullptr;
+
+    private:
+        bool fail(const byte* at, const char* what)
+        {
+            where = at;
+            error = what;
+            return false;
+        }
+
+        //! running into \ref end means a truncated document, or one beyond max_object_size
+        bool truncated(const byte* at)
+        { return size_limited ? fail(end, object_too_big) : fail(at, end_of_buffer); }
+
+        bool value(const byte*& p, byte m, const byte* at, std::size_t depth);
+        bool container(const byte*& p, bool is_object, const byte* at, std::size_t depth);
+        bool count(const byte*& p, std::size_t& n);
+        bool sized(const byte*& p, std::size_t limit, const char* what, std::size_t& n);
+        bool string(const byte*& p);
+
+        const byte* const end;
+        const bool size_limited;
+        const ValueSizePolicy& vsz;
+        const bool utf8;
+    };
+
+    //! \a p is at the payload of \a m, a valid marker; \a at is where the value starts
+    bool Walker::value(const byte*& p, byte m, const byte* at, std::size_t depth)
+    {
+        const signed char kind = marker_kind.kind[m];
+        if(kind >= 0)
+        {
+            if(end - p < kind)
+                return truncated(at);
+            p += kind;
+            return true;
+        }
+        if(kind != Sized)
+            return container(p, kind == ObjectKind, at, depth);
+
+        if(isString(m))
+            return string(p);
+
+        std::size_t n;
+        if(isBinary(m))
+        {
+            if(not sized(p, vsz.max_binary_size, "Maximum Binary size exceeded!", n))
+                return false;
+        }
+        else
+        {
+            if(not sized(p, vsz.max_string_size, string_too_big, n))
+                return false;
+            if(not is_number(p, n))
+                return fail(p, "Invalid high precision number encountered!");
+        }
+        p += n;
+        return true;
+    }
+
+    bool Walker::container(const byte*& p, bool is_object, const byte* at, std::size_t depth)
+    {
+        if(depth >= vsz.max_value_depth)
+            return fail(at, "Maximum Parsing depth Exceeded!");
+        const std::size_t max_items = is_object ? vsz.max_object_items : vsz.max_array_items;
+
+        byte type = 0;
+        bool typed = false;
+        if(p != end and isOptimized_Type(*p))
+        {
+            if(end - p < 3)
+                return truncated(p);
+            type = p[1];
+            if(marker_kind.kind[type] == Bad)
+                return fail(p + 1, invalid_marker);
+            typed = true;
+            p += 2;
+            if(not isOptimized_Count(*p))
+                return fail(p, "A typed container must be followed by a count!");
+        }
+
+        if(p != end and isOptimized_Count(*p))
+        {
+            const byte* counted = p++;
+            std::size_t n;
+            if(not count(p, n))
+                return false;
+            if(n > max_items)
+                return fail(counted, too_many_items);
+
+            const int width = typed ? marker_kind.kind[type] : -1;
+            if(width >= 0 and not is_object)       //fixed size elements are checked in one step
+            {
+                if(width > 0 and n > static_cast<std::size_t>(end - p) / width)
+                    return truncated(p);
+                p += n * width;
+                return true;
+            }
+            for(std::size_t i = 0; i < n; ++i)
+            {
+                if(is_object and not string(p))
+                    return false;
+                if(typed)
+                {
+                    if(not value(p, type, p, depth + 1))
+                        return false;
+                    continue;
+                }
+                if(p == end)
+                    return truncated(p);
+                const byte* item = p;
+                const byte m = *p++;
+                if(marker_kind.kind[m] == Bad)
+                    return fail(item, invalid_marker);
+                if(not value(p, m, item, depth + 1))
+                    return false;
+            }
+            return true;
+        }
+
+        const byte close = static_cast<byte>(is_object ? Marker::Object_End : Marker::Array_End);
+        for(std::size_t i = 0; ; ++i)
+        {
+            if(p == end)
+                return truncated(p);
+            if(*p == close)
+            {
+                ++p;
+                return true;
+            }
+            if(i == max_items)
+                return fail(p, too_many_items);
+            if(is_object)
+            {
+                if(not string(p))
+                    return false;
+                if(p == end)
+                    return truncated(p);
+            }
+            const byte* item = p;
+            const byte m = *p++;
+            if(marker_kind.kind[m] == Bad)
+                return fail(item, invalid_marker);
+            if(not value(p, m, item, depth + 1))
+                return false;
+        }
+    }
+
+    //! reads a count at \a p; \post \a p is just past it
+    bool Walker::count(const byte*& p, std::size_t& n)
+    {
+        if(p == end)
+            return truncated(p);
+        const byte* at = p;
+        const byte m = *p++;
+        const int width = isInteger(m) ? marker_kind.kind[m] : -1;
+        if(width < 0)
+            return fail(at, "Invalid count token encountered!");
+        if(end - p < width)
+            return truncated(at);
+
+        byte* b = const_cast<byte*>(p);
+        long long v;
+        switch (static_cast<Marker>(m)) {
+        case Marker::Uint8:
+            v = fromBigEndian8(b);
+            break;
+        case Marker::Int8:
+            v = static_cast<int8_t>(fromBigEndian8(b));
+            break;
+        case Marker::Int16:
+            v = static_cast<int16_t>(fromBigEndian16(b));
+            break;
+        case Marker::Int32:
+            v = static_cast<int32_t>(fromBigEndian32(b));
+            break;
+        default:
+            v = static_cast<int64_t>(fromBigEndian64(b));
+            break;
+        }
+        if(v < 0)
+            return fail(at, "Negative count token encountered!");
+        p += width;
+        n = static_cast<std::size_t>(v);
+        return true;
+    }
+
+    /*!
+     * \brief reads the count of a sized payload, and checks it against \a limit and the buffer
+     * \post \a p is at the first byte of the payload
+     */
+    bool Walker::sized(const byte*& p, std::size_t limit, const char* what, std::size_t& n)
+    {
+        const byte* at = p;
+        if(not count(p, n))
+            return false;
+        if(n > limit)
+            return fail(at, what);
+        if(n > static_cast<std::size_t>(end - p))
+            return truncated(at);
+        return true;
+    }
+
+    //! a string payload or a key; \post \a p is just past it
+    bool Walker::string(const byte*& p)
+    {
+        std::size_t n;
+        if(not sized(p, vsz.max_string_size, string_too_big, n))
+            return false;
+        if(utf8)
+        {
+            const std::size_t bad = validateUtf8(reinterpret_cast<const char*>(p), n);
+            if(bad != n)
+                return fail(p + bad, "Invalid UTF-8 encountered!");
+        }
+        p += n;
+        return true;
+    }
+
+}
+
+
+namespace ubjson {
+
+ValidationResult validate(const byte* data, std::size_t size, const ValueSizePolicy& policy, bool check_utf8) noexcept
+{
+    if(size == 0)
+        return { false, 0, end_of_buffer, 0 };
+
+    ValidationResult result{ true, size, nullptr, 0 };
+    const byte* p = data;
+    const byte* const end = data + size;
+    while(p != end)
+    {
+        const bool clipped = static_cast<std::size_t>(end - p) > policy.max_object_size;
+        Walker walker(clipped ? p + policy.max_object_size : end, clipped, policy, check_utf8 or policy.validate_utf8);
+        if(not walker.document(p))
+            return { false, static_cast<std::size_t>(walker.where - data), walker.error, result.documents };
+        ++result.documents;
+    }
+    return result;
+}
+
+ValidationResult validate(const char* data, std::size_t size, const ValueSizePolicy& policy, bool check_utf8) noexcept
+{
+    return validate(reinterpret_cast<const byte*>(data), size, policy, check_utf8);
+}
+
+}   //end namespace ubjson
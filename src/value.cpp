@@ -13,10 +13,12 @@
 
 
 #include "value.hpp"
+#include "json_writer.hpp"
 #include <cmath>
 #include <limits>
 #include <cstring>
 #include <algorithm>
+#include <atomic>
 #include <iostream>
 
 using namespace ubjson;
@@ -29,9 +31,9 @@ template<>
 inline Value::ArrayType unique_ptr_copy(const Value::ArrayType& src)
 {
     Value::ArrayType rtn;
+    rtn.reserve(src.size());
     for(auto& v : src)
         rtn.emplace_back( std::make_unique<Value>(*v) );
-    rtn.shrink_to_fit();
     return rtn;
 }
 
@@ -39,6 +41,7 @@ template<>
 inline Value::MapType unique_ptr_copy(const Value::MapType& src)
 {
     Value::MapType rtn;
+    rtn.reserve(src.size());
     for(auto& v : src)
         rtn.emplace( std::make_pair(v.first, std::make_unique<Value>(*(v.second)) ));
     return rtn;
@@ -54,9 +57,8 @@ inline bool is_equal(const Value::MapType& lhs, const Value::MapType& rhs)
 
     for(const auto& val : lhs)
     {
-        if(rhs.find(val.first) == rhs.end())
-            return false;
-        if(!(*(lhs.at(val.first)) == *(rhs.at(val.first))))
+        auto it = rhs.find(val.first);
+        if(it == rhs.end() || !(*(val.second) == *(it->second)))
             return false;
     }
     return true;
@@ -71,8 +73,199 @@ inline bool is_equal(const Value::ArrayType& lhs, const Value::ArrayType& rhs)
                      );
 }
 
+/////////////////  HASHING
+
+constexpr std::uint64_t hash_multiplier = 0x9e3779b97f4a7c15ULL;
+
+inline std::uint64_t rotl(std::uint64_t x, int r) noexcept
+{ return (x << r) | (x >> (64 - r)); }
+
+//! the final mix of MurmurHash3; every input bit affects every output bit
+inline std::uint64_t hash_mix(std::uint64_t h) noexcept
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    return h ^ (h >> 33);
+}
+
+inline std::uint64_t hash_step(std::uint64_t h, std::uint64_t word) noexcept
+{ return rotl((h ^ word) * hash_multiplier, 31); }
+
+inline std::uint64_t load_word(const unsigned char* p) noexcept
+{
+    std::uint64_t word;
+    std::memcpy(&word, p, sizeof word);
+    return word;
+}
+
+/*!
+ * \brief hashes \a size bytes. Long inputs are consumed 32 bytes at a time by four independent lanes,
+ * which the compiler can keep in vector registers, or at least overlap
+ */
+inline std::uint64_t hash_bytes(const void* data, std::size_t size, std::uint64_t seed) noexcept
+{
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    std::uint64_t h = seed ^ (size * hash_multiplier);
+
+    if(size >= 32)
+    {
+        std::uint64_t lanes[4] = { h, h ^ hash_multiplier, rotl(h, 17), rotl(h, 47) };
+        for(; size >= 32; size -= 32, p += 32)
+            for(int i = 0; i < 4; i++)
+                lanes[i] = hash_step(lanes[i], load_word(p + 8 * i));
+        h = hash_mix(lanes[0]) ^ rotl(hash_mix(lanes[1]), 16) ^ rotl(hash_mix(lanes[2]), 32) ^ rotl(hash_mix(lanes[3]), 48);
+    }
+    for(; size >= 8; size -= 8, p += 8)
+        h = hash_step(h, load_word(p));
+    if(size)
+    {
+        std::uint64_t tail = 0;
+        std::memcpy(&tail, p, size);
+        h = hash_step(h, tail);
+    }
+    return hash_mix(h);
+}
+
+//! seeds, so that equal bytes of different types hash apart
+enum HashSeed : std::uint64_t
+{
+    null_seed = 0x6e756c6c, bool_seed, char_seed, negative_seed, integer_seed, float_seed,
+    string_seed, binary_seed, high_precision_seed, array_seed, map_seed
+};
+
+inline std::uint64_t hash_integer(long long i) noexcept
+{ return hash_mix(static_cast<std::uint64_t>(i) ^ (i < 0 ? negative_seed : integer_seed)); }
+
+inline std::uint64_t hash_integer(unsigned long long u) noexcept
+{ return hash_mix(u ^ integer_seed); }
+
+//! folded to 32 bits to fit the cache in Value; 0 means "not cached", so it never comes out of here
+inline std::uint32_t fold_hash(std::uint64_t h) noexcept
+{
+    const std::uint32_t folded = static_cast<std::uint32_t>(h ^ (h >> 32));
+    return folded ? folded : 1;
+}
+
+/////////////////  ORDERING
+
+template<typename T>
+inline int three_way(const T& lhs, const T& rhs) noexcept
+{ return lhs < rhs ? -1 : (rhs < lhs ? 1 : 0); }
+
+constexpr double two_pow_63 = 9223372036854775808.0;
+constexpr double two_pow_64 = 18446744073709551616.0;
+
+//! compares a double with an integer exactly; NaN is above every number
+inline int compare_exact(double d, long long i) noexcept
+{
+    if(std::isnan(d) or d >= two_pow_63)
+        return 1;
+    if(d < -two_pow_63)
+        return -1;
+    const double whole = std::trunc(d);
+    if(const int c = three_way(static_cast<long long>(whole), i))
+        return c;
+    return three_way(d, whole);
+}
+
+inline int compare_exact(double d, unsigned long long u) noexcept
+{
+    if(std::isnan(d) or d >= two_pow_64)
+        return 1;
+    if(d < 0)
+        return -1;
+    const double whole = std::trunc(d);
+    if(const int c = three_way(static_cast<unsigned long long>(whole), u))
+        return c;
+    return three_way(d, whole);
+}
+
+inline int compare_exact(long long i, unsigned long long u) noexcept
+{ return i < 0 ? -1 : three_way(static_cast<unsigned long long>(i), u); }
+
+inline int compare_exact(double lhs, double rhs) noexcept
+{
+    if(std::isnan(lhs) or std::isnan(rhs))      //NaNs are all equal to each other
+        return three_way(std::isnan(lhs), std::isnan(rhs));
+    return three_way(lhs, rhs);
+}
+
+/*!
+ * \brief where each Type sorts; the numeric types share a rank and are ordered by value
+ * \note HighPrecision isn't numeric to operator ==, so it has its own rank
+ */
+inline int type_rank(Type t) noexcept
+{
+    switch (t) {
+    case Type::Null:            return 0;
+    case Type::Bool:            return 1;
+    case Type::SignedInt:
+    case Type::UnsignedInt:
+    case Type::Float:           return 2;
+    case Type::HighPrecision:   return 3;
+    case Type::Char:            return 4;
+    case Type::String:          return 5;
+    case Type::Binary:          return 6;
+    case Type::Array:           return 7;
+    case Type::Map:             return 8;
+    }
+    return 9;
+}
+
 //////////////// VALUE IMpl
 
+struct Value::ArrayIndex
+{
+    using Items = std::unordered_multimap<std::size_t, const Value*>;
+    Items items;
+    std::vector<const Value*> unhashed;     //handed out by operator [], so they may change unseen
+
+    void add(const Value* item)
+    {
+        if(item->referenced)
+            unhashed.push_back(item);
+        else
+            items.emplace(item->hash(), item);
+    }
+
+    void erase(const Value* item)
+    {
+        if(not item->referenced)
+        {
+            erase_hashed(item);
+            return;
+        }
+        auto entry = std::find(unhashed.begin(), unhashed.end(), item);
+        if(entry != unhashed.end())
+            unhashed.erase(entry);
+    }
+
+    //! moves \a item, which operator [] is about to hand out, to the items searched one by one
+    void unhash(const Value* item)
+    {
+        unhashed.push_back(item);
+        erase_hashed(item);
+    }
+
+private:
+    void erase_hashed(const Value* item)
+    {
+        auto range = items.equal_range(item->hash());
+        auto entry = std::find_if(range.first, range.second, [item](const Items::value_type& e){ return e.second == item; });
+        if(entry != range.second)
+            items.erase(entry);
+    }
+};
+
+constexpr std::size_t Value::min_indexed_items;
+
+Value::ArrayStorage::~ArrayStorage()
+{
+    delete index.load(std::memory_order_relaxed);
+}
+
 
 Value::Value()
     : vtype(Type::Null)
@@ -106,6 +299,18 @@ Value::Value(BinaryType b)
     : vtype(Type::Binary)
 {   construct_fromBinary(std::move(b)); }
 
+Value::Value(ArrayType a)
+    : vtype(Type::Array)
+{   construct_fromArray(std::move(a)); }
+
+Value::Value(MapType m)
+    : vtype(Type::Map)
+{   construct_fromMap(std::move(m)); }
+
+Value::Value(HighPrecisionType h)
+    : vtype(Type::HighPrecision)
+{   construct_fromHighPrecision(std::move(h)); }
+
 Value::Value(std::string s)
     : vtype(Type::String)
 {   construct_fromString(std::move(s)); }
@@ -136,7 +341,7 @@ Value::Value(const std::string& key, Value val)
 }
 
 
-Value::Value(Value&& v)
+Value::Value(Value&& v) noexcept
     : Value()
 {   move_from(std::move(v)); }
 
@@ -153,7 +358,7 @@ Value& Value::operator = (const Value& v)
     return *this;
 }
 
-Value& Value::operator = (Value&& v)
+Value& Value::operator = (Value&& v) noexcept
 {
     move_from(std::move(v));
     return *this;
@@ -171,9 +376,9 @@ size_t Value::size() const noexcept
     case Type::Null:
         return 0;
     case Type::Array:
-        return value.Array.size();
+        return array().size();
     case Type::Map:
-        return value.Map.size();
+        return map().size();
     default:
         return 1;
     }
@@ -185,33 +390,47 @@ Type Value::type() const noexcept
 Value& Value::operator [] (int i)
 {
     if(vtype == Type::Array)
-        return *(value.Array[i]);
+    {
+        Value& item = *(array_keeping_index()[i]);
+        if(not item.referenced)     //it may be kept and changed through, unseen by the index
+        {
+            if(ArrayIndex* index = value.Array->index.load(std::memory_order_relaxed))
+                index->unhash(&item);
+            item.referenced = true;
+        }
+        value.Array->referenced = true;
+        return item;
+    }
     throw value_exception("Attempt to index 'Value'; 'Value' is not an Array!");
 }
 
 Value const& Value::operator [] (int i) const
 {
     if(vtype == Type::Array)
-        return *(value.Array[i]);
+        return *(array()[i]);
     throw value_exception("Attempt to index 'Value const&'; 'Value const&' is not an Array!");
 }
 
 Value& Value::operator [] (const std::string& s)
 {
-    if(vtype == Type::Map)
-    {
-        if(value.Map.find(s) == value.Map.end())
-            value.Map.emplace( std::make_pair(s, std::make_unique<Value>(Value())));
-        return *(value.Map[s]);
-    }
     if(vtype == Type::Null)
     {
         // convert to Map
         destruct();
         construct_fromMap(MapType());
         vtype = Type::Map;
-        value.Map.emplace( std::make_pair(s, std::make_unique<Value>(Value())));
-        return *(value.Map[s]);
+    }
+    if(vtype == Type::Map)
+    {
+        MapType& members = modify_map();
+        auto iter = members.find(s);
+        if(iter == members.end())
+        {
+            iter = members.emplace(s, std::make_unique<Value>()).first;
+            value.Map->leaked = false;      //its iterators are invalidated
+        }
+        value.Map->referenced = true;
+        return *(iter->second);
     }
     throw value_exception("Attempt to index 'Value'; 'Value' is not a Key-Value pair (aka Object) !");
 }
@@ -219,7 +438,7 @@ Value& Value::operator [] (const std::string& s)
 Value const& Value::operator [] (const std::string& s) const
 {
     if(vtype == Type::Map)
-        return *(const_cast<const MapType&>(value.Map).at(s));
+        return *(map().at(s));
     throw value_exception("Attempt to index 'Value const&'; 'Value const&' is not a Key-Value pair (aka Object) !");
 }
 
@@ -236,14 +455,16 @@ void Value::push_back(Value&& v)
         construct_fromArray(ArrayType());
         vtype = Type::Array;
     case Type::Array:
-        value.Array.emplace_back( std::make_unique<Value>( std::move(v) ) );
+        array_keeping_index().emplace_back( std::make_unique<Value>( std::move(v) ) );
+        index_appended();
+        value.Array->leaked = false;    //its iterators are invalidated
         break;
     default:
     {
         Value tmp(std::move(*this));
         construct_fromArray(ArrayType());
-        value.Array.emplace_back(std::make_unique<Value>( std::move(tmp) ));
-        value.Array.emplace_back(std::make_unique<Value>( std::move(v) ));
+        modify_array().emplace_back(std::make_unique<Value>( std::move(tmp) ));
+        modify_array().emplace_back(std::make_unique<Value>( std::move(v) ));
         vtype = Type::Array;
         break;
     }
@@ -258,14 +479,16 @@ void Value::push_back(const Value& v)
         construct_fromArray(ArrayType());
         vtype = Type::Array;
     case Type::Array:
-        value.Array.emplace_back( std::make_unique<Value>(v) );
+        array_keeping_index().emplace_back( std::make_unique<Value>(v) );
+        index_appended();
+        value.Array->leaked = false;
         break;
     default:
     {
         Value tmp(std::move(*this));
         construct_fromArray(ArrayType());
-        value.Array.emplace_back(std::make_unique<Value>( std::move(tmp) ));
-        value.Array.emplace_back(std::make_unique<Value>( v ));
+        modify_array().emplace_back(std::make_unique<Value>( std::move(tmp) ));
+        modify_array().emplace_back(std::make_unique<Value>( v ));
         vtype = Type::Array;
         break;
     }
@@ -278,14 +501,31 @@ void Value::remove(const Value& v)
     switch (vtype) {
     case Type::Array:
     {
-        auto it = std::find_if(value.Array.begin(), value.Array.end(),
-                     [&v](const auto& m){ return v == *m; } );
-        if(it != value.Array.end() )
-            value.Array.erase(it);
+        //looked up without copying shared items; they are copied only when something is removed
+        const ArrayType& items = static_cast<const Value&>(*this).array();
+        auto it = find_item(v);
+        if(it != items.end() )
+        {
+            const auto position = it - items.begin();
+            const Value* removed = it->get();
+            ArrayType& owned = array_keeping_index();
+            if(ArrayIndex* index = value.Array->index.load(std::memory_order_relaxed))    //not if the items were just copied
+                index->erase(removed);
+            owned.erase(owned.begin() + position);
+            value.Array->leaked = false;
+        }
         break;
     }
     case Type::Map:
-        value.Map.erase(v.asString());
+    {
+        const std::string key = v.asString();
+        if(static_cast<const Value&>(*this).map().count(key))
+        {
+            modify_map().erase(key);
+            value.Map->leaked = false;
+        }
+        break;
+    }
     default:
         break;
     }
@@ -296,16 +536,17 @@ Value::iterator Value::find(const Value& v)
     switch (vtype) {
     case Type::Array:
     {
-        auto it = std::find_if(value.Array.begin(), value.Array.end(),
-                     [&v](const auto& m){ return v == *m; } );
-        if(it == value.Array.end() )
+        //the iterator allows modification, so the index is dropped, but only if something was found
+        const auto it = find_item(v);
+        if(it == static_cast<const Value&>(*this).array().end())
             return end();
-        return iterator(this, it);
+        const auto position = it - static_cast<const Value&>(*this).array().begin();
+        return iterator(this, array().begin() + position);
     }
     case Type::Map:
     {
-        auto it = value.Map.find(v.asString());
-        if(it == value.Map.end())
+        auto it = map().find(v.asString());
+        if(it == map().end())
             return end();
         return iterator(this, it);
     }
@@ -321,16 +562,15 @@ Value::const_iterator Value::find(const Value& v) const
     switch (vtype) {
     case Type::Array:
     {
-        auto it = std::find_if(value.Array.begin(), value.Array.end(),
-                     [&v](const auto& m){ return v == *m; } );
-        if(it == value.Array.end() )
+        auto it = find_item(v);
+        if(it == array().end() )
             return end();
         return const_iterator(this, it);
     }
     case Type::Map:
     {
-        auto it = value.Map.find(v);
-        if(it == value.Map.end())
+        auto it = map().find(v);
+        if(it == map().end())
             return end();
         return const_iterator(this, it);
     }
@@ -341,7 +581,16 @@ Value::const_iterator Value::find(const Value& v) const
 }
 
 bool Value::contains(const Value& v) const
-{ return find(v) != end(); }
+{
+    if(vtype != Type::Array or array().size() < min_indexed_items or value.Array->leaked)
+        return find(v) != end();
+
+    //the position isn't needed
+    const ArrayIndex& index = array_index();
+    auto range = index.items.equal_range(v.hash());
+    return std::any_of(range.first, range.second, [&v](const ArrayIndex::Items::value_type& e){ return v == *e.second; })
+        or std::any_of(index.unhashed.begin(), index.unhashed.end(), [&v](const Value* item){ return v == *item; });
+}
 
 Value::Keys Value::keys() const
 {
@@ -349,14 +598,44 @@ Value::Keys Value::keys() const
         return Keys();
 
     Keys rtn;
-    for(const auto& k : value.Map)
+    rtn.reserve(map().size());
+    for(const auto& k : map())
         rtn.push_back( k.first );
     return rtn;
 }
 
+iterator_range<Value::member_iterator> Value::items()
+{
+    if(!isMap())
+        return {};
+    return { member_iterator(map().begin()), member_iterator(map().end()) };
+}
+
+iterator_range<Value::const_member_iterator> Value::items() const
+{
+    if(!isMap())
+        return {};
+    return { const_member_iterator(map().begin()), const_member_iterator(map().end()) };
+}
+
+iterator_range<Value::array_iterator> Value::elements()
+{
+    if(!isArray())
+        return {};
+    return { array_iterator(array().begin()), array_iterator(array().end()) };
+}
+
+iterator_range<Value::const_array_iterator> Value::elements() const
+{
+    if(!isArray())
+        return {};
+    return { const_array_iterator(array().begin()), const_array_iterator(array().end()) };
+}
+
 bool Value::isNull()    const noexcept { return vtype == Type::Null;   }
 bool Value::isArray()   const noexcept { return vtype == Type::Array;  }
 bool Value::isBinary()  const noexcept { return vtype == Type::Binary; }
+bool Value::isHighPrecision() const noexcept { return vtype == Type::HighPrecision; }
 bool Value::isBool()    const noexcept { return vtype == Type::Bool;   }
 bool Value::isChar()    const noexcept { return vtype == Type::Char;   }
 bool Value::isFloat()   const noexcept { return vtype == Type::Float;  }
@@ -375,6 +654,169 @@ bool Value::isComparableWith(const Value &rhs) const noexcept
     return (isNumeric() && rhs.isNumeric());
 }
 
+std::size_t Value::hash() const noexcept
+{
+    switch (vtype) {
+    case Type::SignedInt:
+        return hash_integer(value.SignedInt);
+    case Type::UnsignedInt:
+        return hash_integer(value.UnsignedInt);
+    case Type::Float:
+    {
+        //a double equal to an integer hashes as that integer
+        double d = value.Float;
+        if(std::trunc(d) == d and d >= -two_pow_63 and d < 0)
+            return hash_integer(static_cast<long long>(d));
+        if(std::trunc(d) == d and d >= 0 and d < two_pow_64)
+            return hash_integer(static_cast<unsigned long long>(d));
+        if(std::isnan(d))
+            d = std::numeric_limits<double>::quiet_NaN();
+        std::uint64_t bits;
+        std::memcpy(&bits, &d, sizeof bits);
+        return hash_mix(bits ^ float_seed);
+    }
+    default:
+        break;
+    }
+
+    switch (vtype) {
+    case Type::Null:
+        return hash_mix(null_seed);
+    case Type::Bool:
+        return hash_mix(bool_seed + value.Bool);
+    case Type::Char:
+        return hash_mix((static_cast<std::uint64_t>(static_cast<unsigned char>(value.Char)) << 32) ^ char_seed);
+    case Type::String:
+        return hash_bytes(value.String.data(), value.String.size(), string_seed);
+    case Type::Binary:
+        return hash_bytes(value.Binary.data(), value.Binary.size(), binary_seed);
+    case Type::HighPrecision:
+    {
+        //equal numbers have the same text
+        char chunk[64];
+        std::uint64_t h = high_precision_seed;
+        for(std::size_t pos = 0; pos < value.HighPrecision.size(); pos += sizeof chunk)
+            h = hash_bytes(chunk, value.HighPrecision.copy(chunk, sizeof chunk, pos), h);
+        return h;
+    }
+    default:
+        break;
+    }
+
+    if(const std::uint32_t cached = cached_hash.load(std::memory_order_relaxed))
+        return cached;
+
+    std::uint64_t h;
+    if(vtype == Type::Array)
+    {
+        h = array_seed ^ (array().size() * hash_multiplier);
+        for(const auto& item : array())
+            h = hash_step(h, item->hash());
+    }
+    else
+    {
+        //a sum doesn't depend on the order the members are visited in
+        std::uint64_t sum = 0;
+        for(const auto& member : map())
+            sum += hash_mix(hash_bytes(member.first.data(), member.first.size(), string_seed) ^ rotl(member.second->hash(), 29));
+        h = hash_step(map_seed ^ (map().size() * hash_multiplier), sum);
+    }
+    const std::uint32_t folded = fold_hash(hash_mix(h));
+    const bool handed_out = vtype == Type::Array ? value.Array->leaked or value.Array->referenced
+                                                 : value.Map->leaked or value.Map->referenced;
+    if(not handed_out)     //else it may be modified unseen, see ArrayStorage
+        cached_hash.store(folded, std::memory_order_relaxed);
+    return folded;
+}
+
+int Value::compare(const Value& rhs) const
+{
+    if(const int c = three_way(type_rank(vtype), type_rank(rhs.vtype)))
+        return c;
+
+    switch (vtype) {
+    case Type::Null:
+        return 0;
+    case Type::Bool:
+        return three_way(value.Bool, rhs.value.Bool);
+    case Type::SignedInt:
+        if(rhs.vtype == Type::SignedInt)
+            return three_way(value.SignedInt, rhs.value.SignedInt);
+        if(rhs.vtype == Type::UnsignedInt)
+            return compare_exact(value.SignedInt, rhs.value.UnsignedInt);
+        return -compare_exact(rhs.value.Float, value.SignedInt);
+    case Type::UnsignedInt:
+        if(rhs.vtype == Type::UnsignedInt)
+            return three_way(value.UnsignedInt, rhs.value.UnsignedInt);
+        if(rhs.vtype == Type::SignedInt)
+            return -compare_exact(rhs.value.SignedInt, value.UnsignedInt);
+        return -compare_exact(rhs.value.Float, value.UnsignedInt);
+    case Type::Float:
+        if(rhs.vtype == Type::Float)
+            return compare_exact(value.Float, rhs.value.Float);
+        if(rhs.vtype == Type::SignedInt)
+            return compare_exact(value.Float, rhs.value.SignedInt);
+        return compare_exact(value.Float, rhs.value.UnsignedInt);
+    case Type::HighPrecision:
+    {
+        //by magnitude first, then by text, which is what operator == compares
+        const HighPrecisionType& l = value.HighPrecision;
+        const HighPrecisionType& r = rhs.value.HighPrecision;
+        if(const int c = compare_exact(l.toDouble(), r.toDouble()))
+            return c;
+        for(std::size_t i = 0; i < l.size() and i < r.size(); i++)
+            if(const int c = three_way(l[i], r[i]))
+                return c;
+        return three_way(l.size(), r.size());
+    }
+    case Type::Char:
+        return three_way(static_cast<unsigned char>(value.Char), static_cast<unsigned char>(rhs.value.Char));
+    case Type::String:
+        return three_way(value.String.compare(rhs.value.String), 0);
+    case Type::Binary:
+        return three_way(value.Binary, rhs.value.Binary);
+    case Type::Array:
+    {
+        const ArrayType& l = array();
+        const ArrayType& r = rhs.array();
+        if(value.Array == rhs.value.Array)
+            return 0;
+        for(std::size_t i = 0; i < l.size() and i < r.size(); i++)
+            if(const int c = l[i]->compare(*r[i]))
+                return c;
+        return three_way(l.size(), r.size());
+    }
+    case Type::Map:
+    {
+        //members have no order of their own; smaller Maps come first, then they compare by sorted key
+        if(value.Map == rhs.value.Map)
+            return 0;
+        if(const int c = three_way(map().size(), rhs.map().size()))
+            return c;
+        using Member = const MapType::value_type*;
+        auto sorted = [](const MapType& m)
+            {
+                std::vector<Member> members;
+                members.reserve(m.size());
+                for(const auto& member : m)
+                    members.push_back(&member);
+                std::sort(members.begin(), members.end(), [](Member a, Member b){ return a->first < b->first; });
+                return members;
+            };
+        const std::vector<Member> l = sorted(map()), r = sorted(rhs.map());
+        for(std::size_t i = 0; i < l.size(); i++)
+        {
+            if(const int c = three_way(l[i]->first.compare(r[i]->first), 0))
+                return c;
+            if(const int c = l[i]->second->compare(*r[i]->second))
+                return c;
+        }
+        return 0;
+    }
+    }
+    return 0;
+}
+
 
 //////////////// as<...> functions //////
 ///
@@ -403,6 +845,11 @@ long long Value::asInt64() const noexcept
         catch (std::out_of_range&) {}
         return 0;
     }
+    if(isHighPrecision())
+    {
+        long long rtn;
+        return value.HighPrecision.toInt64(rtn) ? rtn : 0;
+    }
     return size();
 }
 
@@ -428,6 +875,11 @@ unsigned long long Value::asUint64() const noexcept
         catch (std::out_of_range&) {}
         return 0;
     }
+    if(isHighPrecision())
+    {
+        unsigned long long rtn;
+        return value.HighPrecision.toUint64(rtn) ? rtn : 0;
+    }
 
     return size();
 }
@@ -437,6 +889,12 @@ double Value::asFloat() const noexcept
 
     if(isFloat())
         return value.Float;
+    if(isUnsignedInteger())
+        return static_cast<double>(value.UnsignedInt);
+    if(isSignedInteger())           //a negative integer gives 0, as it always has
+        return value.SignedInt < 0 ? 0.0 : static_cast<double>(value.SignedInt);
+    if(isHighPrecision())
+        return value.HighPrecision.toDouble();
     if(isString())
     {
         try { return std::stod(value.String); }
@@ -494,6 +952,8 @@ std::string Value::asString() const noexcept
         return std::to_string(value.UnsignedInt);
     if(isFloat())
         return std::to_string(value.Float);
+    if(isHighPrecision())
+        return value.HighPrecision.str();
     return "";
 }
 
@@ -550,17 +1010,151 @@ void Value::construct_fromBinary(BinaryType&& b)
     new( &(value.Binary)) BinaryType(std::move(b));
 }
 
+void Value::construct_fromHighPrecision(HighPrecisionType&& h)
+{
+    new( &(value.HighPrecision)) HighPrecisionType(std::move(h));
+}
+
 void Value::construct_fromArray(ArrayType&& a)
 {
-    new( &(value.Array)) ArrayType(std::move(a));
+    new( &(value.Array)) std::shared_ptr<ArrayStorage>(std::make_shared<ArrayStorage>(std::move(a)));
 }
 
 void Value::construct_fromMap(MapType&& m)
 {
-    new( &(value.Map)) MapType(std::move(m));
+    new( &(value.Map)) std::shared_ptr<MapStorage>(std::make_shared<MapStorage>(std::move(m)));
+}
+
+/*!
+ * \brief like modify_array(), and marks the items leaked, as the old copy-on-write std::string did:
+ * the caller may keep an iterator into them, which a copy sharing them would see modifications through.
+ * So copy_from() copies leaked items at once, until a modification invalidating the iterators clears the mark
+ */
+Value::ArrayType& Value::array()
+{
+    ArrayType& items = modify_array();
+    value.Array->leaked = true;
+    return items;
+}
+
+Value::ArrayType& Value::modify_array()
+{
+    ArrayType& items = array_keeping_index();
+    delete value.Array->index.exchange(nullptr, std::memory_order_relaxed);     //the caller may modify any item
+    return items;
+}
+
+Value::ArrayType& Value::array_keeping_index()
+{
+    cached_hash.store(0, std::memory_order_relaxed);    //the caller may modify the items
+    if(value.Array.use_count() > 1)
+        value.Array = std::make_shared<ArrayStorage>(unique_ptr_copy(value.Array->items));
+    else    //pairs with the release of the last other owner, so its reads are done before our writes
+        std::atomic_thread_fence(std::memory_order_acquire);
+    return value.Array->items;
+}
+
+/*!
+ * \brief the index of the items, built if there is none yet. Concurrent readers of a shared Array may
+ * build it at the same time; the first to finish publishes it, and the others use that one
+ * \pre the items aren't leaked
+ */
+const Value::ArrayIndex& Value::array_index() const
+{
+    const ArrayStorage& storage = *value.Array;
+    if(const ArrayIndex* index = storage.index.load(std::memory_order_acquire))
+        return *index;
+
+    std::unique_ptr<ArrayIndex> built = std::make_unique<ArrayIndex>();
+    built->items.reserve(storage.items.size());
+    for(const auto& item : storage.items)
+        built->add(item.get());
+
+    ArrayIndex* published = nullptr;
+    if(storage.index.compare_exchange_strong(published, built.get(), std::memory_order_acq_rel))
+        return *built.release();
+    return *published;
+}
+
+//! the first item equal to \a v \pre isArray()
+Value::ArrayType::const_iterator Value::find_item(const Value& v) const
+{
+    const ArrayType& items = array();
+    if(items.size() < min_indexed_items or value.Array->leaked)     //see ArrayStorage
+        return std::find_if(items.begin(), items.end(), [&v](const Uptr& item){ return v == *item; });
+
+    const ArrayIndex& index = array_index();
+    auto range = index.items.equal_range(v.hash());
+    std::vector<const Value*> equal;
+    for(auto it = range.first; it != range.second; ++it)
+        if(v == *it->second)
+            equal.push_back(it->second);
+    for(const Value* item : index.unhashed)
+        if(v == *item)
+            equal.push_back(item);
+    if(equal.empty())
+        return items.end();
+
+    //the index doesn't know positions; finding a pointer is only a scan over memory
+    if(equal.size() == 1)
+        return std::find_if(items.begin(), items.end(), [&equal](const Uptr& item){ return item.get() == equal[0]; });
+    return std::find_if(items.begin(), items.end(), [&equal](const Uptr& item)
+                { return std::find(equal.begin(), equal.end(), item.get()) != equal.end(); });
+}
+
+//! adds the last item to the index, if there is one \pre isArray() and the storage isn't shared
+void Value::index_appended() noexcept
+{
+    ArrayIndex* index = value.Array->index.load(std::memory_order_relaxed);
+    if(not index)
+        return;
+    const Value* item = value.Array->items.back().get();
+    try
+    {
+        index->add(item);
+    }
+    catch(std::bad_alloc&)
+    {
+        delete value.Array->index.exchange(nullptr, std::memory_order_relaxed);
+    }
+}
+
+//! like modify_map(), and marks the members leaked, see array()
+Value::MapType& Value::map()
+{
+    MapType& members = modify_map();
+    value.Map->leaked = true;
+    return members;
+}
+
+void Value::set_member(const std::string& key, Value&& v)
+{
+    if(vtype == Type::Null)
+    {
+        construct_fromMap(MapType());
+        vtype = Type::Map;
+    }
+    Uptr& slot = modify_map()[key];
+    if(slot)
+        *slot = std::move(v);
+    else
+    {
+        slot = std::make_unique<Value>(std::move(v));
+        value.Map->leaked = false;
+    }
+}
+
+Value::MapType& Value::modify_map()
+{
+    cached_hash.store(0, std::memory_order_relaxed);
+    if(value.Map.use_count() > 1)
+        value.Map = std::make_shared<MapStorage>(unique_ptr_copy(value.Map->members));
+    else
+        std::atomic_thread_fence(std::memory_order_acquire);
+    return value.Map->members;
 }
 
-void Value::move_from(Value&& v)
+void Value::move_from(Value&& v) noexcept
 {
     destruct();
 
@@ -586,17 +1180,21 @@ void Value::move_from(Value&& v)
     case Type::Binary:
         construct_fromBinary( std::move(v.value.Binary) );
         break;
+    case Type::HighPrecision:
+        construct_fromHighPrecision( std::move(v.value.HighPrecision) );
+        break;
     case Type::Array:
-        construct_fromArray(  std::move(v.value.Array)  );
+        new( &(value.Array)) std::shared_ptr<ArrayStorage>( std::move(v.value.Array) );
         break;
     case Type::Map:
-        construct_fromMap(    std::move(v.value.Map)    );
+        new( &(value.Map)) std::shared_ptr<MapStorage>( std::move(v.value.Map) );
         break;
     default:
         break;
     }
 
     vtype = v.vtype;
+    cached_hash.store(v.cached_hash.load(std::memory_order_relaxed), std::memory_order_relaxed);
     v.destruct();
 }
 
@@ -626,16 +1224,98 @@ void Value::copy_from(const Value& v)
     case Type::Binary:
         construct_fromBinary( BinaryType(  v.value.Binary ));
         break;
+    case Type::HighPrecision:
+        construct_fromHighPrecision( HighPrecisionType( v.value.HighPrecision ));
+        break;
     case Type::Array:
-        construct_fromArray( ArrayType(unique_ptr_copy(v.value.Array)));
+        if(v.value.Array->leaked)       //a reference into the items may still modify them, see array()
+            construct_fromArray(unique_ptr_copy(v.value.Array->items));
+        else
+            new( &(value.Array)) std::shared_ptr<ArrayStorage>( v.value.Array );     //shared until either is modified
         break;
     case Type::Map:
-        construct_fromMap( MapType(unique_ptr_copy(v.value.Map)));
+        if(v.value.Map->leaked)
+            construct_fromMap(unique_ptr_copy(v.value.Map->members));
+        else
+            new( &(value.Map)) std::shared_ptr<MapStorage>( v.value.Map );
         break;
     default:
         break;
     }
     vtype = v.vtype;
+    cached_hash.store(v.cached_hash.load(std::memory_order_relaxed), std::memory_order_relaxed);    //the same items
+}
+
+//! whether this solely owns its items \pre isArray() or isMap()
+inline bool Value::owns_items() const noexcept
+{
+    const long owners = vtype == Type::Array ? value.Array.use_count() : value.Map.use_count();
+    if(owners != 1)
+        return false;
+    std::atomic_thread_fence(std::memory_order_acquire);    //as in array_keeping_index()
+    return true;
+}
+
+/*!
+ * \brief moves the items of \a v to \a work, if \a v is a container that solely owns them.
+ * If \a work can't grow, the items stay, to be destroyed the ordinary way
+ */
+void Value::take_items(Value& v, ArrayType& work) noexcept
+{
+    if((v.vtype != Type::Array and v.vtype != Type::Map) or not v.owns_items())
+        return;
+    try
+    {
+        if(v.vtype == Type::Array)
+        {
+            ArrayType& items = v.value.Array->items;
+            work.reserve(work.size() + items.size());
+            for(auto& item : items)
+                work.push_back(std::move(item));
+            items.clear();
+        }
+        else
+        {
+            MapType& members = v.value.Map->members;
+            work.reserve(work.size() + members.size());
+            for(auto& member : members)
+                work.push_back(std::move(member.second));
+            members.clear();
+        }
+    }
+    catch(std::bad_alloc&) {}
+}
+
+/*!
+ * \brief empties the containers nested in this one with a worklist, so that destroying
+ * a deep tree doesn't recurse as deep as the tree, and a large one doesn't unwind a long call chain.
+ * Shared containers are left to their other owners
+ */
+void Value::destruct_items() noexcept
+{
+    if(not owns_items())
+        return;
+
+    //when no item is itself a container with items, the ordinary destruction is only one level deep
+    auto nested = [](const Uptr& item)
+        {
+            return (item->vtype == Type::Array and item->value.Array and not item->value.Array->items.empty()) or
+                    (item->vtype == Type::Map and item->value.Map and not item->value.Map->members.empty());
+        };
+    const bool any_nested = vtype == Type::Array ?
+                std::any_of(value.Array->items.begin(), value.Array->items.end(), nested) :
+                std::any_of(value.Map->members.begin(), value.Map->members.end(), [&](const MapType::value_type& m){ return nested(m.second); });
+    if(not any_nested)
+        return;
+
+    ArrayType work;
+    take_items(*this, work);
+    while(not work.empty())
+    {
+        Uptr item = std::move(work.back());
+        work.pop_back();
+        take_items(*item, work);
+    }
 }
 
 inline void Value::destruct() noexcept
@@ -651,13 +1331,20 @@ inline void Value::destruct() noexcept
         value.String.~string();
         break;
     case Type::Array:
-        value.Array.~vector();
+        destruct_items();
+        value.Array.~shared_ptr();
+        cached_hash.store(0, std::memory_order_relaxed);
         break;
     case Type::Binary:
         value.Binary.~vector();
         break;
     case Type::Map:
-        value.Map.~unordered_map();
+        destruct_items();
+        value.Map.~shared_ptr();
+        cached_hash.store(0, std::memory_order_relaxed);
+        break;
+    case Type::HighPrecision:
+        value.HighPrecision.~HighPrecisionType();
         break;
     default:
         break;
@@ -806,6 +1493,29 @@ Value::operator BinaryType const& () const&
 }
 
 
+///// HighPrecisionType
+Value::operator HighPrecisionType&& () &&
+{
+    if(vtype == Type::HighPrecision)
+        return std::move(value.HighPrecision);
+    throw bad_value_cast("'Value&&' cannot be casted to 'HighPrecisionType&&'");
+}
+
+Value::operator HighPrecisionType& () &
+{
+    if(vtype == Type::HighPrecision)
+        return value.HighPrecision;
+    throw bad_value_cast("'Value&' cannot be casted to 'HighPrecisionType&'");
+}
+
+Value::operator HighPrecisionType const& () const&
+{
+    if(vtype == Type::HighPrecision)
+        return value.HighPrecision;
+    throw bad_value_cast("'Value const&' cannot be casted to 'HighPrecisionType const&'");
+}
+
+
 //////////////////////// FRIEND FUNCTION ///////////
 
 void ubjson::swap(Value& v1, Value& v2)
@@ -820,10 +1530,8 @@ void ubjson::swap(Value& v1, Value& v2)
 
 bool ubjson::operator == (const Value& lhs, const Value& rhs)
 {
-    using limit = std::numeric_limits<double>;
-
     if(lhs.isNumeric() && rhs.isNumeric())
-        return std::abs(lhs.asFloat() - rhs.asFloat()) <= limit::epsilon();
+        return lhs.compare(rhs) == 0;
 
     if(lhs.type() != rhs.type())
         return false;
@@ -839,14 +1547,23 @@ bool ubjson::operator == (const Value& lhs, const Value& rhs)
         return lhs.value.String == rhs.value.String;
     case Type::Binary:
         return lhs.value.Binary == rhs.value.Binary;
-    case Type::Array:
-        return is_equal(lhs.value.Array, rhs.value.Array);
-    case Type::Map:
-        return is_equal(lhs.value.Map, rhs.value.Map);
+    case Type::HighPrecision:
+        return lhs.value.HighPrecision == rhs.value.HighPrecision;
     default:
         break;
     }
-    return false;
+
+    //copies share their items; otherwise two cached hashes that differ settle it without a walk
+    if(rhs.type() == Type::Array ? lhs.value.Array == rhs.value.Array : lhs.value.Map == rhs.value.Map)
+        return true;
+    const std::uint32_t lhs_hash = lhs.cached_hash.load(std::memory_order_relaxed);
+    const std::uint32_t rhs_hash = rhs.cached_hash.load(std::memory_order_relaxed);
+    if(lhs_hash and rhs_hash and lhs_hash != rhs_hash)
+        return false;
+
+    if(rhs.type() == Type::Array)
+        return is_equal(lhs.array(), rhs.array());
+    return is_equal(lhs.map(), rhs.map());
 }
 
 bool ubjson::operator != (const Value& lhs, const Value& rhs)
@@ -854,6 +1571,18 @@ bool ubjson::operator != (const Value& lhs, const Value& rhs)
 	return !ubjson::operator == (lhs, rhs); 
 }
 
+bool ubjson::operator < (const Value& lhs, const Value& rhs)
+{ return lhs.compare(rhs) < 0; }
+
+bool ubjson::operator > (const Value& lhs, const Value& rhs)
+{ return lhs.compare(rhs) > 0; }
+
+bool ubjson::operator <= (const Value& lhs, const Value& rhs)
+{ return lhs.compare(rhs) <= 0; }
+
+bool ubjson::operator >= (const Value& lhs, const Value& rhs)
+{ return lhs.compare(rhs) >= 0; }
+
 
 ///////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////
@@ -862,73 +1591,10 @@ bool ubjson::operator != (const Value& lhs, const Value& rhs)
 ///////////////////////////////////////////////////////////
 
 
+//! the text is built by JsonWriter, then written out in one go
 std::ostream& ubjson::operator << (std::ostream& os, to_ostream&& tos)
 {
-    tos.print_value(os, tos.value);
-    return os;
-}
-
-void to_ostream::print_object(std::ostream &os, const Value &v)
-{
-    os << '{' << (ppretty ? "\n" : "");
-    if(ppretty)
-        push_addendum('\t');
-
-    const auto keys = v.keys();
-
-    size_t idx = 0, idxEnd = keys.size();
-    for(const auto& key : keys)
-    {
-        os << addendum << "\"" << key << "\"" << (ppretty ? " : " : ":");;
-        print_value(os, v[key]);
-
-        if(++idx < idxEnd)
-            os << ',';
-        os << (ppretty ? "\n" : "");
-    }
-
-    pop_addendum();
-    os << addendum << '}';
-}
-
-void to_ostream::print_array(std::ostream &os, const Value &v)
-{
-    if(ppretty)
-        push_addendum('\t');
-    os << '[';
-
-    for(size_t i=0; i < v.size(); i++)
-    {
-        print_value(os, v[i]);
-
-        if(i + 1 < v.size())
-            os << (ppretty ? ", " : ",");
-    }
-
-    pop_addendum();
-    os << ']';
-}
-
-void to_ostream::print_value(std::ostream &os, const Value &v)
-{
-    if(v.isNull())
-        os << "null";
-    else if(v.isBool())
-        os << (v ? "true" : "false");
-    else if(v.isChar())
-        os << "\"" << static_cast<char>(v) << "\"";
-    else if(v.isSignedInteger())
-        os << static_cast<long long>(v);
-    else if(v.isUnsignedInteger())
-        os << static_cast<unsigned long long>(v);
-    else if(v.isFloat())
-        os << static_cast<double>(v);
-    else if(v.isString())
-        os << "\"" << static_cast<std::string>(v) << "\"";
-    else if(v.isBinary())
-        os << "BINARY DATA (" << static_cast<const Value::BinaryType&>(v).size() << " bytes)";
-    else if(v.isArray())
-        print_array(os, v);
-    else if(v.isObject())
-        print_object(os, v);
+    JsonWriter writer(tos.opt == to_ostream::pretty ? JsonWriter::pretty : JsonWriter::compact);
+    writer.writeValue(tos.value);
+    return os.write(writer.data(), static_cast<std::streamsize>(writer.size()));
 }
@@ -0,0 +1,320 @@
+/*
+ * Copyright(C):    WhiZTiM, 2015
+ *
+ * This file is part of the TIML::UBJSON C++14 library
+ *
+ * Distributed under the Boost Software License, Version 1.0.
+ *      (See accompanying file LICENSE_1_0.txt or copy at
+ *          http://www.boost.org/LICENSE_1_0.txt)
+ *
+ * Author: Ibrahim Timothy Onogu
+ * Email:  ionogu@acm.org
+ */
+
+#include "value_view.hpp"
+#include <limits>
+#include <cstring>
+#include <tuple>
+#include <stdexcept>
+
+using namespace ubjson;
+
+/////////////////  DOCUMENT AND OFFSET CACHE
+
+//! the children of one container, indexed as far as they have been visited
+struct ValueView::ContainerIndex
+{
+    struct Entry
+    {
+        std::size_t key;            //offset of the key, for Maps
+        std::size_t key_size;
+        std::size_t payload;
+        byte marker;
+    };
+
+    bool is_object;
+    bool complete;
+    int stride;             //! payload size of the elements of a typed Array of fixed size values, else -1
+    STCHeader header;
+    std::size_t next;       //! where the next child (its key, for Maps) starts
+    std::vector<Entry> entries;
+};
+
+struct ValueView::Document
+{
+    Document(const byte* data, std::size_t size, ValueSizePolicy policy)
+        : scanner(data, size, policy.max_value_depth), vsz(policy) {}
+
+    //! indexes the next child of \a c; returns false if there are no more
+    bool extend(ContainerIndex& c)
+    {
+        if(c.complete)
+            return false;
+
+        const byte end = static_cast<byte>(c.is_object ? Marker::Object_End : Marker::Array_End);
+        if(c.header.is_valid ? c.entries.size() == c.header.item_count : scanner.markerAt(c.next) == end)
+        {
+            c.complete = true;
+            return false;
+        }
+
+        ContainerIndex::Entry e{0, 0, 0, 0};
+        if(c.is_object)
+            std::tie(e.key, e.key_size) = scanner.readSized(c.next);
+        if(c.header.has_type)
+        {
+            e.marker = static_cast<byte>(c.header.marker);
+            e.payload = c.next;
+        }
+        else
+        {
+            e.marker = scanner.markerAt(c.next);
+            e.payload = c.next + 1;
+        }
+        c.next = scanner.skipPayload(e.marker, e.payload);
+        c.entries.push_back(e);
+        return true;
+    }
+
+    BufferScanner scanner;
+    const ValueSizePolicy vsz;
+    std::unordered_map<std::size_t, ContainerIndex> cache;     //! keyed by the payload offset of the container
+};
+
+
+/////////////////  VALUEVIEW
+
+ValueView::ValueView() noexcept
+    : marker(static_cast<byte>(Marker::Null)), payload(0)
+{  /**/ }
+
+ValueView::ValueView(const byte* data, std::size_t size, ValueSizePolicy policy)
+    : doc(std::make_shared<Document>(data, size, policy)), payload(1)
+{
+    marker = doc->scanner.markerAt(0);
+}
+
+ValueView::ValueView(const char* data, std::size_t size, ValueSizePolicy policy)
+    : ValueView(reinterpret_cast<const byte*>(data), size, policy)
+{  /**/ }
+
+ValueView::ValueView(const std::shared_ptr<Document>& document, byte Mark, std::size_t Payload) noexcept
+    : doc(document), marker(Mark), payload(Payload)
+{  /**/ }
+
+Type ValueView::type() const
+{
+    switch (static_cast<Marker>(marker)) {
+    case Marker::Null:
+    case Marker::No_Op:
+        return Type::Null;
+    case Marker::Char:
+        return Type::Char;
+    case Marker::True:
+    case Marker::False:
+        return Type::Bool;
+    case Marker::Int8:
+    case Marker::Int16:
+    case Marker::Int32:
+    case Marker::Int64:
+        return Type::SignedInt;
+    case Marker::Uint8:
+        return Type::UnsignedInt;
+    case Marker::Float32:
+    case Marker::Float64:
+        return Type::Float;
+    case Marker::String:
+        return Type::String;
+    case Marker::Binary:
+        return Type::Binary;
+    case Marker::HighPrecision:
+        return scalar().type();
+    case Marker::Array_Start:
+        return Type::Array;
+    case Marker::Object_Start:
+        return Type::Map;
+    default:
+        throw parsing_exception("Invalid marker encountered!");
+    }
+}
+
+std::size_t ValueView::size() const
+{
+    if(isContainer())
+    {
+        auto& c = index();
+        if(c.header.is_valid)
+            return c.header.item_count;
+        while(doc->extend(c))
+            ;
+        return c.entries.size();
+    }
+    return isNull() ? 0 : 1;
+}
+
+bool ValueView::asBool() const
+{ return isContainer() ? size() != 0 : scalar().asBool(); }
+
+int ValueView::asInt() const
+{
+    using limit = std::numeric_limits<int>;
+    return in_range(asInt64(), limit::lowest(), limit::max()) ? asInt64() : 0;
+}
+
+unsigned int ValueView::asUint() const
+{
+    using limit = std::numeric_limits<unsigned int>;
+    return in_range(asUint64(), limit::lowest(), limit::max()) ? asUint64() : 0;
+}
+
+long long ValueView::asInt64() const
+{ return isContainer() ? size() : scalar().asInt64(); }
+
+unsigned long long ValueView::asUint64() const
+{ return isContainer() ? size() : scalar().asUint64(); }
+
+double ValueView::asFloat() const
+{ return isContainer() ? size() : scalar().asFloat(); }
+
+std::string ValueView::asString() const
+{ return isContainer() ? std::string() : scalar().asString(); }
+
+Value::BinaryType ValueView::asBinary() const
+{ return isContainer() ? Value::BinaryType() : scalar().asBinary(); }
+
+ValueView ValueView::operator [] (int i) const
+{
+    if(not isArrayStart(marker))
+        throw value_exception("Attempt to index 'ValueView'; 'ValueView' is not an Array!");
+    if(i < 0 or not hasChild(static_cast<std::size_t>(i)))
+        throw std::out_of_range("ValueView: Array index out of range");
+    return child(static_cast<std::size_t>(i));
+}
+
+ValueView ValueView::operator [] (const char* key) const
+{
+    if(not isObjectStart(marker))
+        throw value_exception("Attempt to index 'ValueView'; 'ValueView' is not a Key-Value pair (aka Object) !");
+    std::size_t i;
+    if(not findKey(key, std::strlen(key), i))
+        throw std::out_of_range("ValueView: key not found");
+    return child(i);
+}
+
+ValueView ValueView::operator [] (const std::string& key) const
+{
+    if(not isObjectStart(marker))
+        throw value_exception("Attempt to index 'ValueView'; 'ValueView' is not a Key-Value pair (aka Object) !");
+    std::size_t i;
+    if(not findKey(key.data(), key.size(), i))
+        throw std::out_of_range("ValueView: key not found");
+    return child(i);
+}
+
+bool ValueView::contains(const std::string& key) const
+{
+    std::size_t i;
+    return isObjectStart(marker) and findKey(key.data(), key.size(), i);
+}
+
+Value::Keys ValueView::keys() const
+{
+    Value::Keys rtn;
+    if(not isObjectStart(marker))
+        return rtn;
+    for(std::size_t i = 0; hasChild(i); ++i)
+        rtn.push_back(childKey(i));
+    return rtn;
+}
+
+ValueView::const_iterator ValueView::begin() const
+{ return const_iterator(*this, 0); }
+
+ValueView::const_iterator ValueView::end() const
+{ return const_iterator(*this, const_iterator::npos); }
+
+Value ValueView::toValue() const
+{
+    if(not doc)
+        return Value();
+    std::size_t pos = payload;
+    return doc->scanner.decodeValue(marker, pos, doc->vsz);
+}
+
+//////////////// PRIVATE ////////////////
+/////////////////////////////////////////
+
+bool ValueView::isContainer() const noexcept
+{ return isArrayStart(marker) or isObjectStart(marker); }
+
+ValueView::ContainerIndex& ValueView::index() const
+{
+    auto found = doc->cache.find(payload);
+    if(found != doc->cache.end())
+        return found->second;
+
+    ContainerIndex c;
+    c.is_object = isObjectStart(marker);
+    c.complete = false;
+    c.next = payload;
+    c.header = doc->scanner.readContainerHeader(c.next);
+    c.stride = -1;
+    if(c.header.has_type and not c.is_object)
+    {
+        const int width = BufferScanner::fixedPayloadSize(static_cast<byte>(c.header.marker));
+        if(width > 0 and c.header.item_count > (doc->scanner.size() - c.next) / width)
+            throw parsing_exception("Unexpected end of buffer!");
+        c.stride = width;
+    }
+    return doc->cache.emplace(payload, std::move(c)).first->second;
+}
+
+bool ValueView::hasChild(std::size_t i) const
+{
+    if(not isContainer())
+        return false;
+    auto& c = index();
+    if(c.stride >= 0)       //typed Arrays of fixed size values are never walked
+        return i < c.header.item_count;
+    while(c.entries.size() <= i and doc->extend(c))
+        ;
+    return i < c.entries.size();
+}
+
+//! \pre hasChild(i)
+ValueView ValueView::child(std::size_t i) const
+{
+    const auto& c = index();
+    if(c.stride >= 0)
+        return ValueView(doc, static_cast<byte>(c.header.marker), c.next + i * c.stride);
+    return ValueView(doc, c.entries[i].marker, c.entries[i].payload);
+}
+
+std::string ValueView::childKey(std::size_t i) const
+{
+    if(not isObjectStart(marker) or not hasChild(i))
+        return std::string();
+    const auto& e = index().entries[i];
+    return std::string(reinterpret_cast<const char*>(doc->scanner.data() + e.key), e.key_size);
+}
+
+//! linear search of the keys visited so far, then of the rest of the Map as it is indexed
+bool ValueView::findKey(const char* key, std::size_t size, std::size_t& i) const
+{
+    auto& c = index();
+    const byte* data = doc->scanner.data();
+    for(i = 0; i < c.entries.size() or doc->extend(c); ++i)
+    {
+        const auto& e = c.entries[i];
+        if(e.key_size == size and std::memcmp(data + e.key, key, size) == 0)
+            return true;
+    }
+    return false;
+}
+
+Value ValueView::scalar() const
+{
+    if(not doc)
+        return Value();
+    return doc->scanner.decodeScalar(marker, payload);
+}
@@ -0,0 +1,137 @@
+#include "value.hpp"
+#include "document_index.hpp"
+#include "stream_reader.hpp"
+#include "stream_writer.hpp"
+#include "../test_utils/format_helpers.hpp"
+#include <cppunit/extensions/HelperMacros.h>
+#include <sstream>
+
+using namespace ubjson;
+int weird_cppunit_extern_bug_document_index_test = 0;
+
+class Document_Index_Test : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( Document_Index_Test );
+    CPPUNIT_TEST( test_structure );
+    CPPUNIT_TEST( test_random_access );
+    CPPUNIT_TEST( test_optimized_containers );
+    CPPUNIT_TEST( test_malformed_documents );
+    CPPUNIT_TEST_SUITE_END();
+public:
+    void setUp() override
+    {
+        v_doc = std::make_unique<Value>(Value());
+        (*v_doc)["name"] = "WhiZTiM";
+        (*v_doc)["ratio"] = 2.5;
+        for(int i = 0; i < 2000; i++)
+        {
+            Value item;
+            item["id"] = i;
+            item["tags"] = { "a", std::string(i % 7, 'x') };
+            (*v_doc)["items"].push_back(item);
+        }
+        encoded = encode(*v_doc);
+    }
+private:
+    Value::Uptr v_doc;
+    std::string encoded;
+
+    static std::string encode(const Value& v)
+    {
+        std::ostringstream os;
+        StreamWriter<std::ostringstream> writer(os);
+        writer.writeValue(v);
+        return os.str();
+    }
+
+    template<std::size_t N>
+    static std::string bytes(const char (&str)[N])
+    { return std::string(str, N - 1); }
+
+public:
+    void test_structure()
+    {
+        DocumentIndex index(encoded.data(), encoded.size());
+        //root, 3 members, 2000 items of (an item, an id, tags, and 2 tags)
+        CPPUNIT_ASSERT_EQUAL( std::size_t(1 + 3 + 2000 * 5), index.size() );
+
+        const auto& root = index[index.root()];
+        CPPUNIT_ASSERT( isObjectStart(root.marker) );
+        CPPUNIT_ASSERT_EQUAL( encoded.size(), root.length );
+        CPPUNIT_ASSERT_EQUAL( DocumentIndex::npos, root.parent );
+        CPPUNIT_ASSERT_EQUAL( DocumentIndex::index_type(3), root.child_count );
+
+        auto items = index.find(index.root(), "items");
+        CPPUNIT_ASSERT( items != DocumentIndex::npos );
+        CPPUNIT_ASSERT_EQUAL( index.root(), index[items].parent );
+        CPPUNIT_ASSERT_EQUAL( std::string("items"), index.key(items) );
+
+        //walking the siblings visits every item once, skipping their subtrees
+        std::size_t count = 0;
+        for(auto i = index.child(items, 0); i != DocumentIndex::npos; i = index[i].next_sibling, ++count)
+            CPPUNIT_ASSERT_EQUAL( items, index[i].parent );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(2000), count );
+
+        //every entry covers exactly its encoded bytes
+        auto name = index.find(index.root(), "name");
+        CPPUNIT_ASSERT_EQUAL( std::size_t(1 + 2 + 7), index[name].length );
+        CPPUNIT_ASSERT( isString(index.data()[index[name].offset]) );
+    }
+
+    void test_random_access()
+    {
+        DocumentIndex index(encoded.data(), encoded.size());
+        auto items = index.find(index.root(), std::string("items"));
+        for(int i : {0, 1, 999, 1999})
+        {
+            auto item = index.child(items, i);
+            CPPUNIT_ASSERT_EQUAL( i, index.value(index.find(item, "id")).asInt() );
+            auto tag = index.child(index.find(item, "tags"), 1);
+            CPPUNIT_ASSERT_EQUAL( std::string(i % 7, 'x'), index.value(tag).asString() );
+        }
+        CPPUNIT_ASSERT_EQUAL( DocumentIndex::npos, index.child(items, 2000) );
+        CPPUNIT_ASSERT_EQUAL( DocumentIndex::npos, index.find(items, "id") );
+        CPPUNIT_ASSERT_EQUAL( DocumentIndex::npos, index.find(index.root(), "surname") );
+
+        CPPUNIT_ASSERT( index.value(index.root()) == *v_doc );
+    }
+
+    void test_optimized_containers()
+    {
+        const std::string typed = bytes("{#i\x02" "i\x01" "a" "[$I#i\x03" "\x00\x01" "\x00\x02" "\xff\xff"
+                                        "i\x01" "b" "[$[#i\x02" "#i\x01" "T" "]");
+        DocumentIndex index(typed.data(), typed.size());
+        auto a = index.find(index.root(), "a");
+        CPPUNIT_ASSERT_EQUAL( DocumentIndex::index_type(3), index[a].child_count );
+        auto last = index.child(a, 2);
+        CPPUNIT_ASSERT( index[last].typed );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(2), index[last].length );
+        CPPUNIT_ASSERT_EQUAL( -1, index.value(last).asInt() );
+
+        auto b = index.find(index.root(), "b");
+        CPPUNIT_ASSERT( index.value(index.child(index.child(b, 0), 0)).asBool() );
+        CPPUNIT_ASSERT_EQUAL( DocumentIndex::index_type(0), index[index.child(b, 1)].child_count );
+        CPPUNIT_ASSERT_EQUAL( typed.size(), index[index.root()].length );
+    }
+
+    void test_malformed_documents()
+    {
+        CPPUNIT_ASSERT_THROW( DocumentIndex("", 0), parsing_exception );
+
+        const std::string cut = encoded.substr(0, encoded.size() - 1);
+        CPPUNIT_ASSERT_THROW( DocumentIndex(cut.data(), cut.size()), parsing_exception );
+
+        const std::string huge = bytes("[#L\x7f\xff\xff\xff\xff\xff\xff\xff" "Z");
+        CPPUNIT_ASSERT_THROW( DocumentIndex(huge.data(), huge.size()), parsing_exception );
+
+        const std::string nulls = bytes("[$Z#l\x7f\xff\xff\xff");
+        CPPUNIT_ASSERT_THROW( DocumentIndex(nulls.data(), nulls.size()), parsing_exception );
+
+        std::string deep(1000, '[');
+        deep += std::string(1000, ']');
+        CPPUNIT_ASSERT_THROW( DocumentIndex(deep.data(), deep.size()), parsing_exception );
+    }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( Document_Index_Test );
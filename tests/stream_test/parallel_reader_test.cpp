@@ -0,0 +1,135 @@
+#include "value.hpp"
+#include "parallel_reader.hpp"
+#include "stream_reader.hpp"
+#include "stream_writer.hpp"
+#include "../test_utils/format_helpers.hpp"
+#include <cppunit/extensions/HelperMacros.h>
+#include <sstream>
+
+using namespace ubjson;
+int weird_cppunit_extern_bug_parallel_reader_test = 0;
+
+class Parallel_Reader_Test : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( Parallel_Reader_Test );
+    CPPUNIT_TEST( test_large_array );
+    CPPUNIT_TEST( test_typed_array );
+    CPPUNIT_TEST( test_small_documents );
+    CPPUNIT_TEST( test_errors );
+    CPPUNIT_TEST_SUITE_END();
+public:
+    void setUp() override
+    {
+        v_records = std::make_unique<Value>(Value());
+        for(int i = 0; i < 20000; i++)
+        {
+            Value record;
+            record["id"] = i;
+            record["name"] = "record #" + std::to_string(i);
+            record["scores"] = { i * 0.5, -i, std::string(i % 13, 'z') };
+            v_records->push_back(record);
+        }
+        encoded = encode(*v_records);
+    }
+private:
+    Value::Uptr v_records;
+    std::string encoded;
+
+    static std::string encode(const Value& v)
+    {
+        std::ostringstream os;
+        StreamWriter<std::ostringstream> writer(os);
+        writer.writeValue(v);
+        return os.str();
+    }
+
+    static Value decode(const std::string& bytes)
+    {
+        std::istringstream is(bytes);
+        StreamReader<std::istringstream> reader(is);
+        return reader.getNextValue();
+    }
+
+    static ValueSizePolicy largePolicy()
+    {
+        auto policy = defaultStreamReaderPolicy();
+        policy.max_array_items = policy.max_object_items = 1 << 20;
+        return policy;
+    }
+
+    template<std::size_t N>
+    static std::string bytes(const char (&str)[N])
+    { return std::string(str, N - 1); }
+
+public:
+    void test_large_array()
+    {
+        ParallelReader reader(encoded.data(), encoded.size(), largePolicy(), 4);
+        Value v;
+        CPPUNIT_ASSERT( reader.getValue(v) );
+        CPPUNIT_ASSERT_EQUAL( 4u, reader.getThreadsUsed() );
+        CPPUNIT_ASSERT_EQUAL( encoded.size(), reader.getBytesRead() );
+        CPPUNIT_ASSERT_EQUAL( v_records->size(), v.size() );
+        CPPUNIT_ASSERT( v == *v_records );
+        CPPUNIT_ASSERT( v == decode(encoded) );
+    }
+
+    void test_typed_array()
+    {
+        std::string typed = bytes("[$D#l\x00\x01\x86\xa0");      //100000 doubles
+        for(int i = 0; i < 100000; i++)
+            typed += bytes("\x3f\xf8\x00\x00\x00\x00\x00\x00");    //1.5
+
+        ParallelReader reader(typed.data(), typed.size(), largePolicy(), 3);
+        Value v = reader.getValue();
+        CPPUNIT_ASSERT_EQUAL( 3u, reader.getThreadsUsed() );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(100000), v.size() );
+        CPPUNIT_ASSERT_EQUAL( 1.5, v[99999].asFloat() );
+        CPPUNIT_ASSERT( v == decode(typed) );
+    }
+
+    void test_small_documents()
+    {
+        Value map;
+        map["name"] = "WhiZTiM";
+        map["list"] = { 1, 2, 3 };
+        const std::string object = encode(map);
+        ParallelReader objects(object.data(), object.size());
+        CPPUNIT_ASSERT( objects.getValue() == map );
+        CPPUNIT_ASSERT_EQUAL( 1u, objects.getThreadsUsed() );
+
+        const std::string small = encode(Value{ 1, "two", 3.0 });
+        ParallelReader arrays(small.data(), small.size(), defaultStreamReaderPolicy(), 8);
+        CPPUNIT_ASSERT( arrays.getValue() == decode(small) );
+        CPPUNIT_ASSERT_EQUAL( 1u, arrays.getThreadsUsed() );
+
+        const std::string empty = "[]";
+        ParallelReader nothing(empty.data(), empty.size());
+        CPPUNIT_ASSERT( nothing.getValue().isNull() );
+    }
+
+    void test_errors()
+    {
+        //a bad element deep inside the range of some worker
+        std::string bad = encoded;
+        const auto where = bad.find("record #15000");
+        bad[where - 2] = 'Q';       //the 'S' marker of the name
+
+        ParallelReader reader(bad.data(), bad.size(), largePolicy(), 4);
+        Value v;
+        CPPUNIT_ASSERT( not reader.getValue(v) );
+        CPPUNIT_ASSERT( not reader.getLastError().empty() );
+
+        const std::string cut = encoded.substr(0, encoded.size() - 10);
+        ParallelReader truncated(cut.data(), cut.size(), largePolicy(), 4);
+        CPPUNIT_ASSERT( not truncated.getValue(v) );
+
+        auto tiny = largePolicy();
+        tiny.max_object_size = 1024;
+        ParallelReader limited(encoded.data(), encoded.size(), tiny, 4);
+        CPPUNIT_ASSERT( not limited.getValue(v) );
+    }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( Parallel_Reader_Test );
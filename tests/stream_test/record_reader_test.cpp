@@ -0,0 +1,120 @@
+#include "value.hpp"
+#include "record_reader.hpp"
+#include "stream_writer.hpp"
+#include "../test_utils/format_helpers.hpp"
+#include <cppunit/extensions/HelperMacros.h>
+#include <sstream>
+
+using namespace ubjson;
+int weird_cppunit_extern_bug_record_reader_test = 0;
+
+class Record_Reader_Test : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( Record_Reader_Test );
+    CPPUNIT_TEST( test_records_in_order );
+    CPPUNIT_TEST( test_backpressure );
+    CPPUNIT_TEST( test_bad_record );
+    CPPUNIT_TEST( test_truncated_stream );
+    CPPUNIT_TEST( test_early_destruction );
+    CPPUNIT_TEST_SUITE_END();
+public:
+    void setUp() override
+    {
+        records.clear();
+        std::ostringstream os;
+        StreamWriter<std::ostringstream> writer(os);
+        for(int i = 0; i < 3000; i++)
+        {
+            Value record;
+            record["seq"] = i;
+            record["message"] = "log line " + std::to_string(i);
+            if(i % 3 == 0)
+                record["fields"] = { i, "x", 2.5 };
+            writer.writeValue(record);
+            records.push_back(record);
+        }
+        records.push_back("a plain string record");
+        writer.writeValue(records.back());
+        encoded = os.str();
+    }
+private:
+    std::vector<Value> records;
+    std::string encoded;
+
+    template<std::size_t N>
+    static std::string bytes(const char (&str)[N])
+    { return std::string(str, N - 1); }
+
+public:
+    void test_records_in_order()
+    {
+        RecordReader reader(encoded.data(), encoded.size(), defaultStreamReaderPolicy(), {4, 64});
+        Value v;
+        std::size_t count = 0;
+        while(reader.getNextValue(v))
+        {
+            CPPUNIT_ASSERT( count < records.size() );
+            CPPUNIT_ASSERT( v == records[count] );
+            ++count;
+        }
+        CPPUNIT_ASSERT_EQUAL( records.size(), count );
+        CPPUNIT_ASSERT( reader.getLastError().empty() );
+        CPPUNIT_ASSERT_EQUAL( encoded.size(), reader.getBytesRead() );
+        CPPUNIT_ASSERT( not reader.getNextValue(v) );       //stays at the end
+    }
+
+    void test_backpressure()
+    {
+        //a single pending record forces the stages into lock-step
+        RecordReader reader(encoded.data(), encoded.size(), defaultStreamReaderPolicy(), {3, 1});
+        std::size_t count = 0;
+        for(Value v; reader.getNextValue(v); ++count)
+            CPPUNIT_ASSERT( v == records[count] );
+        CPPUNIT_ASSERT_EQUAL( records.size(), count );
+    }
+
+    void test_bad_record()
+    {
+        //frames fine (a length prefixed payload) but doesn't decode
+        const std::string bad = bytes("i\x01" "HU\x02" "1x" "i\x03");
+        RecordReader reader(bad.data(), bad.size(), defaultStreamReaderPolicy(), {2, 4});
+        Value v;
+        CPPUNIT_ASSERT( reader.getNextValue(v) );
+        CPPUNIT_ASSERT_EQUAL( 1, v.asInt() );
+        CPPUNIT_ASSERT( not reader.getNextValue(v) );
+        CPPUNIT_ASSERT( not reader.getLastError().empty() );
+        CPPUNIT_ASSERT( reader.getNextValue(v) );           //the next record is unaffected
+        CPPUNIT_ASSERT_EQUAL( 3, v.asInt() );
+        CPPUNIT_ASSERT( not reader.getNextValue(v) );
+        CPPUNIT_ASSERT( reader.getLastError().empty() );
+    }
+
+    void test_truncated_stream()
+    {
+        const std::string cut = encoded.substr(0, encoded.size() - 3);
+        RecordReader reader(cut.data(), cut.size());
+        Value v;
+        std::size_t count = 0;
+        while(reader.getNextValue(v))
+            ++count;
+        CPPUNIT_ASSERT_EQUAL( records.size() - 1, count );
+        CPPUNIT_ASSERT( not reader.getLastError().empty() );
+    }
+
+    void test_early_destruction()
+    {
+        {
+            RecordReader reader(encoded.data(), encoded.size(), defaultStreamReaderPolicy(), {4, 8});
+            Value v;
+            CPPUNIT_ASSERT( reader.getNextValue(v) );
+        }   //must neither hang nor crash
+
+        RecordReader empty("", 0);
+        Value v;
+        CPPUNIT_ASSERT( not empty.getNextValue(v) );
+        CPPUNIT_ASSERT( empty.getLastError().empty() );
+    }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( Record_Reader_Test );
@@ -0,0 +1,102 @@
+#include "value.hpp"
+#include "stream_reader.hpp"
+#include "stream_writer.hpp"
+#include "scatter_gather_stream.hpp"
+#include "../test_utils/format_helpers.hpp"
+#include <cppunit/extensions/HelperMacros.h>
+#include <sstream>
+#include <cstdio>
+
+using namespace ubjson;
+int weird_cppunit_extern_bug_scatter_gather_test = 0;
+
+class Scatter_Gather_Test : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( Scatter_Gather_Test );
+    CPPUNIT_TEST( test_small_payloads_are_copied );
+    CPPUNIT_TEST( test_large_payloads_are_referenced );
+    CPPUNIT_TEST( test_writev_roundtrip );
+    CPPUNIT_TEST_SUITE_END();
+public:
+    void setUp() override
+    {
+        v_doc = std::make_unique<Value>(Value());
+        (*v_doc)["name"] = "WhiZTiM";
+        (*v_doc)["body"] = std::string(100000, 'x');
+        (*v_doc)["list"] = { 34, "nice one bro!", std::string(5000, 'y') };
+    }
+private:
+    Value::Uptr v_doc;
+
+    static std::string gather(const ScatterGatherStream& sg)
+    {
+        std::string rtn;
+        for(const auto& v : sg.iovecs())
+            rtn.append(static_cast<const char*>(v.iov_base), v.iov_len);
+        return rtn;
+    }
+
+public:
+    void test_small_payloads_are_copied()
+    {
+        Value v("name", "WhiZTiM");
+        ScatterGatherStream sg;
+        StreamWriter<ScatterGatherStream> writer(sg);
+        auto result = writer.writeValue(v);
+
+        CPPUNIT_ASSERT( result.second );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(1), sg.iovecs().size() );
+        CPPUNIT_ASSERT_EQUAL( result.first, sg.size() );
+        CPPUNIT_ASSERT_EQUAL( sg.size(), sg.copied() );
+    }
+
+    void test_large_payloads_are_referenced()
+    {
+        ScatterGatherStream sg;
+        StreamWriter<ScatterGatherStream> writer(sg);
+        auto result = writer.writeValue(*v_doc);
+
+        CPPUNIT_ASSERT( result.second );
+        CPPUNIT_ASSERT_EQUAL( result.first, sg.size() );
+        CPPUNIT_ASSERT_EQUAL( sg.size() - 105000, sg.copied() );
+
+        const std::string& body = (*v_doc)["body"];
+        bool found = false;
+        for(const auto& v : sg.iovecs())
+            found = found or (v.iov_base == body.data() and v.iov_len == body.size());
+        CPPUNIT_ASSERT( found );
+
+        //The gathered bytes must be identical to what an ordinary stream receives
+        std::ostringstream os;
+        StreamWriter<std::ostringstream> owriter(os);
+        owriter.writeValue(*v_doc);
+        CPPUNIT_ASSERT( os.str() == gather(sg) );
+    }
+
+    void test_writev_roundtrip()
+    {
+        ScatterGatherStream sg(1024);
+        StreamWriter<ScatterGatherStream> writer(sg);
+        writer.writeValue(*v_doc);
+
+        std::FILE* file = std::tmpfile();
+        CPPUNIT_ASSERT( file != nullptr );
+        auto result = sg.writev(fileno(file));
+        CPPUNIT_ASSERT( result.second );
+        CPPUNIT_ASSERT_EQUAL( sg.size(), result.first );
+
+        std::string bytes(result.first, '\0');
+        std::rewind(file);
+        CPPUNIT_ASSERT_EQUAL( bytes.size(), std::fread(&bytes[0], 1, bytes.size(), file) );
+        std::fclose(file);
+
+        std::istringstream is(bytes);
+        StreamReader<std::istringstream> reader(is);
+        Value v;
+        CPPUNIT_ASSERT( reader.getNextValue(v) );
+        CPPUNIT_ASSERT( v == *v_doc );
+    }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( Scatter_Gather_Test );
@@ -0,0 +1,337 @@
+#include "value.hpp"
+#include "stream_reader.hpp"
+#include "stream_writer.hpp"
+#include "../test_utils/format_helpers.hpp"
+#include <cppunit/extensions/HelperMacros.h>
+#include <sstream>
+#include <limits>
+#include <cmath>
+#include <cstring>
+#include "high_precision.hpp"
+
+using namespace ubjson;
+int weird_cppunit_extern_bug_stream_roundtrip_test = 0;
+
+class Stream_Roundtrip_Test : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( Stream_Roundtrip_Test );
+    CPPUNIT_TEST( test_binary_encoding );
+    CPPUNIT_TEST( test_binary_roundtrip );
+    CPPUNIT_TEST( test_binary_policy );
+    CPPUNIT_TEST( test_integer_widths );
+    CPPUNIT_TEST( test_integer_roundtrip );
+    CPPUNIT_TEST( test_optimized_containers );
+    CPPUNIT_TEST( test_float_narrowing );
+    CPPUNIT_TEST( test_float_lossless );
+    CPPUNIT_TEST( test_float_lossless_integral );
+    CPPUNIT_TEST( test_high_precision_value );
+    CPPUNIT_TEST( test_high_precision_roundtrip );
+    CPPUNIT_TEST( test_object_keys );
+    CPPUNIT_TEST( test_string_policy );
+    CPPUNIT_TEST_SUITE_END();
+public:
+    using T = Value::BinaryType::value_type;
+    void setUp() override
+    {
+        v_binary = std::make_unique<Value>(Value(Value::BinaryType({T(0xab), T(0xbc), T(0xcd), T(0xdf)})));
+        v_map = std::make_unique<Value>(Value());
+
+        Value::BinaryType big(70000);
+        for(std::size_t i = 0; i < big.size(); i++)
+            big[i] = static_cast<T>(i * 31);
+
+        (*v_map)["name"] = "WhiZTiM";
+        (*v_map)["blob"] = big;
+        (*v_map)["empty"] = Value::BinaryType();
+        (*v_map)["extras"] = { *v_binary, "nice one bro!", *v_binary };
+    }
+private:
+    Value::Uptr v_binary;
+    Value::Uptr v_map;
+
+    static std::string encode(const Value& v, StreamWriterPolicy policy = defaultStreamWriterPolicy())
+    {
+        std::ostringstream os;
+        StreamWriter<std::ostringstream> writer(os, policy);
+        auto result = writer.writeValue(v);
+        CPPUNIT_ASSERT( result.second );
+        CPPUNIT_ASSERT_EQUAL( result.first, os.str().size() );
+        return os.str();
+    }
+
+    //! a std::string of every byte of the literal, including embedded '\\0'
+    template<std::size_t N>
+    static std::string bytes(const char (&str)[N])
+    { return std::string(str, N - 1); }
+
+    static Value decode(const std::string& bytes, ValueSizePolicy policy = defaultStreamReaderPolicy())
+    {
+        std::istringstream is(bytes);
+        StreamReader<std::istringstream> reader(is, policy);
+        Value v;
+        if(not reader.getNextValue(v))
+            throw parsing_exception("decode failed");
+        return v;
+    }
+
+public:
+    void test_binary_encoding()
+    {
+        const std::string expected("b" "i\x04" "\xab\xbc\xcd\xdf", 7);
+        CPPUNIT_ASSERT( encode(*v_binary) == expected );
+    }
+
+    void test_binary_roundtrip()
+    {
+        Value b = decode(encode(*v_binary));
+        CPPUNIT_ASSERT( b.isBinary() );
+        CPPUNIT_ASSERT_EQUAL( static_cast<const Value::BinaryType&>(*v_binary), static_cast<const Value::BinaryType&>(b) );
+
+        Value m = decode(encode(*v_map));
+        CPPUNIT_ASSERT( m == *v_map );
+        CPPUNIT_ASSERT( m["blob"].isBinary() );
+        CPPUNIT_ASSERT( m["empty"].isBinary() );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(0), static_cast<Value::BinaryType&>(m["empty"]).size() );
+        CPPUNIT_ASSERT( m["extras"][2].isBinary() );
+    }
+
+    void test_binary_policy()
+    {
+        ValueSizePolicy policy = defaultStreamReaderPolicy();
+        policy.max_binary_size = 1024;
+        CPPUNIT_ASSERT_THROW( decode(encode(*v_map), policy), parsing_exception );
+        CPPUNIT_ASSERT_NO_THROW( decode(encode(*v_binary), policy) );
+
+        //a count far beyond the input fails the read; nothing that large is allocated
+        policy = defaultStreamReaderPolicy();
+        policy.max_binary_size = std::numeric_limits<std::size_t>::max();
+        policy.max_object_size = 1024 * 1024;
+        CPPUNIT_ASSERT_THROW( decode(bytes("bL\x00\x00\x10\x00\x00\x00\x00\x00" "abc"), policy), parsing_exception );
+        CPPUNIT_ASSERT( decode(encode(*v_map), policy) == *v_map );
+    }
+
+    void test_integer_widths()
+    {
+        CPPUNIT_ASSERT( encode(0) == bytes("i\x00") );
+        CPPUNIT_ASSERT( encode(127) == "i\x7f" );
+        CPPUNIT_ASSERT( encode(-128) == "i\x80" );
+        CPPUNIT_ASSERT( encode(128) == "U\x80" );
+        CPPUNIT_ASSERT( encode(255) == "U\xff" );
+        CPPUNIT_ASSERT( encode(-129) == "I\xff\x7f" );
+        CPPUNIT_ASSERT( encode(256) == bytes("I\x01\x00") );
+        CPPUNIT_ASSERT( encode(32767) == "I\x7f\xff" );
+        CPPUNIT_ASSERT( encode(32768) == bytes("l\x00\x00\x80\x00") );
+        CPPUNIT_ASSERT( encode(-2147483648ll) == bytes("l\x80\x00\x00\x00") );
+        CPPUNIT_ASSERT( encode(2147483648ll) == bytes("L\x00\x00\x00\x00\x80\x00\x00\x00") );
+
+        CPPUNIT_ASSERT( encode(7ull) == "U\x07" );
+        CPPUNIT_ASSERT( encode(200ull) == "U\xc8" );
+        CPPUNIT_ASSERT( encode(256ull) == bytes("I\x01\x00") );
+        CPPUNIT_ASSERT( encode(70000ull) == bytes("l\x00\x01\x11\x70") );
+        CPPUNIT_ASSERT( encode(18446744073709551615ull) == "Hi\x14" "18446744073709551615" );
+
+        //string lengths use the smallest width as well
+        CPPUNIT_ASSERT_EQUAL( std::size_t(1 + 2 + 200), encode(std::string(200, 'x')).size() );
+        CPPUNIT_ASSERT_EQUAL( 'U', encode(std::string(200, 'x'))[1] );
+    }
+
+    void test_integer_roundtrip()
+    {
+        const long long signed_values[] = { 0, 1, -1, 127, 128, 255, 256, -128, -129, 32767, -32768, 32768,
+                                            2147483647ll, -2147483648ll, 2147483648ll,
+                                            std::numeric_limits<long long>::max(), std::numeric_limits<long long>::min() };
+        for(auto v : signed_values)
+        {
+            Value d = decode(encode(v));
+            CPPUNIT_ASSERT( d.isInteger() );
+            CPPUNIT_ASSERT_EQUAL( v, d.asInt64() );
+        }
+
+        const unsigned long long unsigned_values[] = { 0, 255, 256, 65535, 4294967295ull,
+                                                       9223372036854775807ull, 9223372036854775808ull,
+                                                       std::numeric_limits<unsigned long long>::max() };
+        for(auto v : unsigned_values)
+        {
+            Value d = decode(encode(v));
+            CPPUNIT_ASSERT( d.isInteger() );
+            CPPUNIT_ASSERT_EQUAL( v, d.asUint64() );
+        }
+
+        Value big = decode(encode(18446744073709551615ull));
+        CPPUNIT_ASSERT( big.isUnsignedInteger() );
+    }
+
+    void test_optimized_containers()
+    {
+        Value counted = decode(bytes("[#U\x03" "i\x01" "U\xc8" "Si\x02hi"));
+        CPPUNIT_ASSERT( counted == Value({1, 200, "hi"}) );
+
+        Value typed = decode(bytes("[$i#i\x03" "\x01\x02\x03"));
+        CPPUNIT_ASSERT( typed == Value({1, 2, 3}) );
+
+        Value object = decode(bytes("{$U#i\x02" "i\x01" "a\x05" "i\x01" "b\xff"));
+        CPPUNIT_ASSERT_EQUAL( 5, object["a"].asInt() );
+        CPPUNIT_ASSERT_EQUAL( 255, object["b"].asInt() );
+    }
+
+    static double roundtrip(double d, FloatEncoding enc)
+    {
+        return decode(encode(d, {enc})).asFloat();
+    }
+
+    static bool same_bits(double lhs, double rhs)
+    {
+        return std::memcmp(&lhs, &rhs, sizeof(double)) == 0;
+    }
+
+    void test_float_narrowing()
+    {
+        CPPUNIT_ASSERT_EQUAL( 'd', encode(0.1)[0] );
+        CPPUNIT_ASSERT( roundtrip(0.1, FloatEncoding::narrowing) != 0.1 );
+        CPPUNIT_ASSERT_EQUAL( 'D', encode(1e300)[0] );
+
+        //values beyond float range used to be dropped
+        CPPUNIT_ASSERT_EQUAL( std::size_t(9), encode(std::numeric_limits<double>::infinity()).size() );
+        CPPUNIT_ASSERT( std::isnan(roundtrip(std::nan(""), FloatEncoding::narrowing)) );
+    }
+
+    void test_float_lossless()
+    {
+        const StreamWriterPolicy lossless{FloatEncoding::lossless};
+        CPPUNIT_ASSERT( encode(0.5, lossless) == bytes("d\x3f\x00\x00\x00") );
+        CPPUNIT_ASSERT_EQUAL( 'D', encode(0.1, lossless)[0] );
+        CPPUNIT_ASSERT_EQUAL( 'D', encode(16777217.0, lossless)[0] );
+        CPPUNIT_ASSERT_EQUAL( 'd', encode(16777216.0, lossless)[0] );
+        CPPUNIT_ASSERT_EQUAL( 'd', encode(std::numeric_limits<float>::denorm_min(), lossless)[0] );
+        CPPUNIT_ASSERT_EQUAL( 'D', encode(double(std::numeric_limits<float>::denorm_min()) / 2, lossless)[0] );
+        CPPUNIT_ASSERT_EQUAL( 'd', encode(-std::numeric_limits<double>::infinity(), lossless)[0] );
+
+        const double values[] = { 0.1, -0.0, 0.0, 1.0/3, 3.1416, -2342.2525236, 1e-310, 1e300, 6.02214076e23,
+                                  std::numeric_limits<float>::max(), std::numeric_limits<float>::min() / 8,
+                                  std::numeric_limits<double>::max(), std::numeric_limits<double>::infinity() };
+        for(auto d : values)
+        {
+            CPPUNIT_ASSERT( same_bits(d, roundtrip(d, FloatEncoding::lossless)) );
+            CPPUNIT_ASSERT( same_bits(d, roundtrip(d, FloatEncoding::lossless_integral)) );
+        }
+    }
+
+    void test_float_lossless_integral()
+    {
+        const StreamWriterPolicy integral{FloatEncoding::lossless_integral};
+        CPPUNIT_ASSERT( encode(3.0, integral) == "i\x03" );
+        CPPUNIT_ASSERT( encode(-16777217.0, integral) == bytes("l\xfe\xff\xff\xff") );
+        CPPUNIT_ASSERT_EQUAL( 'd', encode(-40000.0, integral)[0] );    //same size; keep the float
+        CPPUNIT_ASSERT_EQUAL( 'd', encode(-0.0, integral)[0] );
+        CPPUNIT_ASSERT_EQUAL( 'd', encode(2.5, integral)[0] );
+        CPPUNIT_ASSERT_EQUAL( 'd', encode(1099511627776.0, integral)[0] );     //2^40; Float32 is shorter than Int64
+        CPPUNIT_ASSERT_EQUAL( 'D', encode(1099511627777.0, integral)[0] );     //Int64 is no shorter than Float64
+        CPPUNIT_ASSERT_EQUAL( 'D', encode(1e19, integral)[0] );
+
+        Value v = decode(encode(3.0, integral));
+        CPPUNIT_ASSERT( v.isInteger() );
+        CPPUNIT_ASSERT( v == Value(3.0) );
+    }
+
+    void test_high_precision_value()
+    {
+        const std::string digits = "-12345678901234567890.123456789e-5";
+        HighPrecisionNumber small(digits);
+        CPPUNIT_ASSERT( small.isValid() );
+        CPPUNIT_ASSERT_EQUAL( digits, small.str() );
+
+        std::string longer = "3.";
+        longer.append(200, '1');
+        HighPrecisionNumber large(longer);       //beyond the inline capacity
+        CPPUNIT_ASSERT_EQUAL( longer, large.str() );
+        CPPUNIT_ASSERT( large == HighPrecisionNumber(large) );
+        CPPUNIT_ASSERT( large != small );
+        CPPUNIT_ASSERT_THROW( HighPrecisionNumber("12a"), value_exception );
+        CPPUNIT_ASSERT_THROW( HighPrecisionNumber("01", 2), value_exception );
+
+        CPPUNIT_ASSERT_EQUAL( 0.1, HighPrecisionNumber("0.1").toDouble() );
+        CPPUNIT_ASSERT_EQUAL( 1.7976931348623157e308, HighPrecisionNumber("1.7976931348623157e308").toDouble() );
+
+        //halfway between 1 and the next double rounds to even, unless a digit far down says it is above
+        const std::string half = "1.00000000000000011102230246251565404236316680908203125" + std::string(2000, '0');
+        CPPUNIT_ASSERT_EQUAL( 1.0, HighPrecisionNumber(half).toDouble() );
+        CPPUNIT_ASSERT_EQUAL( 1.0000000000000002, HighPrecisionNumber(half + "1").toDouble() );
+        CPPUNIT_ASSERT_EQUAL( -1e-300, HighPrecisionNumber("-0." + std::string(299, '0') + "1" + std::string(1000, '0')).toDouble() );
+
+        Value v = large;
+        CPPUNIT_ASSERT( v.isHighPrecision() );
+        CPPUNIT_ASSERT( not v.isNumeric() );
+        CPPUNIT_ASSERT_EQUAL( longer, v.asString() );
+        CPPUNIT_ASSERT( std::fabs(v.asFloat() - 3.1111111111111111) < 1e-15 );
+        CPPUNIT_ASSERT( v == Value(HighPrecisionNumber(longer)) );
+        CPPUNIT_ASSERT( static_cast<HighPrecisionNumber>(v) == large );
+        CPPUNIT_ASSERT_EQUAL( 42ll, Value(HighPrecisionNumber("-42")).asInt64() * -1 );
+
+        std::ostringstream os;
+        os << to_ostream(v);
+        CPPUNIT_ASSERT( os.str().find(longer) != std::string::npos );
+    }
+
+    void test_high_precision_roundtrip()
+    {
+        const std::string text = "1234567890.12345678901234567890";
+        CPPUNIT_ASSERT( encode(Value(HighPrecisionNumber(text))) == "Hi" + std::string(1, char(text.size())) + text );
+
+        Value v = decode(encode(Value(HighPrecisionNumber(text))));
+        CPPUNIT_ASSERT( v.isHighPrecision() );
+        CPPUNIT_ASSERT_EQUAL( text, v.asString() );
+
+        std::string longer = "-9";
+        longer.append(300, '8');
+        longer += "E+17";
+        Value array = { 1, Value(HighPrecisionNumber(longer)), "x" };
+        Value back = decode(encode(array));
+        CPPUNIT_ASSERT( back == array );
+        CPPUNIT_ASSERT_EQUAL( longer, back[1].asString() );
+
+        //integers beyond Int64 still come back as UnsignedInt
+        CPPUNIT_ASSERT( decode(encode(18446744073709551615ull)).isUnsignedInteger() );
+
+        CPPUNIT_ASSERT_THROW( decode(bytes("HU\x03" "1.e")), parsing_exception );
+        CPPUNIT_ASSERT_THROW( decode(bytes("HU\x02" "1x")), parsing_exception );
+    }
+
+    void test_object_keys()
+    {
+        //keys of every length share one buffer while being read; each must still come out whole
+        Value v;
+        v["a key that is long enough to live on the heap"] = 1;
+        v["k"] = 2;
+        v["another rather long key, read after a short one"]["k"] = "nested";
+        v["another rather long key, read after a short one"]["a key that is long enough"] = 3;
+        v[""] = 4;
+        CPPUNIT_ASSERT( decode(encode(v)) == v );
+
+        Value twice = decode(bytes("{i\x01" "aU\x01" "i\x01" "aU\x02" "}"));
+        CPPUNIT_ASSERT_EQUAL( std::size_t(1), twice.size() );
+        CPPUNIT_ASSERT_EQUAL( 2, twice["a"].asInt() );
+
+        //a decoded Map is shared by its copies, as any other is
+        const Value decoded = decode(encode(v));
+        const Value copy = decoded;
+        CPPUNIT_ASSERT( &copy["k"] == &decoded["k"] );
+    }
+
+    void test_string_policy()
+    {
+        ValueSizePolicy policy = defaultStreamReaderPolicy();
+        policy.max_string_size = 4;
+        CPPUNIT_ASSERT_NO_THROW( decode(encode(Value({ "abcd", Value("abcd", 1) })), policy) );
+        CPPUNIT_ASSERT_THROW( decode(encode(Value("abcde")), policy), parsing_exception );
+        CPPUNIT_ASSERT_THROW( decode(encode(Value("abcde", 1)), policy), parsing_exception );
+
+        //a count far beyond the input fails the read; nothing that large is allocated
+        CPPUNIT_ASSERT_THROW( decode(bytes("SL\x00\x00\x10\x00\x00\x00\x00\x00" "abc")), parsing_exception );
+        policy = defaultStreamReaderPolicy();
+        policy.max_string_size = std::numeric_limits<std::size_t>::max();
+        CPPUNIT_ASSERT_THROW( decode(bytes("SL\x00\x00\x10\x00\x00\x00\x00\x00" "abc"), policy), parsing_exception );
+    }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( Stream_Roundtrip_Test );
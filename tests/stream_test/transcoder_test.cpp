@@ -0,0 +1,256 @@
+#include "value.hpp"
+#include "transcoder.hpp"
+#include "json_reader.hpp"
+#include "json_writer.hpp"
+#include "stream_reader.hpp"
+#include "stream_writer.hpp"
+#include "../test_utils/format_helpers.hpp"
+#include <cppunit/extensions/HelperMacros.h>
+#include <sstream>
+
+using namespace ubjson;
+int weird_cppunit_extern_bug_transcoder_test = 0;
+
+class Transcoder_Test : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( Transcoder_Test );
+    CPPUNIT_TEST( test_ubjson_to_json );
+    CPPUNIT_TEST( test_optimized_containers );
+    CPPUNIT_TEST( test_many_documents );
+    CPPUNIT_TEST( test_large_document );
+    CPPUNIT_TEST( test_ubjson_errors );
+    CPPUNIT_TEST( test_json_to_ubjson );
+    CPPUNIT_TEST( test_json_errors );
+    CPPUNIT_TEST( test_roundtrip );
+    CPPUNIT_TEST_SUITE_END();
+
+    static std::string encode(const Value& v)
+    {
+        std::ostringstream os;
+        StreamWriter<std::ostringstream> writer(os);
+        writer.writeValue(v);
+        return os.str();
+    }
+
+    static Value decode(const std::string& bytes)
+    {
+        std::istringstream is(bytes);
+        StreamReader<std::istringstream> reader(is);
+        return reader.getNextValue();
+    }
+
+    static std::string to_json(const std::string& bytes, JsonWriter::Opt option = JsonWriter::compact,
+                               ValueSizePolicy policy = defaultStreamReaderPolicy())
+    {
+        std::istringstream is(bytes);
+        std::ostringstream os;
+        UbjsonToJson(is, os, option, policy).transcodeAll();
+        return os.str();
+    }
+
+    static std::string to_ubjson(const std::string& text, ValueSizePolicy policy = defaultStreamReaderPolicy(),
+                                 StreamWriterPolicy wpolicy = defaultStreamWriterPolicy())
+    {
+        std::istringstream is(text);
+        std::ostringstream os;
+        JsonToUbjson(is, os, wpolicy, policy).transcodeAll();
+        return os.str();
+    }
+
+    static StreamWriterPolicy lossless() { return { FloatEncoding::lossless }; }
+
+    template<typename Fn>
+    static bool fails(Fn fn)
+    {
+        try { fn(); }
+        catch(parsing_exception&) { return true; }
+        return false;
+    }
+
+    template<std::size_t N>
+    static std::string bytes(const char (&str)[N])
+    { return std::string(str, N - 1); }
+
+    //! without chars or empty containers, which StreamReader and JsonReader give differently
+    static Value sample(int n)
+    {
+        Value v;
+        for(int i = 0; i < n; i++)
+        {
+            Value record;
+            record["id"] = i;
+            record["ratio"] = i / 7.0;
+            record["big"] = 18446744073709551615ULL - i;
+            record["text"] = "line \"" + std::to_string(i) + "\"\n\twith\\escapes \xc3\xa9";
+            record["list"] = { i * 300, -i, true, false, Value() };
+            v.push_back(std::move(record));
+        }
+        return v;
+    }
+
+public:
+    void test_ubjson_to_json()
+    {
+        const Value v = sample(50);
+        const std::string json = to_json(encode(v));
+        CPPUNIT_ASSERT_EQUAL( '\n', json.back() );
+        CPPUNIT_ASSERT( decode(encode(v)) == JsonReader().parse(json) );
+
+        //with one member per object the order is the same, so the text is too
+        Value single;
+        single["k"] = { 1, -2.5, "three", Value("four", Value()) };
+        CPPUNIT_ASSERT_EQUAL( JsonWriter().writeValue(single).release() + "\n", to_json(encode(single)) );
+        CPPUNIT_ASSERT_EQUAL( JsonWriter(JsonWriter::pretty).writeValue(single).release() + "\n",
+                              to_json(encode(single), JsonWriter::pretty) );
+
+        //members keep the order they were encoded in
+        CPPUNIT_ASSERT_EQUAL( std::string("{\"b\":1,\"a\":2}\n"), to_json(bytes("{i\x01" "bU\x01i\x01" "aU\x02}")) );
+
+        CPPUNIT_ASSERT_EQUAL( std::string("[]\n"), to_json("[]") );
+        CPPUNIT_ASSERT_EQUAL( std::string("{}\n"), to_json("{}") );
+        CPPUNIT_ASSERT_EQUAL( std::string("null\n"), to_json("N") );
+        CPPUNIT_ASSERT_EQUAL( std::string("[0,255,7]\n"), to_json(bytes("bU\x03\x00\xff\x07")) );
+        CPPUNIT_ASSERT_EQUAL( std::string("123456789012345678901234567890\n"),
+                              to_json("HU\x1e" "123456789012345678901234567890") );
+        CPPUNIT_ASSERT_EQUAL( std::string("18446744073709551615\n"), to_json("HU\x14" "18446744073709551615") );
+    }
+
+    void test_optimized_containers()
+    {
+        CPPUNIT_ASSERT_EQUAL( std::string("[1,2,3]\n"), to_json(bytes("[#U\x03U\x01U\x02U\x03")) );
+        CPPUNIT_ASSERT_EQUAL( std::string("[1,-2,3]\n"), to_json(bytes("[$i#U\x03\x01\xfe\x03")) );
+        CPPUNIT_ASSERT_EQUAL( std::string("[256,-1]\n"), to_json(bytes("[$I#U\x02\x01\x00\xff\xff")) );
+        CPPUNIT_ASSERT_EQUAL( std::string("[\"a\",\"b\"]\n"), to_json(bytes("[$C#U\x02" "ab")) );
+        CPPUNIT_ASSERT_EQUAL( std::string("[null,null]\n"), to_json(bytes("[$Z#U\x02")) );
+        CPPUNIT_ASSERT_EQUAL( std::string("{\"x\":1,\"y\":2}\n"), to_json(bytes("{$U#U\x02U\x01x\x01U\x01y\x02")) );
+        CPPUNIT_ASSERT_EQUAL( std::string("[]\n"), to_json(bytes("[$d#U\x00")) );
+
+        //more items than a window holds
+        std::string typed = bytes("[$l#I\x75\x30"), expected = "[";
+        for(int i = 0; i < 30000; i++)
+        {
+            typed += std::string("\x00\x01", 2) + char(i >> 8) + char(i);
+            expected += (i ? "," : "") + std::to_string(65536 + i);
+        }
+        CPPUNIT_ASSERT_EQUAL( expected + "]\n", to_json(typed) );
+    }
+
+    void test_many_documents()
+    {
+        const std::string input = encode(Value(1)) + encode(Value("two")) + encode(Value{ 3, 4 });
+        std::istringstream is(input);
+        std::ostringstream os;
+        UbjsonToJson transcoder(is, os);
+        CPPUNIT_ASSERT( transcoder.transcodeNext() );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(2), transcoder.transcodeAll() );
+        CPPUNIT_ASSERT( not transcoder.transcodeNext() );
+        CPPUNIT_ASSERT_EQUAL( std::string("1\n\"two\"\n[3,4]\n"), os.str() );
+        CPPUNIT_ASSERT_EQUAL( input.size(), transcoder.getBytesRead() );
+
+        CPPUNIT_ASSERT_EQUAL( std::string(), to_json("") );
+        CPPUNIT_ASSERT_EQUAL( encode(Value(1)) + encode(Value("two")) + encode(Value{ 3, 4 }),
+                              to_ubjson(" 1\n\"two\"\n\n[3,4]  \n") );
+    }
+
+    void test_large_document()
+    {
+        //strings, escapes and numbers across every window boundary
+        const Value v = sample(3000);
+        const std::string encoded = encode(v);
+        CPPUNIT_ASSERT( encoded.size() > 4 * 64 * 1024 );
+
+        const std::string json = to_json(encoded);
+        CPPUNIT_ASSERT( decode(encoded) == JsonReader().parse(json) );
+        CPPUNIT_ASSERT( decode(encoded) == decode(to_ubjson(json, defaultStreamReaderPolicy(), lossless())) );
+
+        Value strings;
+        for(int i = 0; i < 40; i++)
+            strings.push_back(std::string(i * 4099, char('a' + i % 26)) + "\\\"");
+        CPPUNIT_ASSERT( strings == decode(to_ubjson(JsonWriter().writeValue(strings).release())) );
+    }
+
+    void test_ubjson_errors()
+    {
+        const std::string encoded = encode(sample(2));
+        for(std::size_t n = 1; n < encoded.size(); n += 3)
+            CPPUNIT_ASSERT( fails([&]{ to_json(encoded.substr(0, n)); }) );
+
+        CPPUNIT_ASSERT( fails([]{ to_json("X"); }) );
+        CPPUNIT_ASSERT( fails([]{ to_json(bytes("[$i\x01]")); }) );
+        CPPUNIT_ASSERT( fails([]{ to_json(bytes("Si\xff")); }) );
+
+        ValueSizePolicy policy = defaultStreamReaderPolicy();
+        policy.max_value_depth = 3;
+        CPPUNIT_ASSERT( not fails([&]{ to_json("[[[]]]", JsonWriter::compact, policy); }) );
+        CPPUNIT_ASSERT( fails([&]{ to_json("[[[[]]]]", JsonWriter::compact, policy); }) );
+
+        policy = defaultStreamReaderPolicy();
+        policy.validate_utf8 = true;
+        CPPUNIT_ASSERT( fails([&]{ to_json(bytes("SU\x01\xff"), JsonWriter::compact, policy); }) );
+        CPPUNIT_ASSERT( fails([&]{ to_json(bytes("{U\x01\xff" "Z}"), JsonWriter::compact, policy); }) );
+
+        policy = defaultStreamReaderPolicy();
+        policy.max_array_items = 2;
+        CPPUNIT_ASSERT( fails([&]{ to_json(bytes("[$Z#U\x03"), JsonWriter::compact, policy); }) );
+    }
+
+    void test_json_to_ubjson()
+    {
+        const Value v = sample(50);
+        const std::string text = JsonWriter().writeValue(v).release();
+        CPPUNIT_ASSERT( JsonReader().parse(text) == decode(to_ubjson(text, defaultStreamReaderPolicy(), lossless())) );
+
+        //what StreamWriter writes for the Value JsonReader gives
+        for(const char* json : { "null", "true", "false", "0", "-1", "300", "-70000", "18446744073709551615",
+                                 "2.5", "-1e-7", "\"\"", "\"caf\\u00e9\"", "123456789012345678901234567890",
+                                 "[1,[2,[]],\"x\"]", "{\"k\":[true,null]}" })
+            CPPUNIT_ASSERT_EQUAL( encode(JsonReader().parse(json)), to_ubjson(json) );
+
+        CPPUNIT_ASSERT_EQUAL( bytes("{i\x01" "bi\x01i\x01" "ai\x02}"), to_ubjson("{ \"b\" : 1 , \"a\" : 2 }") );
+        CPPUNIT_ASSERT_EQUAL( std::string("{}[]"), to_ubjson("{} []") );
+    }
+
+    void test_json_errors()
+    {
+        const char* bad[] = {
+            "[", "]", "{", "[1,]", "[1 2]", "{\"a\" 1}", "{\"a\":}", "{\"a\":1,}", "{1:2}",
+            "nul", "truex", "True", "[1]]", "\"abc", "\"abc\\\"", "\"a\nb\"", "\"\\x\"",
+            "\"\\ud800\"", "01", "-", "1.", ".5", "1e", "+1", "[\"a\"\"b\"]"
+        };
+        for(const char* text : bad)
+            CPPUNIT_ASSERT_MESSAGE( text, fails([&]{ to_ubjson(text); }) );
+
+        ValueSizePolicy policy = defaultStreamReaderPolicy();
+        policy.max_value_depth = 3;
+        CPPUNIT_ASSERT( not fails([&]{ to_ubjson("[[[1]]]", policy); }) );
+        CPPUNIT_ASSERT( fails([&]{ to_ubjson("[[[[1]]]]", policy); }) );
+
+        policy = defaultStreamReaderPolicy();
+        policy.max_string_size = 4;
+        CPPUNIT_ASSERT( not fails([&]{ to_ubjson("[\"abcd\"]", policy); }) );
+        CPPUNIT_ASSERT( fails([&]{ to_ubjson("{\"abcde\":1}", policy); }) );
+
+        //the size limit is per document
+        policy = defaultStreamReaderPolicy();
+        policy.max_object_size = 8;
+        CPPUNIT_ASSERT( not fails([&]{ to_ubjson("[1,2,3]\n[4,5,6]\n[7,8,9]", policy); }) );
+        CPPUNIT_ASSERT( fails([&]{ to_ubjson("[1,2,3,4,5]", policy); }) );
+
+        //what is read past a literal or number to find its end doesn't count
+        policy.max_object_size = 10;
+        for(const char* text : { "[1,2,true]", "[1,2,1234]", "[1,false]", "true", "1234567890" })
+            CPPUNIT_ASSERT_MESSAGE( text, not fails([&]{ to_ubjson(text, policy); }) );
+        CPPUNIT_ASSERT( fails([&]{ to_ubjson("[1,2,3,true]", policy); }) );
+    }
+
+    void test_roundtrip()
+    {
+        Value single;
+        single["records"] = { 1, -2.25, 1e300, "x\ty", Value("k", { true, Value() }), Value::ArrayType() };
+        const std::string text = JsonWriter().writeValue(single).release();
+        CPPUNIT_ASSERT_EQUAL( text + "\n", to_json(to_ubjson(text, defaultStreamReaderPolicy(), lossless())) );
+    }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( Transcoder_Test );
@@ -0,0 +1,223 @@
+#include "value.hpp"
+#include "validator.hpp"
+#include "buffer_scanner.hpp"
+#include "stream_reader.hpp"
+#include "stream_writer.hpp"
+#include "../test_utils/format_helpers.hpp"
+#include <cppunit/extensions/HelperMacros.h>
+#include <sstream>
+#include <cstring>
+
+using namespace ubjson;
+int weird_cppunit_extern_bug_validator_test = 0;
+
+class Validator_Test : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( Validator_Test );
+    CPPUNIT_TEST( test_valid_documents );
+    CPPUNIT_TEST( test_malformed );
+    CPPUNIT_TEST( test_policy_limits );
+    CPPUNIT_TEST( test_utf8 );
+    CPPUNIT_TEST( test_utf8_long_text );
+    CPPUNIT_TEST( test_utf8_policy );
+    CPPUNIT_TEST_SUITE_END();
+public:
+    void setUp() override
+    {
+        v_map = std::make_unique<Value>(Value());
+        (*v_map)["name"] = "WhiZTiM";
+        (*v_map)["list"] = { 1, "two", 3.5, true, Value() };
+        (*v_map)["nested"]["deeper"] = { 255, -40000, 1LL << 40 };
+        (*v_map)["blob"] = Value::BinaryType{ 0, 1, 2, 3 };
+        (*v_map)["big"] = Value::HighPrecisionType("123456789012345678901234567890.5e-3");
+    }
+private:
+    Value::Uptr v_map;
+
+    static std::string encode(const Value& v)
+    {
+        std::ostringstream os;
+        StreamWriter<std::ostringstream> writer(os);
+        writer.writeValue(v);
+        return os.str();
+    }
+
+    template<std::size_t N>
+    static std::string bytes(const char (&str)[N])
+    { return std::string(str, N - 1); }
+
+    static ValidationResult check(const std::string& s, bool utf8 = false)
+    { return validate(s.data(), s.size(), defaultStreamReaderPolicy(), utf8); }
+
+public:
+    void test_valid_documents()
+    {
+        const std::string one = encode(*v_map);
+        auto result = check(one, true);
+        CPPUNIT_ASSERT( result );
+        CPPUNIT_ASSERT_EQUAL( one.size(), result.error_offset );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(1), result.documents );
+
+        const std::string three = one + encode(Value{ 1, 2, 3 }) + encode("plain");
+        CPPUNIT_ASSERT_EQUAL( std::size_t(3), check(three).documents );
+
+        //typed and counted containers, including fixed width ones checked in one step
+        CPPUNIT_ASSERT( check(bytes("[$i#i\x03" "\x01\x02\x03")) );
+        CPPUNIT_ASSERT( check(bytes("{$U#i\x02" "i\x01" "a\x07" "i\x01" "b\x08")) );
+        CPPUNIT_ASSERT( check(bytes("[#i\x02" "Z[$Z#i\x05")) );
+        CPPUNIT_ASSERT( check(bytes("[$[#i\x02" "]" "]")) );
+    }
+
+    void test_malformed()
+    {
+        auto result = check(bytes("[i\x01" "Q]"));
+        CPPUNIT_ASSERT( not result );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(3), result.error_offset );
+        CPPUNIT_ASSERT_EQUAL( std::string("Invalid marker encountered!"), std::string(result.error) );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(0), result.documents );
+
+        const std::string doc = encode(*v_map);
+        for(std::size_t cut = 0; cut < doc.size(); ++cut)
+            CPPUNIT_ASSERT( not check(doc.substr(0, cut)) );
+
+        result = check(doc + bytes("Si\x05" "ab"));      //a truncated second document
+        CPPUNIT_ASSERT( not result );
+        CPPUNIT_ASSERT_EQUAL( doc.size() + 1, result.error_offset );      //its length
+        CPPUNIT_ASSERT_EQUAL( std::size_t(1), result.documents );
+
+        CPPUNIT_ASSERT_EQUAL( std::size_t(1), check(bytes("Si\xff" "abc")).error_offset );  //negative length
+        CPPUNIT_ASSERT_EQUAL( std::size_t(1), check(bytes("SZ")).error_offset );            //not a count
+        CPPUNIT_ASSERT_EQUAL( std::size_t(3), check(bytes("[$i" "i\x02" "\x01\x02")).error_offset );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(6), check(bytes("[#i\x05" "ZZ")).error_offset );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(3), check(bytes("Hi\x03" "1.e")).error_offset );
+        CPPUNIT_ASSERT( not check("") );
+    }
+
+    void test_policy_limits()
+    {
+        auto policy = defaultStreamReaderPolicy();
+        policy.max_value_depth = 3;
+        policy.max_array_items = 4;
+        policy.max_string_size = 5;
+        policy.max_object_size = 32;
+
+        auto run = [&](const std::string& s) { return validate(s.data(), s.size(), policy); };
+
+        CPPUNIT_ASSERT( run("[[[]]]") );
+        auto result = run("[[[[]]]]");
+        CPPUNIT_ASSERT_EQUAL( std::size_t(3), result.error_offset );
+        CPPUNIT_ASSERT_EQUAL( std::string("Maximum Parsing depth Exceeded!"), std::string(result.error) );
+
+        CPPUNIT_ASSERT( run("[ZZZZ]") );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(5), run("[ZZZZZ]").error_offset );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(1), run(bytes("[#i\x05" "ZZZZZ")).error_offset );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(3), run(bytes("[$Z#l\x7f\xff\xff\xff")).error_offset );
+
+        CPPUNIT_ASSERT( run(bytes("Si\x05" "abcde")) );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(1), run(bytes("Si\x06" "abcdef")).error_offset );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(1), run(bytes("{i\x06" "abcdefZ}")).error_offset );
+
+        //the size limit applies to each document of the buffer
+        const std::string doc = bytes("Si\x05" "abcde");
+        std::string many;
+        for(int i = 0; i < 10; i++)
+            many += doc;
+        CPPUNIT_ASSERT_EQUAL( std::size_t(10), run(many).documents );
+        result = run(bytes("{i\x01" "aSi\x05" "abcdei\x01" "bSi\x05" "abcdei\x01" "cSi\x05" "abcde}"));
+        CPPUNIT_ASSERT( not result );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(32), result.error_offset );
+        CPPUNIT_ASSERT_EQUAL( std::string("Maximum Object size exceeded!"), std::string(result.error) );
+    }
+
+    void test_utf8()
+    {
+        const char* good[] = { "", "plain ASCII, longer than a word", "\xc3\xa9t\xc3\xa9", "\xe2\x82\xac",
+                               "\xed\x9f\xbf", "\xf0\x9f\x98\x80", "\xf4\x8f\xbf\xbf" };
+        for(const char* s : good)
+            CPPUNIT_ASSERT_EQUAL( std::strlen(s), validateUtf8(s, std::strlen(s)) );
+
+        CPPUNIT_ASSERT_EQUAL( std::size_t(10), validateUtf8("0123456789\x80", 11) );  //a lone continuation
+        CPPUNIT_ASSERT_EQUAL( std::size_t(0), validateUtf8("\xc0\xaf", 2) );          //overlong
+        CPPUNIT_ASSERT_EQUAL( std::size_t(0), validateUtf8("\xe0\x80\xaf", 3) );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(0), validateUtf8("\xed\xa0\x80", 3) );      //a surrogate
+        CPPUNIT_ASSERT_EQUAL( std::size_t(0), validateUtf8("\xf4\x90\x80\x80", 4) );  //beyond U+10FFFF
+        CPPUNIT_ASSERT_EQUAL( std::size_t(1), validateUtf8("a\xe2\x82", 3) );         //truncated
+        CPPUNIT_ASSERT_EQUAL( std::size_t(0), validateUtf8("\xc3(", 2) );
+
+        const std::string doc = bytes("{i\x02" "k\xffSi\x02" "ok}");
+        CPPUNIT_ASSERT( check(doc) );
+        auto result = check(doc, true);
+        CPPUNIT_ASSERT( not result );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(4), result.error_offset );
+        CPPUNIT_ASSERT( not check(bytes("Si\x03" "ab\xe2"), true) );
+    }
+
+    void test_utf8_long_text()
+    {
+        //long enough for the vector checks, with sequences across every block boundary
+        std::string text;
+        std::vector<std::size_t> starts;
+        const char* pieces[] = { "a", "\xc3\xa9", "\xe2\x82\xac", "\xf0\x9f\x98\x80", "xy" };
+        for(int i = 0; text.size() < 200; i++)
+        {
+            starts.push_back(text.size());
+            text += pieces[i % 5];
+        }
+        CPPUNIT_ASSERT_EQUAL( text.size(), validateUtf8(text.data(), text.size()) );
+
+        for(std::size_t at : starts)
+        {
+            std::string bad = text;
+            bad.insert(at, "\xff");
+            CPPUNIT_ASSERT_EQUAL( at, validateUtf8(bad.data(), bad.size()) );
+            bad = text;
+            bad.insert(at, "\xe2\x82");
+            CPPUNIT_ASSERT_EQUAL( at, validateUtf8(bad.data(), bad.size()) );
+            bad = text.substr(0, at) + "\xed\xa0\x80" + text.substr(at);
+            CPPUNIT_ASSERT_EQUAL( at, validateUtf8(bad.data(), bad.size()) );
+        }
+        text += "\xf0\x9f\x98\x80";
+        CPPUNIT_ASSERT_EQUAL( text.size() - 4, validateUtf8(text.data(), text.size() - 1) );    //cut short
+    }
+
+    void test_utf8_policy()
+    {
+        auto policy = defaultStreamReaderPolicy();
+        policy.validate_utf8 = true;
+
+        //sequences split across the chunks StreamReader reads strings in
+        std::string text;
+        while(text.size() < 20000)
+            text += "\xe2\x82\xac\xc3\xa9x";
+        Value good;
+        good[text] = text;
+        std::string encoded = encode(good);
+
+        std::istringstream is(encoded);
+        StreamReader<std::istringstream> reader(is, policy);
+        Value v;
+        CPPUNIT_ASSERT( reader.getNextValue(v) );
+        CPPUNIT_ASSERT( v == good );
+        CPPUNIT_ASSERT( validate(encoded.data(), encoded.size(), policy) );
+
+        const auto where = encoded.rfind("\xc3\xa9");
+        encoded[where + 1] = 'x';
+        std::istringstream bad(encoded);
+        StreamReader<std::istringstream> strict(bad, policy);
+        CPPUNIT_ASSERT( not strict.getNextValue(v) );
+        CPPUNIT_ASSERT_EQUAL( std::string("Invalid UTF-8 encountered!"), strict.getLastError() );
+        CPPUNIT_ASSERT_EQUAL( where, validate(encoded.data(), encoded.size(), policy).error_offset );
+
+        std::istringstream lax(encoded);
+        StreamReader<std::istringstream> unchecked(lax);
+        CPPUNIT_ASSERT( unchecked.getNextValue(v) );
+
+        const std::string key = bytes("{i\x02" "k\xffZ}");
+        BufferScanner scanner(reinterpret_cast<const byte*>(key.data()), key.size(), 8);
+        std::size_t pos = 1;
+        CPPUNIT_ASSERT_THROW( scanner.decodeValue('{', pos, policy), parsing_exception );
+    }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( Validator_Test );
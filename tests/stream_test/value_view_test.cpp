@@ -0,0 +1,172 @@
+#include "value.hpp"
+#include "value_view.hpp"
+#include "stream_reader.hpp"
+#include "stream_writer.hpp"
+#include "../test_utils/format_helpers.hpp"
+#include <cppunit/extensions/HelperMacros.h>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+
+using namespace ubjson;
+int weird_cppunit_extern_bug_value_view_test = 0;
+
+class Value_View_Test : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( Value_View_Test );
+    CPPUNIT_TEST( test_navigation );
+    CPPUNIT_TEST( test_iteration );
+    CPPUNIT_TEST( test_optimized_containers );
+    CPPUNIT_TEST( test_to_value );
+    CPPUNIT_TEST( test_malformed_buffers );
+    CPPUNIT_TEST_SUITE_END();
+public:
+    void setUp() override
+    {
+        v_doc = std::make_unique<Value>(Value());
+        (*v_doc)["name"] = "WhiZTiM";
+        (*v_doc)["id"] = 4546;
+        (*v_doc)["ratio"] = 2.5;
+        (*v_doc)["flag"] = true;
+        (*v_doc)["blob"] = Value::BinaryType({0xab, 0xcd});
+        (*v_doc)["list"] = { 34, "nice one bro!", '@', Value() };
+        (*v_doc)["nested"]["deeper"]["deepest"] = 18446744073709551615ull;
+        encoded = encode(*v_doc);
+    }
+private:
+    Value::Uptr v_doc;
+    std::string encoded;
+
+    static std::string encode(const Value& v)
+    {
+        std::ostringstream os;
+        StreamWriter<std::ostringstream> writer(os);
+        writer.writeValue(v);
+        return os.str();
+    }
+
+    static Value decode(const std::string& bytes)
+    {
+        std::istringstream is(bytes);
+        StreamReader<std::istringstream> reader(is);
+        return reader.getNextValue();
+    }
+
+    template<std::size_t N>
+    static std::string bytes(const char (&str)[N])
+    { return std::string(str, N - 1); }
+
+public:
+    void test_navigation()
+    {
+        ValueView doc(encoded.data(), encoded.size());
+        CPPUNIT_ASSERT( doc.isMap() );
+        CPPUNIT_ASSERT_EQUAL( v_doc->size(), doc.size() );
+
+        CPPUNIT_ASSERT_EQUAL( std::string("WhiZTiM"), doc["name"].asString() );
+        CPPUNIT_ASSERT( doc["id"].isSignedInteger() );
+        CPPUNIT_ASSERT_EQUAL( 4546, doc["id"].asInt() );
+        CPPUNIT_ASSERT_EQUAL( 2.5, doc["ratio"].asFloat() );
+        CPPUNIT_ASSERT( doc["flag"].asBool() );
+        CPPUNIT_ASSERT( doc["blob"].asBinary() == Value::BinaryType({0xab, 0xcd}) );
+        CPPUNIT_ASSERT( doc["nested"]["deeper"]["deepest"].isUnsignedInteger() );
+        CPPUNIT_ASSERT_EQUAL( 18446744073709551615ull, doc["nested"]["deeper"]["deepest"].asUint64() );
+
+        ValueView list = doc["list"];
+        CPPUNIT_ASSERT( list.isArray() );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(4), list.size() );
+        CPPUNIT_ASSERT_EQUAL( std::string("nice one bro!"), list[1].asString() );
+        CPPUNIT_ASSERT( list[2].isChar() );
+        CPPUNIT_ASSERT( list[3].isNull() );
+        CPPUNIT_ASSERT_EQUAL( 34, list[0].asInt() );    //already indexed; served from the cache
+
+        CPPUNIT_ASSERT( doc.contains("name") );
+        CPPUNIT_ASSERT( not doc.contains("surname") );
+        CPPUNIT_ASSERT( not list.contains("name") );
+        CPPUNIT_ASSERT_THROW( doc["surname"], std::out_of_range );
+        CPPUNIT_ASSERT_THROW( list[4], std::out_of_range );
+        CPPUNIT_ASSERT_THROW( list[-1], std::out_of_range );
+        CPPUNIT_ASSERT_THROW( list["name"], value_exception );
+        CPPUNIT_ASSERT_THROW( doc[0], value_exception );
+
+        CPPUNIT_ASSERT( ValueView().isNull() );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(0), ValueView().size() );
+    }
+
+    void test_iteration()
+    {
+        ValueView doc(encoded.data(), encoded.size());
+        auto keys = doc.keys();
+        auto expected = v_doc->keys();
+        std::sort(keys.begin(), keys.end());
+        std::sort(expected.begin(), expected.end());
+        CPPUNIT_ASSERT( keys == expected );
+
+        std::size_t count = 0;
+        for(auto it = doc.begin(); it != doc.end(); ++it, ++count)
+            CPPUNIT_ASSERT( it->toValue() == (*v_doc)[it.key()] );
+        CPPUNIT_ASSERT_EQUAL( v_doc->size(), count );
+
+        std::vector<std::string> items;
+        for(const auto& item : doc["list"])
+            items.push_back(item.asString());
+        CPPUNIT_ASSERT_EQUAL( std::size_t(4), items.size() );
+        CPPUNIT_ASSERT_EQUAL( std::string("@"), items[2] );
+
+        CPPUNIT_ASSERT( doc["name"].begin() == doc["name"].end() );
+    }
+
+    void test_optimized_containers()
+    {
+        const std::string typed = bytes("[$l#i\x03" "\x00\x00\x00\x01" "\x00\x00\x00\x02" "\xff\xff\xff\xff");
+        ValueView ints(typed.data(), typed.size());
+        CPPUNIT_ASSERT_EQUAL( std::size_t(3), ints.size() );
+        CPPUNIT_ASSERT_EQUAL( 2, ints[1].asInt() );
+        CPPUNIT_ASSERT_EQUAL( -1, ints[2].asInt() );
+        CPPUNIT_ASSERT( ints.toValue() == decode(typed) );
+
+        const std::string object = bytes("{$S#i\x02" "i\x01" "a" "i\x02" "hi" "i\x01" "b" "i\x00");
+        ValueView map(object.data(), object.size());
+        CPPUNIT_ASSERT_EQUAL( std::string("hi"), map["a"].asString() );
+        CPPUNIT_ASSERT_EQUAL( std::string(), map["b"].asString() );
+        CPPUNIT_ASSERT( map.toValue() == decode(object) );
+
+        const std::string counted = bytes("[#i\x02" "[#i\x01" "Z" "{i\x01" "k" "T}");
+        ValueView nested(counted.data(), counted.size());
+        CPPUNIT_ASSERT( nested[0][0].isNull() );
+        CPPUNIT_ASSERT( nested[1]["k"].asBool() );
+
+        const std::string truncated = bytes("[$D#U\xff" "\x00\x00");
+        ValueView bad(truncated.data(), truncated.size());
+        CPPUNIT_ASSERT_THROW( bad.size(), parsing_exception );
+    }
+
+    void test_to_value()
+    {
+        ValueView doc(encoded.data(), encoded.size());
+        CPPUNIT_ASSERT( doc.toValue() == *v_doc );
+        CPPUNIT_ASSERT( doc["nested"].toValue() == (*v_doc)["nested"] );
+        CPPUNIT_ASSERT( doc["list"][1].toValue() == Value("nice one bro!") );
+    }
+
+    void test_malformed_buffers()
+    {
+        CPPUNIT_ASSERT_THROW( ValueView("", 0), parsing_exception );
+
+        const std::string cut = encoded.substr(0, encoded.size() / 2);
+        ValueView doc(cut.data(), cut.size());
+        CPPUNIT_ASSERT_THROW( doc.toValue(), parsing_exception );
+        CPPUNIT_ASSERT_THROW( doc.size(), parsing_exception );
+
+        const std::string invalid = bytes("[i\x01" "Q]");
+        CPPUNIT_ASSERT_THROW( ValueView(invalid.data(), invalid.size())[1], parsing_exception );
+
+        std::string deep(100, '[');
+        deep += std::string(100, ']');
+        ValueView nested(deep.data(), deep.size());
+        CPPUNIT_ASSERT_THROW( nested.size(), parsing_exception );       //beyond max_value_depth
+    }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( Value_View_Test );
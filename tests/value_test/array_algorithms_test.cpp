@@ -0,0 +1,131 @@
+#include "value.hpp"
+#include "array_algorithms.hpp"
+#include "../test_utils/format_helpers.hpp"
+#include <cppunit/extensions/HelperMacros.h>
+#include <algorithm>
+#include <string>
+#include <set>
+
+using namespace ubjson;
+int weird_cppunit_extern_bug_array_algorithms_test = 0;
+
+class Array_Algorithms_Test : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( Array_Algorithms_Test );
+    CPPUNIT_TEST( test_sort );
+    CPPUNIT_TEST( test_stableSort );
+    CPPUNIT_TEST( test_unique_and_dedupe );
+    CPPUNIT_TEST( test_edge_cases );
+    CPPUNIT_TEST_SUITE_END();
+
+    //! records with ids that repeat, in a scrambled order, and their original positions
+    static Value records(int count, int distinct)
+    {
+        Value rtn;
+        for(int i = 0; i < count; i++)
+        {
+            Value record;
+            record["user"]["id"] = (i * 7919) % distinct;
+            record["seq"] = i;
+            rtn.push_back(std::move(record));
+        }
+        return rtn;
+    }
+
+    static long long id(const Value& record)
+    { return record["user"]["id"].asInt64(); }
+
+public:
+    void test_sort()
+    {
+        for(unsigned threads : { 1u, 4u, 5u })
+        {
+            Value v = records(100000, 1000);
+            std::set<const Value*> before;
+            for(const auto& item : v)
+                before.insert(&item);
+
+            ArrayAlgorithms algorithms(threads);
+            algorithms.sort(v, {"user", "id"});
+            CPPUNIT_ASSERT_EQUAL( threads, algorithms.getThreadsUsed() );
+            CPPUNIT_ASSERT_EQUAL( std::size_t(100000), v.size() );
+            for(std::size_t i = 1; i < v.size(); i++)
+                CPPUNIT_ASSERT( id(v[i - 1]) <= id(v[i]) );
+
+            //the very same items, moved rather than copied
+            std::set<const Value*> after;
+            for(const auto& item : v)
+                after.insert(&item);
+            CPPUNIT_ASSERT( before == after );
+        }
+
+        Value whole = { 3, "b", 1.5, Value(), "a" };
+        ArrayAlgorithms().sort(whole);
+        CPPUNIT_ASSERT( whole == Value({ Value(), 1.5, 3, "a", "b" }) );
+    }
+
+    void test_stableSort()
+    {
+        Value v = records(50000, 100);
+        ArrayAlgorithms(4).stableSort(v, {"user", "id"});
+        for(std::size_t i = 1; i < v.size(); i++)
+        {
+            CPPUNIT_ASSERT( id(v[i - 1]) <= id(v[i]) );
+            if(id(v[i - 1]) == id(v[i]))
+                CPPUNIT_ASSERT( v[i - 1]["seq"].asInt64() < v[i]["seq"].asInt64() );
+        }
+    }
+
+    void test_unique_and_dedupe()
+    {
+        ArrayAlgorithms algorithms(4);
+
+        Value v = records(30000, 500);
+        CPPUNIT_ASSERT_EQUAL( std::size_t(29500), algorithms.dedupe(v, {"user", "id"}) );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(500), v.size() );
+        for(std::size_t i = 0; i < v.size(); i++)      //the first of each, in the original order
+            CPPUNIT_ASSERT_EQUAL( (long long)i, v[i]["seq"].asInt64() );
+
+        Value sorted = records(30000, 500);
+        algorithms.sort(sorted, {"user", "id"});
+        CPPUNIT_ASSERT_EQUAL( std::size_t(29500), algorithms.unique(sorted, {"user", "id"}) );
+        for(std::size_t i = 0; i < sorted.size(); i++)
+            CPPUNIT_ASSERT_EQUAL( (long long)i, id(sorted[i]) );
+
+        Value mixed = { 1, 1.0, 2, 1, 2ull, "1" };
+        CPPUNIT_ASSERT_EQUAL( std::size_t(1), algorithms.unique(mixed) );
+        CPPUNIT_ASSERT( mixed == Value({ 1, 2, 1, 2ull, "1" }) );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(2), algorithms.dedupe(mixed) );
+        CPPUNIT_ASSERT( mixed == Value({ 1, 2, "1" }) );
+    }
+
+    void test_edge_cases()
+    {
+        ArrayAlgorithms algorithms;
+
+        Value null;
+        algorithms.sort(null);
+        CPPUNIT_ASSERT_EQUAL( std::size_t(0), algorithms.dedupe(null) );
+        CPPUNIT_ASSERT( null.isNull() );
+
+        Value scalar = 5;
+        CPPUNIT_ASSERT_THROW( algorithms.sort(scalar), value_exception );
+
+        //items without the key sort first
+        Value v = { Value("k", 2), Value("other", 0), Value("k", 1), 7 };
+        algorithms.stableSort(v, {"k"});
+        CPPUNIT_ASSERT( v[0] == Value("other", 0) );
+        CPPUNIT_ASSERT( v[1] == Value(7) );
+        CPPUNIT_ASSERT( v[2] == Value("k", 1) );
+
+        //a copy that shares the items is left alone
+        Value original = { 3, 2, 1 };
+        Value copy = original;
+        algorithms.sort(copy);
+        CPPUNIT_ASSERT( original == Value({ 3, 2, 1 }) );
+        CPPUNIT_ASSERT( copy == Value({ 1, 2, 3 }) );
+    }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( Array_Algorithms_Test );
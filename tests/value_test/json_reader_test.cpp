@@ -0,0 +1,189 @@
+#include "value.hpp"
+#include "json_reader.hpp"
+#include "json_writer.hpp"
+#include "../test_utils/format_helpers.hpp"
+#include <cppunit/extensions/HelperMacros.h>
+#include <limits>
+
+using namespace ubjson;
+int weird_cppunit_extern_bug_json_reader_test = 0;
+
+class Json_Reader_Test : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( Json_Reader_Test );
+    CPPUNIT_TEST( test_scalars );
+    CPPUNIT_TEST( test_numbers );
+    CPPUNIT_TEST( test_strings );
+    CPPUNIT_TEST( test_containers );
+    CPPUNIT_TEST( test_malformed );
+    CPPUNIT_TEST( test_policy );
+    CPPUNIT_TEST( test_roundtrip );
+    CPPUNIT_TEST_SUITE_END();
+
+    static Value parse(const std::string& text)
+    { return JsonReader().parse(text); }
+
+    static bool fails(const std::string& text, ValueSizePolicy policy = defaultStreamReaderPolicy())
+    {
+        try { JsonReader(policy).parse(text); }
+        catch(parsing_exception&) { return true; }
+        return false;
+    }
+
+public:
+    void test_scalars()
+    {
+        CPPUNIT_ASSERT( parse("null").isNull() );
+        CPPUNIT_ASSERT( parse(" \t\r\n true \n").isBool() );
+        CPPUNIT_ASSERT_EQUAL( true, parse("true").asBool() );
+        CPPUNIT_ASSERT_EQUAL( false, parse("false").asBool() );
+        CPPUNIT_ASSERT_EQUAL( std::string("hello"), parse("\"hello\"").asString() );
+        CPPUNIT_ASSERT_EQUAL( std::string(), parse("\"\"").asString() );
+    }
+
+    void test_numbers()
+    {
+        //the same types the constructors pick
+        CPPUNIT_ASSERT( parse("42").type() == Value(42LL).type() );
+        CPPUNIT_ASSERT( parse("-42").type() == Value(-42LL).type() );
+        CPPUNIT_ASSERT( parse("18446744073709551615").type() == Value(18446744073709551615ULL).type() );
+        CPPUNIT_ASSERT( parse("2.5").type() == Value(2.5).type() );
+
+        CPPUNIT_ASSERT_EQUAL( 0LL, parse("0").asInt64() );
+        CPPUNIT_ASSERT_EQUAL( 0LL, parse("-0").asInt64() );
+        CPPUNIT_ASSERT_EQUAL( std::numeric_limits<long long>::max(), parse("9223372036854775807").asInt64() );
+        CPPUNIT_ASSERT_EQUAL( std::numeric_limits<long long>::min(), parse("-9223372036854775808").asInt64() );
+        CPPUNIT_ASSERT( parse("9223372036854775808").isUnsignedInteger() );
+        CPPUNIT_ASSERT_EQUAL( 9223372036854775808ULL, parse("9223372036854775808").asUint64() );
+
+        CPPUNIT_ASSERT_EQUAL( 0.1, parse("0.1").asFloat() );
+        CPPUNIT_ASSERT_EQUAL( -1.5e-7, parse("-1.5e-7").asFloat() );
+        CPPUNIT_ASSERT_EQUAL( 1e300, parse("1E+300").asFloat() );
+        CPPUNIT_ASSERT_EQUAL( 5e-324, parse("4.9406564584124654e-324").asFloat() );
+        CPPUNIT_ASSERT_EQUAL( 2.0, parse("2.0").asFloat() );
+        CPPUNIT_ASSERT_EQUAL( 123456789012345678.0, parse("123456789012345678.0").asFloat() );
+        CPPUNIT_ASSERT_EQUAL( 0.30000000000000004, parse("0.30000000000000004").asFloat() );
+
+        //beyond every native type, kept exactly
+        CPPUNIT_ASSERT( parse("123456789012345678901234567890").isHighPrecision() );
+        CPPUNIT_ASSERT( parse("-9223372036854775809").isHighPrecision() );
+        CPPUNIT_ASSERT( parse("1e400").isHighPrecision() );
+        CPPUNIT_ASSERT_EQUAL( std::string("-1e400"), static_cast<const Value::HighPrecisionType&>(parse("-1e400")).str() );
+    }
+
+    void test_strings()
+    {
+        CPPUNIT_ASSERT_EQUAL( std::string("a\"b\\c/d\b\f\n\r\t"), parse("\"a\\\"b\\\\c\\/d\\b\\f\\n\\r\\t\"").asString() );
+        CPPUNIT_ASSERT_EQUAL( std::string("caf\xc3\xa9"), parse("\"caf\\u00e9\"").asString() );
+        CPPUNIT_ASSERT_EQUAL( std::string("caf\xc3\xa9"), parse("\"caf\xc3\xa9\"").asString() );
+        CPPUNIT_ASSERT_EQUAL( std::string("\xe2\x82\xac"), parse("\"\\u20AC\"").asString() );
+        CPPUNIT_ASSERT_EQUAL( std::string("\xf0\x9f\x98\x80"), parse("\"\\ud83d\\ude00\"").asString() );
+        CPPUNIT_ASSERT_EQUAL( std::string(1, '\0'), parse("\"\\u0000\"").asString() );
+
+        //quotes and backslashes on both sides of every 64 byte block
+        std::string text = "\"", expected;
+        for(int i = 0; i < 300; i++)
+        {
+            const char c = i % 7 == 0 ? '"' : i % 13 == 0 ? '\\' : char('a' + i % 26);
+            expected += c;
+            if(c == '"' or c == '\\')
+                text += '\\';
+            text += c;
+        }
+        text += '"';
+        CPPUNIT_ASSERT_EQUAL( expected, parse(text).asString() );
+        CPPUNIT_ASSERT_EQUAL( expected, parse("[" + text + "," + text + "]")[1].asString() );
+
+        //a backslash run that ends exactly at a block boundary
+        const std::string slashes = std::string(62, 'x') + "\\\\";
+        CPPUNIT_ASSERT_EQUAL( std::string(62, 'x') + "\\", parse("\"" + slashes + "\"").asString() );
+        CPPUNIT_ASSERT_EQUAL( std::string(63, 'x') + "\"", parse("\"" + std::string(63, 'x') + "\\\"\"").asString() );
+    }
+
+    void test_containers()
+    {
+        Value v = parse(" { \"id\" : 7, \"tags\" : [\"a\", 2.5, null, [true, {}]], \"empty\" : [] } ");
+        CPPUNIT_ASSERT( v.isMap() );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(3), v.size() );
+        CPPUNIT_ASSERT_EQUAL( 7LL, v["id"].asInt64() );
+        CPPUNIT_ASSERT_EQUAL( std::string("a"), v["tags"][0].asString() );
+        CPPUNIT_ASSERT_EQUAL( 2.5, v["tags"][1].asFloat() );
+        CPPUNIT_ASSERT( v["tags"][2].isNull() );
+        CPPUNIT_ASSERT( v["tags"][3][1].isMap() );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(0), v["tags"][3][1].size() );
+        CPPUNIT_ASSERT( v["empty"].isArray() );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(0), v["empty"].size() );
+
+        //the last of repeated keys wins
+        CPPUNIT_ASSERT_EQUAL( 2LL, parse("{\"k\":[1],\"k\":2}")["k"].asInt64() );
+
+        //a reader is reusable, after failures too
+        JsonReader reader;
+        CPPUNIT_ASSERT_EQUAL( 1LL, reader.parse("[1]")[0].asInt64() );
+        CPPUNIT_ASSERT_THROW( reader.parse("[1,"), parsing_exception );
+        CPPUNIT_ASSERT_EQUAL( std::string("x"), reader.parse("{\"k\":\"x\"}")["k"].asString() );
+    }
+
+    void test_malformed()
+    {
+        const char* bad[] = {
+            "", "   ", "[", "]", "{", "[1,]", "[1 2]", "{\"a\" 1}", "{\"a\":}", "{\"a\":1,}", "{1:2}",
+            "nul", "truex", "True", "[1]]", "1 2", "\"abc", "\"abc\\\"", "\"a\nb\"", "\"\\x\"",
+            "\"\\u12\"", "\"\\ud800\"", "\"\\udc00\"", "\"\\ud800\\u0041\"", "01", "-", "1.", ".5", "1e", "+1",
+            "1.5.2", "[\"a\"\"b\"]", "\\\"", "[1]x", "{\"a\":1}}"
+        };
+        for(const char* text : bad)
+            CPPUNIT_ASSERT_MESSAGE( text, fails(text) );
+    }
+
+    void test_policy()
+    {
+        ValueSizePolicy policy = defaultStreamReaderPolicy();
+        policy.max_value_depth = 3;
+        CPPUNIT_ASSERT( not fails("[[[1]]]", policy) );
+        CPPUNIT_ASSERT( fails("[[[[1]]]]", policy) );
+        CPPUNIT_ASSERT( fails(std::string(100000, '[') + std::string(100000, ']')) );
+
+        policy = defaultStreamReaderPolicy();
+        policy.max_string_size = 4;
+        CPPUNIT_ASSERT( not fails("[\"abcd\"]", policy) );
+        CPPUNIT_ASSERT( fails("[\"abcde\"]", policy) );
+        CPPUNIT_ASSERT( fails("{\"abcde\":1}", policy) );
+
+        policy = defaultStreamReaderPolicy();
+        policy.max_object_size = 8;
+        CPPUNIT_ASSERT( not fails("[1,2,3] ", policy) );
+        CPPUNIT_ASSERT( fails("[1,2,3]  ", policy) );
+
+        policy = defaultStreamReaderPolicy();
+        CPPUNIT_ASSERT( not fails("\"\xff\"", policy) );
+        policy.validate_utf8 = true;
+        CPPUNIT_ASSERT( fails("\"\xff\"", policy) );
+        CPPUNIT_ASSERT( fails("{\"\xc0\xaf\":1}", policy) );
+        CPPUNIT_ASSERT( not fails("\"caf\xc3\xa9\"", policy) );
+    }
+
+    void test_roundtrip()
+    {
+        Value v;
+        for(int i = 0; i < 200; i++)
+        {
+            Value record;
+            record["id"] = i;
+            record["ratio"] = i / 7.0;
+            record["text"] = "line \"" + std::to_string(i) + "\"\n\twith\\escapes";
+            record["list"] = { i * 3, -i, true, Value() };
+            v.push_back(std::move(record));
+        }
+
+        JsonReader reader;
+        for(JsonWriter::Opt opt : { JsonWriter::compact, JsonWriter::pretty })
+        {
+            const std::string text = JsonWriter(opt).writeValue(v).release();
+            CPPUNIT_ASSERT( v == reader.parse(text) );
+        }
+    }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( Json_Reader_Test );
@@ -0,0 +1,128 @@
+#include "value.hpp"
+#include "json_writer.hpp"
+#include "../test_utils/format_helpers.hpp"
+#include <cppunit/extensions/HelperMacros.h>
+#include <limits>
+#include <cstdlib>
+#include <sstream>
+
+using namespace ubjson;
+int weird_cppunit_extern_bug_json_writer_test = 0;
+
+class Json_Writer_Test : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( Json_Writer_Test );
+    CPPUNIT_TEST( test_scalars );
+    CPPUNIT_TEST( test_doubles );
+    CPPUNIT_TEST( test_escaping );
+    CPPUNIT_TEST( test_containers );
+    CPPUNIT_TEST( test_pretty );
+    CPPUNIT_TEST_SUITE_END();
+
+    static std::string json(const Value& v, JsonWriter::Opt opt = JsonWriter::compact)
+    { return JsonWriter(opt).writeValue(v).release(); }
+
+public:
+    void test_scalars()
+    {
+        CPPUNIT_ASSERT_EQUAL( std::string("null"), json(Value()) );
+        CPPUNIT_ASSERT_EQUAL( std::string("true"), json(true) );
+        CPPUNIT_ASSERT_EQUAL( std::string("false"), json(false) );
+        CPPUNIT_ASSERT_EQUAL( std::string("\"@\""), json('@') );
+        CPPUNIT_ASSERT_EQUAL( std::string("0"), json(0) );
+        CPPUNIT_ASSERT_EQUAL( std::string("-7"), json(-7) );
+        CPPUNIT_ASSERT_EQUAL( std::string("1234567890"), json(1234567890) );
+        CPPUNIT_ASSERT_EQUAL( std::string("-9223372036854775808"), json(std::numeric_limits<long long>::min()) );
+        CPPUNIT_ASSERT_EQUAL( std::string("18446744073709551615"), json(std::numeric_limits<unsigned long long>::max()) );
+        CPPUNIT_ASSERT_EQUAL( std::string("-12.5e300"), json(Value::HighPrecisionType("-12.5e300")) );
+        CPPUNIT_ASSERT_EQUAL( std::string("[0,127,255]"), json(Value::BinaryType{ 0, 127, 255 }) );
+    }
+
+    void test_doubles()
+    {
+        CPPUNIT_ASSERT_EQUAL( std::string("0.1"), json(0.1) );
+        CPPUNIT_ASSERT_EQUAL( std::string("2.0"), json(2.0) );
+        CPPUNIT_ASSERT_EQUAL( std::string("-0.0"), json(-0.0) );
+        CPPUNIT_ASSERT_EQUAL( std::string("34.351"), json(34.351) );
+        CPPUNIT_ASSERT_EQUAL( std::string("1e300"), json(1e300) );
+        CPPUNIT_ASSERT_EQUAL( std::string("-2.5e-7"), json(-2.5e-7) );
+        CPPUNIT_ASSERT_EQUAL( std::string("0.000123"), json(0.000123) );
+        CPPUNIT_ASSERT_EQUAL( std::string("5e-324"), json(5e-324) );
+        CPPUNIT_ASSERT_EQUAL( std::string("null"), json(std::numeric_limits<double>::quiet_NaN()) );
+        CPPUNIT_ASSERT_EQUAL( std::string("null"), json(-std::numeric_limits<double>::infinity()) );
+
+        //every double reads back exactly
+        const double hard[] = { 1.0 / 3, 2.0 / 3, 0.1 + 0.2, 5e-324, 1.7976931348623157e308,
+                                9007199254740993.0, 123456789012345680.0, -4.35e-7 };
+        for(double d : hard)
+        {
+            const std::string text = json(d);
+            CPPUNIT_ASSERT_EQUAL( d, std::strtod(text.c_str(), nullptr) );
+            CPPUNIT_ASSERT( text.find_first_of(".e") != std::string::npos );
+        }
+    }
+
+    void test_escaping()
+    {
+        CPPUNIT_ASSERT_EQUAL( std::string("\"say \\\"hi\\\"\""), json("say \"hi\"") );
+        CPPUNIT_ASSERT_EQUAL( std::string("\"a\\\\b\\n\\t\\r\\b\\f\\u0001\\u001f\""), json("a\\b\n\t\r\b\f\x01\x1f") );
+        CPPUNIT_ASSERT_EQUAL( std::string("\"\\u0000\""), json(std::string(1, '\0')) );
+        CPPUNIT_ASSERT_EQUAL( std::string("\"caf\xc3\xa9 \x7f\""), json("caf\xc3\xa9 \x7f") );     //passed through
+
+        //escapes on both sides of every 16 byte block
+        std::string text, expected = "\"";
+        for(int i = 0; i < 100; i++)
+        {
+            const char c = i % 7 == 0 ? '"' : i % 11 == 0 ? '\n' : char('a' + i % 26);
+            text += c;
+            expected += c == '"' ? "\\\"" : c == '\n' ? "\\n" : std::string(1, c);
+        }
+        expected += '"';
+        CPPUNIT_ASSERT_EQUAL( expected, json(text) );
+
+        Value keyed;
+        keyed["line\nbreak"] = 1;
+        CPPUNIT_ASSERT_EQUAL( std::string("{\"line\\nbreak\":1}"), json(keyed) );
+    }
+
+    void test_containers()
+    {
+        Value v = { 1, "two", Value(), { 3.5, false } };
+        CPPUNIT_ASSERT_EQUAL( std::string("[1,\"two\",null,[3.5,false]]"), json(v) );
+
+        Value object;
+        object["list"] = v;
+        CPPUNIT_ASSERT_EQUAL( std::string("{\"list\":[1,\"two\",null,[3.5,false]]}"), json(object) );
+
+        //the buffer keeps growing until it is taken or cleared
+        JsonWriter writer;
+        writer.writeValue(1).writeValue(2);
+        CPPUNIT_ASSERT_EQUAL( std::string("12"), writer.str() );
+        writer.clear();
+        CPPUNIT_ASSERT_EQUAL( std::size_t(0), writer.size() );
+    }
+
+    void test_pretty()
+    {
+        Value v;
+        v["faves"] = { "Nigeria", 3.1416, '@' };
+        const std::string expected = "{\n\t\"faves\" : [\"Nigeria\", 3.1416, \"@\"]\n}";
+        CPPUNIT_ASSERT_EQUAL( expected, json(v, JsonWriter::pretty) );
+
+        std::ostringstream os;
+        os << to_ostream(v);
+        CPPUNIT_ASSERT_EQUAL( expected, os.str() );
+        os.str("");
+        os << to_ostream(v, to_ostream::compact);
+        CPPUNIT_ASSERT_EQUAL( std::string("{\"faves\":[\"Nigeria\",3.1416,\"@\"]}"), os.str() );
+
+        Value nested;
+        nested["in"] = { 1, Value() };
+        nested["in"][1]["deep"] = true;
+        CPPUNIT_ASSERT_EQUAL( std::string("{\n\t\"in\" : [1, {\n\t\t\t\"deep\" : true\n\t\t}]\n}"),
+                              json(nested, JsonWriter::pretty) );
+    }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( Json_Writer_Test );
@@ -0,0 +1,206 @@
+#include "value.hpp"
+#include "persistent_value.hpp"
+#include "../test_utils/format_helpers.hpp"
+#include <cppunit/extensions/HelperMacros.h>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+using namespace ubjson;
+int weird_cppunit_extern_bug_persistent_value_test = 0;
+
+class Persistent_Value_Test : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( Persistent_Value_Test );
+    CPPUNIT_TEST( test_conversion );
+    CPPUNIT_TEST( test_map_updates );
+    CPPUNIT_TEST( test_array_updates );
+    CPPUNIT_TEST( test_structural_sharing );
+    CPPUNIT_TEST( test_errors );
+    CPPUNIT_TEST( test_concurrent_readers );
+    CPPUNIT_TEST_SUITE_END();
+
+    static Value sample()
+    {
+        Value v;
+        v["name"] = "WhiZTiM";
+        v["ratio"] = 2.5;
+        v["empty"] = Value::ArrayType();
+        v["nested"]["list"] = { 1, "two", Value(), true, Value("k", 'c') };
+        v["nested"]["map"] = Value::MapType();
+        return v;
+    }
+
+public:
+    void test_conversion()
+    {
+        const Value v = sample();
+        const PersistentValue p = v;
+        CPPUNIT_ASSERT( p.isMap() );
+        CPPUNIT_ASSERT_EQUAL( v.size(), p.size() );
+        CPPUNIT_ASSERT( v == p.toValue() );
+        CPPUNIT_ASSERT_EQUAL( std::string("WhiZTiM"), p["name"].asString() );
+        CPPUNIT_ASSERT_EQUAL( 2.5, p["ratio"].asFloat() );
+        CPPUNIT_ASSERT_EQUAL( std::string("two"), p["nested"]["list"][1].asString() );
+        CPPUNIT_ASSERT( p["empty"].isArray() );
+        CPPUNIT_ASSERT( p["nested"]["map"].isMap() );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(0), p["nested"]["map"].size() );
+
+        Value::Keys keys = p.keys(), expected = v.keys();
+        std::sort(keys.begin(), keys.end());
+        std::sort(expected.begin(), expected.end());
+        CPPUNIT_ASSERT( keys == expected );
+
+        CPPUNIT_ASSERT( PersistentValue().isNull() );
+        CPPUNIT_ASSERT( PersistentValue().toValue().isNull() );
+        CPPUNIT_ASSERT_EQUAL( 42LL, PersistentValue(Value(42)).asInt64() );
+    }
+
+    void test_map_updates()
+    {
+        Value expected;
+        PersistentValue p;
+        std::vector<PersistentValue> versions;
+        for(int i = 0; i < 3000; i++)
+        {
+            const std::string key = "key" + std::to_string(i);
+            expected[key] = i;
+            p = p.with(key, Value(i));
+            versions.push_back(p);
+        }
+        CPPUNIT_ASSERT_EQUAL( std::size_t(3000), p.size() );
+        CPPUNIT_ASSERT( expected == p.toValue() );
+
+        //every version is still as it was
+        CPPUNIT_ASSERT_EQUAL( std::size_t(1), versions[0].size() );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(1000), versions[999].size() );
+        CPPUNIT_ASSERT( versions[999].contains("key999") );
+        CPPUNIT_ASSERT( not versions[999].contains("key1000") );
+
+        //replacing doesn't change the size
+        const PersistentValue replaced = p.with("key7", Value("seven"));
+        CPPUNIT_ASSERT_EQUAL( p.size(), replaced.size() );
+        CPPUNIT_ASSERT_EQUAL( std::string("seven"), replaced["key7"].asString() );
+        CPPUNIT_ASSERT_EQUAL( 7LL, p["key7"].asInt64() );
+
+        for(int i = 0; i < 3000; i += 2)
+        {
+            const std::string key = "key" + std::to_string(i);
+            expected.remove(key);
+            p = p.without(key);
+        }
+        CPPUNIT_ASSERT_EQUAL( std::size_t(1500), p.size() );
+        CPPUNIT_ASSERT( expected == p.toValue() );
+        CPPUNIT_ASSERT( p.sharesWith(p.without("absent")) );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(3000), versions.back().size() );
+
+        for(int i = 1; i < 3000; i += 2)
+            p = p.without("key" + std::to_string(i));
+        CPPUNIT_ASSERT( p.isMap() );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(0), p.size() );
+        CPPUNIT_ASSERT( p.find("key1") == nullptr );
+    }
+
+    void test_array_updates()
+    {
+        //across the boundaries of every level of the trie
+        Value expected;
+        PersistentValue p;
+        for(int i = 0; i < 40000; i++)
+        {
+            expected.push_back(i);
+            p = p.pushBack(Value(i));
+        }
+        CPPUNIT_ASSERT_EQUAL( std::size_t(40000), p.size() );
+        CPPUNIT_ASSERT( expected == p.toValue() );
+
+        //converted directly, the layout is the same
+        const PersistentValue direct = expected;
+        for(int i : { 0, 31, 32, 1023, 1024, 32767, 32768, 39999 })
+        {
+            CPPUNIT_ASSERT_EQUAL( static_cast<long long>(i), direct[i].asInt64() );
+            CPPUNIT_ASSERT_EQUAL( static_cast<long long>(i), p[i].asInt64() );
+        }
+        CPPUNIT_ASSERT_EQUAL( expected.size() + 1, direct.pushBack(Value(1)).size() );
+
+        PersistentValue changed = direct;
+        for(int i = 0; i < 40000; i += 97)
+            changed = changed.with(i, Value(-i));
+        for(int i = 0; i < 40000; i += 97)
+        {
+            CPPUNIT_ASSERT_EQUAL( static_cast<long long>(-i), changed[i].asInt64() );
+            CPPUNIT_ASSERT_EQUAL( static_cast<long long>(i), direct[i].asInt64() );
+        }
+        CPPUNIT_ASSERT_EQUAL( 98LL, changed[98].asInt64() );
+    }
+
+    void test_structural_sharing()
+    {
+        const PersistentValue v1 = sample();
+        const PersistentValue v2 = v1.with("name", Value("Timothy"));
+
+        CPPUNIT_ASSERT( v2["nested"].sharesWith(v1["nested"]) );
+        CPPUNIT_ASSERT( not v2["name"].sharesWith(v1["name"]) );
+
+        const PersistentValue v3 = v2.with("nested", v2["nested"].with("list", v2["nested"]["list"].with(1, Value(2))));
+        CPPUNIT_ASSERT_EQUAL( 2LL, v3["nested"]["list"][1].asInt64() );
+        CPPUNIT_ASSERT_EQUAL( std::string("two"), v2["nested"]["list"][1].asString() );
+        CPPUNIT_ASSERT( v3["nested"]["map"].sharesWith(v2["nested"]["map"]) );
+        CPPUNIT_ASSERT( v3["nested"]["list"][4].sharesWith(v1["nested"]["list"][4]) );
+
+        PersistentValue copy = v3;
+        CPPUNIT_ASSERT( copy.sharesWith(v3) );
+    }
+
+    void test_errors()
+    {
+        const PersistentValue map = sample();
+        const PersistentValue array = Value{ 1, 2, 3 };
+        const PersistentValue scalar = Value(3);
+
+        CPPUNIT_ASSERT_THROW( map["absent"], std::out_of_range );
+        CPPUNIT_ASSERT_THROW( array[3], std::out_of_range );
+        CPPUNIT_ASSERT_THROW( array.with(3, Value()), std::out_of_range );
+        CPPUNIT_ASSERT_THROW( map[0], value_exception );
+        CPPUNIT_ASSERT_THROW( array["k"], value_exception );
+        CPPUNIT_ASSERT_THROW( scalar.with("k", Value()), value_exception );
+        CPPUNIT_ASSERT_THROW( scalar.pushBack(Value()), value_exception );
+        CPPUNIT_ASSERT_THROW( array.without("k"), value_exception );
+
+        //a Null becomes a Map or an Array, like Value
+        CPPUNIT_ASSERT( PersistentValue().with("k", Value(1)).isMap() );
+        CPPUNIT_ASSERT( PersistentValue().pushBack(Value(1)).isArray() );
+        CPPUNIT_ASSERT( map.find("absent") == nullptr );
+        CPPUNIT_ASSERT( array.find("k") == nullptr );
+    }
+
+    void test_concurrent_readers()
+    {
+        PersistentValue state;
+        for(int i = 0; i < 1000; i++)
+            state = state.with(std::to_string(i), Value(i));
+        const PersistentValue snapshot = state;
+
+        std::vector<std::thread> readers;
+        std::vector<long long> sums(4, 0);
+        for(std::size_t t = 0; t < sums.size(); ++t)
+            readers.emplace_back([&snapshot, &sums, t]
+            {
+                for(int round = 0; round < 20; round++)
+                    for(int i = 0; i < 1000; i++)
+                        sums[t] += snapshot[std::to_string(i)].asInt64();
+            });
+
+        //the writer keeps making versions from the same nodes meanwhile
+        for(int i = 0; i < 1000; i++)
+            state = state.with(std::to_string(i), Value(-i)).without(std::to_string(i + 1));
+
+        for(auto& reader : readers)
+            reader.join();
+        for(long long sum : sums)
+            CPPUNIT_ASSERT_EQUAL( 20LL * 999 * 1000 / 2, sum );
+    }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( Persistent_Value_Test );
@@ -0,0 +1,130 @@
+#include "value.hpp"
+#include "snapshot_holder.hpp"
+#include "../test_utils/format_helpers.hpp"
+#include <cppunit/extensions/HelperMacros.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <stdexcept>
+
+using namespace ubjson;
+int weird_cppunit_extern_bug_snapshot_holder_test = 0;
+
+class Snapshot_Holder_Test : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( Snapshot_Holder_Test );
+    CPPUNIT_TEST( test_publish_and_acquire );
+    CPPUNIT_TEST( test_reclamation );
+    CPPUNIT_TEST( test_reader_slots );
+    CPPUNIT_TEST( test_stress );
+    CPPUNIT_TEST_SUITE_END();
+
+    //! every item equals the version, so a torn or freed table shows up
+    static Value table(int version)
+    {
+        Value v;
+        v["version"] = version;
+        for(int i = 0; i < 16; i++)
+            v["items"].push_back(version);
+        return v;
+    }
+
+    static bool consistent(const Value& v)
+    {
+        const long long version = v["version"].asInt64();
+        for(const auto& item : v["items"])
+            if(item.asInt64() != version)
+                return false;
+        return v["items"].size() == 16;
+    }
+
+public:
+    void test_publish_and_acquire()
+    {
+        SnapshotHolder holder(table(0));
+        SnapshotHolder::Reader reader(holder);
+        {
+            SnapshotHolder::Snapshot first = reader.acquire();
+            holder.publish(table(1));
+            SnapshotHolder::Snapshot second = reader.acquire();     //nested
+
+            //a snapshot doesn't change under its reader
+            CPPUNIT_ASSERT_EQUAL( 0LL, (*first)["version"].asInt64() );
+            CPPUNIT_ASSERT_EQUAL( 1LL, (*second)["version"].asInt64() );
+            CPPUNIT_ASSERT( consistent(*first) );
+
+            SnapshotHolder::Snapshot moved = std::move(first);
+            CPPUNIT_ASSERT_EQUAL( 0LL, moved->operator[]("version").asInt64() );
+        }
+        CPPUNIT_ASSERT_EQUAL( 1LL, (*reader.acquire())["version"].asInt64() );
+    }
+
+    void test_reclamation()
+    {
+        SnapshotHolder holder(table(0));
+        SnapshotHolder::Reader reader(holder);
+
+        holder.publish(table(1));
+        CPPUNIT_ASSERT_EQUAL( std::size_t(0), holder.getRetiredCount() );
+
+        {
+            SnapshotHolder::Snapshot held = reader.acquire();
+            holder.publish(table(2));
+            holder.publish(table(3));
+            CPPUNIT_ASSERT_EQUAL( std::size_t(2), holder.getRetiredCount() );
+            CPPUNIT_ASSERT_EQUAL( 1LL, (*held)["version"].asInt64() );
+        }
+
+        holder.reclaim();
+        CPPUNIT_ASSERT_EQUAL( std::size_t(0), holder.getRetiredCount() );
+        CPPUNIT_ASSERT_EQUAL( 3LL, (*reader.acquire())["version"].asInt64() );
+    }
+
+    void test_reader_slots()
+    {
+        SnapshotHolder holder(Value(), 2);
+        {
+            SnapshotHolder::Reader r1(holder), r2(holder);
+            CPPUNIT_ASSERT_THROW( SnapshotHolder::Reader r3(holder), std::length_error );
+        }
+        SnapshotHolder::Reader r3(holder);
+        CPPUNIT_ASSERT( r3.acquire()->isNull() );
+    }
+
+    //readers check every version they see while the writer keeps replacing it
+    void test_stress()
+    {
+        SnapshotHolder holder(table(0), 16);
+        std::atomic<bool> done{ false };
+        std::atomic<int> failures{ 0 };
+
+        std::vector<std::thread> readers;
+        for(int t = 0; t < 6; t++)
+            readers.emplace_back([&]
+            {
+                SnapshotHolder::Reader reader(holder);
+                long long last = 0;
+                while(not done.load())
+                {
+                    SnapshotHolder::Snapshot snapshot = reader.acquire();
+                    const long long version = (*snapshot)["version"].asInt64();
+                    if(not consistent(*snapshot) or version < last)
+                        ++failures;
+                    last = version;
+                }
+            });
+
+        for(int version = 1; version <= 5000; version++)
+            holder.publish(table(version));
+        done.store(true);
+        for(auto& reader : readers)
+            reader.join();
+
+        CPPUNIT_ASSERT_EQUAL( 0, failures.load() );
+        holder.reclaim();
+        CPPUNIT_ASSERT_EQUAL( std::size_t(0), holder.getRetiredCount() );
+    }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( Snapshot_Holder_Test );
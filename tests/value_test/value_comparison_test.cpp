@@ -0,0 +1,105 @@
+#include "value.hpp"
+#include "../test_utils/format_helpers.hpp"
+#include <cppunit/extensions/HelperMacros.h>
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include <map>
+
+using namespace ubjson;
+int weird_cppunit_extern_bug_value_comparison_test = 0;
+
+class Value_Comparison_Test : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( Value_Comparison_Test );
+    CPPUNIT_TEST( test_exact_numbers );
+    CPPUNIT_TEST( test_type_order );
+    CPPUNIT_TEST( test_containers );
+    CPPUNIT_TEST( test_sort_and_search );
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void test_exact_numbers()
+    {
+        //2^53 + 1 has no double
+        CPPUNIT_ASSERT( Value(9007199254740993ll) != Value(9007199254740992.0) );
+        CPPUNIT_ASSERT( Value(9007199254740992.0) < Value(9007199254740993ll) );
+        CPPUNIT_ASSERT( Value(9007199254740992ll) == Value(9007199254740992.0) );
+        CPPUNIT_ASSERT( Value(18446744073709551615ull) != Value(18446744073709551614ull) );
+
+        CPPUNIT_ASSERT( Value(-1) < Value(0ull) );
+        CPPUNIT_ASSERT( Value(-1) < Value(18446744073709551615ull) );
+        CPPUNIT_ASSERT( Value(std::numeric_limits<long long>::max()) < Value(9223372036854775808ull) );
+        CPPUNIT_ASSERT( Value(9223372036854775808ull) == Value(9223372036854775808.0) );
+        CPPUNIT_ASSERT( Value(1e30) > Value(18446744073709551615ull) );
+        CPPUNIT_ASSERT( Value(-1e30) < Value(std::numeric_limits<long long>::lowest()) );
+
+        CPPUNIT_ASSERT( Value(1) < Value(1.5) and Value(1.5) < Value(2ull) );
+        CPPUNIT_ASSERT( Value(-2) < Value(-1.5) and Value(-1.5) < Value(-1) );
+        CPPUNIT_ASSERT( Value(0.1) != Value(0.1 + 1e-17 * 2) );
+        CPPUNIT_ASSERT( Value(-0.0) == Value(0) );
+
+        const double nan = std::numeric_limits<double>::quiet_NaN();
+        CPPUNIT_ASSERT( Value(nan) == Value(nan) );
+        CPPUNIT_ASSERT( Value(nan) > Value(std::numeric_limits<double>::infinity()) );
+        CPPUNIT_ASSERT( Value(nan) > Value(18446744073709551615ull) );
+    }
+
+    void test_type_order()
+    {
+        std::vector<Value> values = { Value("a", 1), Value{ 1, 2 }, Value("b"), Value('c'),
+                                      Value(HighPrecisionNumber("1e400")), Value(3.5), Value(true), Value() };
+        std::reverse(values.begin(), values.end());
+        std::vector<Value> sorted = values;
+        std::sort(sorted.begin(), sorted.end());
+        CPPUNIT_ASSERT( sorted == values );
+
+        CPPUNIT_ASSERT( Value(false) < Value(true) );
+        CPPUNIT_ASSERT( Value(true) < Value(0) );
+        CPPUNIT_ASSERT( Value("ab") < Value("b") and Value("a") < Value("ab") );
+        CPPUNIT_ASSERT( Value(HighPrecisionNumber("2")) < Value(HighPrecisionNumber("10")) );
+        CPPUNIT_ASSERT( Value(HighPrecisionNumber("1.0")).compare(Value(HighPrecisionNumber("1"))) != 0 );
+    }
+
+    void test_containers()
+    {
+        CPPUNIT_ASSERT( (Value{ 1, 2 }) < (Value{ 1, 3 }) );
+        CPPUNIT_ASSERT( (Value{ 1, 2 }) < (Value{ 1, 2, 0 }) );
+        CPPUNIT_ASSERT( (Value{ 2, 0 }) > (Value{ 1, 2, 0 }) );
+
+        Value m1, m2;
+        m1["x"] = 1;    m1["y"] = 2;
+        m2["y"] = 2.0;  m2["x"] = 1;
+        CPPUNIT_ASSERT_EQUAL( 0, m1.compare(m2) );
+        m2["y"] = 3;
+        CPPUNIT_ASSERT( m1 < m2 );
+        m2["a"] = 0;
+        CPPUNIT_ASSERT( m1 < m2 );
+        m1["a"] = 0;
+        CPPUNIT_ASSERT( m1 < m2 );
+        m1["w"] = 0;
+        CPPUNIT_ASSERT( m1 > m2 );
+    }
+
+    void test_sort_and_search()
+    {
+        std::vector<Value> values;
+        for(int i = 0; i < 1000; i++)
+            values.push_back(i % 3 ? Value((i * 7919) % 1000) : Value((i * 7919) % 1000 + 0.5));
+        std::sort(values.begin(), values.end());
+        CPPUNIT_ASSERT( std::is_sorted(values.begin(), values.end()) );
+        for(int i = 0; i < 1000; i += 37)
+            CPPUNIT_ASSERT( std::binary_search(values.begin(), values.end(), Value(values[i].asFloat())) );
+        CPPUNIT_ASSERT( not std::binary_search(values.begin(), values.end(), Value(500.25)) );
+
+        std::map<Value, int> keyed;
+        keyed[Value(1)] = 1;
+        keyed[Value(1.0)] = 2;
+        keyed[Value("1")] = 3;
+        CPPUNIT_ASSERT_EQUAL( std::size_t(2), keyed.size() );
+        CPPUNIT_ASSERT_EQUAL( 2, keyed[Value(1ull)] );
+    }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( Value_Comparison_Test );
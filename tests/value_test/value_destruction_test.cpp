@@ -0,0 +1,101 @@
+#include "value.hpp"
+#include "background_reclaimer.hpp"
+#include "../test_utils/format_helpers.hpp"
+#include <cppunit/extensions/HelperMacros.h>
+#include <thread>
+#include <vector>
+
+using namespace ubjson;
+int weird_cppunit_extern_bug_value_destruction_test = 0;
+
+class Value_Destruction_Test : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( Value_Destruction_Test );
+    CPPUNIT_TEST( test_deep_trees );
+    CPPUNIT_TEST( test_shared_subtrees );
+    CPPUNIT_TEST( test_background_reclaimer );
+    CPPUNIT_TEST_SUITE_END();
+
+    //! a chain of \a depth single item Arrays and single member Maps, alternately
+    static Value chain(int depth)
+    {
+        Value root;
+        Value* at = &root;
+        for(int i = 0; i < depth; i++)
+            if(i % 2)
+                at = &(*at)["next"];
+            else
+            {
+                at->push_back(Value());
+                at = &(*at)[0];
+            }
+        *at = "leaf";
+        return root;
+    }
+
+public:
+    void test_deep_trees()
+    {
+        //far deeper than the stack would allow if destruction recursed
+        for(int round = 0; round < 2; round++)
+        {
+            Value deep = chain(1000000);
+            CPPUNIT_ASSERT( deep.isArray() );
+        }
+
+        Value reassigned = chain(1000000);
+        reassigned = Value(5);
+        CPPUNIT_ASSERT_EQUAL( 5LL, reassigned.asInt64() );
+    }
+
+    void test_shared_subtrees()
+    {
+        Value deep = chain(1000);
+        Value copy = deep;
+        {
+            Value other = deep;
+            other[0]["next"][0] = 1;        //copies the path, shares the rest
+        }
+        deep = Value();
+
+        //the copy still owns the whole tree
+        const Value* at = &copy;
+        for(int i = 0; i < 1000; i++)
+            at = i % 2 ? &(*at)["next"] : &(*at)[0];
+        CPPUNIT_ASSERT_EQUAL( std::string("leaf"), at->asString() );
+    }
+
+    void test_background_reclaimer()
+    {
+        BackgroundReclaimer janitor;
+        Value big;
+        for(int i = 0; i < 10000; i++)
+            big.push_back(Value("id", i));
+        const Value kept = big;
+
+        janitor.dispose(std::move(big));
+        janitor.dispose(chain(100000));
+        CPPUNIT_ASSERT( big.isNull() );
+
+        std::vector<std::thread> threads;
+        for(int t = 0; t < 4; t++)
+            threads.emplace_back([&janitor, t]
+            {
+                for(int i = 0; i < 100; i++)
+                    janitor.dispose(Value({ t, i, "x" }));
+            });
+        for(auto& thread : threads)
+            thread.join();
+
+        janitor.drain();
+        CPPUNIT_ASSERT_EQUAL( std::size_t(0), janitor.getPendingCount() );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(10000), kept.size() );
+        CPPUNIT_ASSERT_EQUAL( 9999LL, kept[9999]["id"].asInt64() );
+
+        //whatever is pending when it is destroyed is still freed
+        BackgroundReclaimer().dispose(chain(1000));
+    }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( Value_Destruction_Test );
@@ -0,0 +1,123 @@
+#include "value.hpp"
+#include "../test_utils/format_helpers.hpp"
+#include <cppunit/extensions/HelperMacros.h>
+#include <unordered_set>
+#include <string>
+#include <set>
+
+using namespace ubjson;
+int weird_cppunit_extern_bug_value_hash_test = 0;
+
+class Value_Hash_Test : public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE( Value_Hash_Test );
+    CPPUNIT_TEST( test_consistent_with_equality );
+    CPPUNIT_TEST( test_spread );
+    CPPUNIT_TEST( test_cache_invalidation );
+    CPPUNIT_TEST( test_unordered_set );
+    CPPUNIT_TEST_SUITE_END();
+
+    static std::size_t hash(const Value& v)
+    { return std::hash<Value>()(v); }
+
+public:
+    void test_consistent_with_equality()
+    {
+        Value m1, m2;
+        m1["name"] = "Joy";     m1["id"] = 34;      m1["tags"] = { "a", 'b', 2.5 };
+        m2["tags"] = { "a", 'b', 2.5 };     m2["id"] = 34ull;   m2["name"] = "Joy";
+        CPPUNIT_ASSERT( m1 == m2 );
+        CPPUNIT_ASSERT_EQUAL( hash(m1), hash(m2) );
+
+        CPPUNIT_ASSERT_EQUAL( hash(Value(1)), hash(Value(1.0)) );
+        CPPUNIT_ASSERT_EQUAL( hash(Value(10000000000ll)), hash(Value(1e10)) );
+        CPPUNIT_ASSERT_EQUAL( hash(Value(-7)), hash(Value(-7.0)) );
+        CPPUNIT_ASSERT( Value(-7) != Value(-8) );
+        CPPUNIT_ASSERT( hash(Value(-7)) != hash(Value(-8)) );
+
+        CPPUNIT_ASSERT_EQUAL( hash(Value(9007199254740993ull)), hash(Value(9007199254740993ll)) );
+        CPPUNIT_ASSERT_EQUAL( hash(Value(-0.0)), hash(Value(0)) );
+
+        const Value big = HighPrecisionNumber("123456789012345678901234567890123456789012345678901234567890123456789");
+        CPPUNIT_ASSERT_EQUAL( hash(big), hash(Value(HighPrecisionNumber(big.asString()))) );
+    }
+
+    void test_spread()
+    {
+        std::set<std::size_t> seen;
+        std::string s;
+        for(int i = 0; i < 100; i++)
+        {
+            seen.insert(hash(s));
+            s += 'x';
+        }
+        CPPUNIT_ASSERT_EQUAL( std::size_t(100), seen.size() );
+
+        CPPUNIT_ASSERT( hash(Value{ 1, "a" }) != hash(Value{ "a", 1 }) );
+        CPPUNIT_ASSERT( hash(Value("a", 5)) != hash(Value("b", 5)) );
+        CPPUNIT_ASSERT( hash(Value('a')) != hash(Value("a")) );
+        CPPUNIT_ASSERT( hash(Value(100)) != hash(Value(101)) );
+        CPPUNIT_ASSERT( hash(Value()) != hash(Value(false)) );
+    }
+
+    void test_cache_invalidation()
+    {
+        Value v;
+        v["inner"]["x"] = 1;
+        v["list"] = { 1, 2, 3 };
+        const std::size_t before = hash(v);
+        const Value copy = v;
+        CPPUNIT_ASSERT_EQUAL( before, hash(copy) );
+
+        v["inner"]["x"] = 100;
+        CPPUNIT_ASSERT( before != hash(v) );
+        CPPUNIT_ASSERT( v != copy );
+
+        v["inner"]["x"] = 1;
+        CPPUNIT_ASSERT_EQUAL( before, hash(v) );
+        CPPUNIT_ASSERT( v == copy );
+
+        v["list"].push_back(4);
+        CPPUNIT_ASSERT( before != hash(v) );
+        v["list"].remove(4);
+        CPPUNIT_ASSERT_EQUAL( before, hash(v) );
+
+        v = Value{ 1, 2 };
+        CPPUNIT_ASSERT_EQUAL( hash(Value{ 1.0, 2 }), hash(v) );
+        CPPUNIT_ASSERT_EQUAL( before, hash(copy) );
+
+        //a reference kept from before hashing leaves no stale hash behind
+        Value a, b;
+        Value& k = a["k"];
+        k = 1;
+        const std::size_t one = hash(a);
+        k = 2;
+        b["k"] = 2;
+        hash(b);
+        CPPUNIT_ASSERT( one != hash(a) );
+        CPPUNIT_ASSERT( a == b );
+    }
+
+    void test_unordered_set()
+    {
+        std::unordered_set<Value> values;
+        for(int i = 0; i < 1000; i++)
+        {
+            Value record;
+            record["id"] = i % 100;
+            record["name"] = "n" + std::to_string(i % 100);
+            values.insert(std::move(record));
+        }
+        CPPUNIT_ASSERT_EQUAL( std::size_t(100), values.size() );
+
+        Value probe;
+        probe["name"] = "n42";
+        probe["id"] = 42.0;
+        CPPUNIT_ASSERT( values.count(probe) == 1 );
+        probe["id"] = 43;
+        CPPUNIT_ASSERT( values.count(probe) == 0 );
+    }
+
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION( Value_Hash_Test );
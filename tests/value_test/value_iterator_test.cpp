@@ -16,6 +16,8 @@ class Value_Iterator_Test : public CppUnit::TestFixture
     CPPUNIT_TEST( test_iterator );
     CPPUNIT_TEST( test_modifying_iterator );
     CPPUNIT_TEST( test_iterator_on_algorithm );
+    CPPUNIT_TEST( test_items );
+    CPPUNIT_TEST( test_elements );
     CPPUNIT_TEST_SUITE_END();
 public:
     using T = Value::BinaryType::value_type;
@@ -177,6 +179,71 @@ public:
         CPPUNIT_ASSERT_EQUAL( "466"s, cm->asString() );
     }
 
+    void test_items()
+    {
+        const Value& map = *v_map;
+        std::size_t count = 0;
+        for(auto member : map.items())
+        {
+            CPPUNIT_ASSERT( member.value == map[member.key] );
+            CPPUNIT_ASSERT( &member.value == &map[member.key] );    //the very Value in the Map
+            ++count;
+        }
+        CPPUNIT_ASSERT_EQUAL( map.size(), count );
+
+        for(auto member : v_map->items())
+            if(member.key == "id")
+                member.value = 1;
+        CPPUNIT_ASSERT_EQUAL( 1LL, (*v_map)["id"].asInt64() );
+
+        const Value copy = *v_map;
+        for(auto member : v_map->items())     //unshares first, like the other non-const accesses
+            member.value = Value();
+        CPPUNIT_ASSERT_EQUAL( 1LL, copy["id"].asInt64() );
+
+        CPPUNIT_ASSERT( v_array->items().empty() );
+        CPPUNIT_ASSERT( v_empty->items().empty() );
+
+        //members are made on dereference, so algorithms may only rely on a single pass
+        using category = std::iterator_traits<Value::member_iterator>::iterator_category;
+        CPPUNIT_ASSERT( (std::is_same<category, std::input_iterator_tag>::value) );
+    }
+
+    void test_elements()
+    {
+        Value arr;
+        for(int i = 0; i < 1000; i++)
+            arr.push_back((i * 7919) % 1000);
+        const Value copy = arr;
+
+        auto items = arr.elements();
+        CPPUNIT_ASSERT_EQUAL( std::size_t(1000), items.size() );
+        std::sort(items.begin(), items.end());
+        CPPUNIT_ASSERT( std::is_sorted(items.begin(), items.end()) );
+        CPPUNIT_ASSERT( copy != arr );      //unshares first, like the other non-const accesses
+        for(int i = 0; i < 1000; i += 37)
+        {
+            CPPUNIT_ASSERT_EQUAL( (long long)i, items.begin()[i].asInt64() );
+            CPPUNIT_ASSERT( std::lower_bound(items.begin(), items.end(), Value(i)) == items.begin() + i );
+        }
+        CPPUNIT_ASSERT( &*(items.end() - 1) == &arr[999] );
+        CPPUNIT_ASSERT_EQUAL( 999LL, std::prev(items.end())->asInt64() );
+
+        const Value& const_arr = arr;
+        Value::const_array_iterator first = items.begin();      //converts to a const iterator
+        CPPUNIT_ASSERT( first == const_arr.elements().begin() );
+        CPPUNIT_ASSERT( const_arr.elements().end() - first == 1000 );
+        CPPUNIT_ASSERT( first < items.end() and items.end() > first );
+        CPPUNIT_ASSERT( std::equal(std::reverse_iterator<Value::const_array_iterator>(const_arr.elements().end()),
+                                   std::reverse_iterator<Value::const_array_iterator>(first),
+                                   const_arr.elements().begin(),
+                                   [](const Value& a, const Value& b){ return a.asInt64() == 999 - b.asInt64(); }) );
+
+        CPPUNIT_ASSERT( v_map->elements().empty() );
+        CPPUNIT_ASSERT( v_empty->elements().empty() );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(0), v_string->elements().size() );
+    }
+
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION( Value_Iterator_Test );
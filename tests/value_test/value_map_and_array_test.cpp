@@ -10,6 +10,9 @@ class Value_Map_and_Array_Test : public CppUnit::TestFixture
     CPPUNIT_TEST_SUITE( Value_Map_and_Array_Test );
     CPPUNIT_TEST( test_pushBack );
     CPPUNIT_TEST( test_IndexingOperator );
+    CPPUNIT_TEST( test_copyOnWrite );
+    CPPUNIT_TEST( test_indexedSearch );
+    CPPUNIT_TEST( test_removeIf );
     CPPUNIT_TEST_SUITE_END();
 public:
     using T = Value::BinaryType::value_type;
@@ -129,6 +132,154 @@ public:
         CPPUNIT_ASSERT_EQUAL( std::size_t(4), Map.size() );
     }
 
+    void test_copyOnWrite()
+    {
+        Value original;
+        original["name"] = "WhiZTiM";
+        original["list"] = { 1, 2, Value("deep", { 3, 4 }) };
+
+        //copies share until modified, then only the modified copy changes
+        Value copy = original;
+        const Value& c_copy = copy;
+        CPPUNIT_ASSERT( &c_copy["list"] == &static_cast<const Value&>(original)["list"] );
+
+        copy["list"][2]["deep"].push_back(5);
+        CPPUNIT_ASSERT_EQUAL( std::size_t(3), copy["list"][2]["deep"].size() );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(2), original["list"][2]["deep"].size() );
+        CPPUNIT_ASSERT_EQUAL( std::string("WhiZTiM"), copy["name"].asString() );
+
+        Value other = original;
+        other.remove("name");
+        other["list"].remove(1);
+        CPPUNIT_ASSERT( not other.contains("name") );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(2), other["list"].size() );
+        CPPUNIT_ASSERT( original.contains("name") );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(3), original["list"].size() );
+
+        //through iterators too
+        Value array = { 1, 2, 3 };
+        Value shared = array;
+        for(auto& item : shared)
+            item = 0;
+        CPPUNIT_ASSERT( array == Value({ 1, 2, 3 }) );
+        CPPUNIT_ASSERT( shared == Value({ 0, 0, 0 }) );
+
+        //the original being modified leaves the copies alone
+        Value before = array;
+        array[0] = 9;
+        CPPUNIT_ASSERT_EQUAL( 1LL, before[0].asInt64() );
+        CPPUNIT_ASSERT_EQUAL( 9LL, array[0].asInt64() );
+
+        //an iterator kept from before a copy modifies only the Value it came from
+        Value map;
+        map["a"] = 1;
+        auto a = map.find("a");
+        Value map_copy = map;
+        *a = 2;
+        CPPUNIT_ASSERT_EQUAL( 1LL, map_copy["a"].asInt64() );
+        CPPUNIT_ASSERT_EQUAL( 2LL, map["a"].asInt64() );
+
+        auto it = array.begin();
+        Value array_copy = array;
+        *it = 7;
+        CPPUNIT_ASSERT_EQUAL( 9LL, array_copy[0].asInt64() );
+        CPPUNIT_ASSERT_EQUAL( 7LL, array[0].asInt64() );
+
+        //until a modification invalidates the iterators; copies share again from then on
+        array.push_back(4);
+        const Value shared_again = array;
+        CPPUNIT_ASSERT( &shared_again[0] == &static_cast<const Value&>(array)[0] );
+    }
+
+    void test_indexedSearch()
+    {
+        Value array;
+        for(int i = 0; i < 1000; i++)
+            if(not array.contains(i % 500))     //builds the index once, then keeps it up to date
+                array.push_back(Value("id", i % 500));
+        CPPUNIT_ASSERT_EQUAL( std::size_t(1000), array.size() );
+
+        Value set;
+        for(int i = 0; i < 1000; i++)
+            if(not set.contains(i % 500))
+                set.push_back(i % 500);
+        CPPUNIT_ASSERT_EQUAL( std::size_t(500), set.size() );
+        CPPUNIT_ASSERT( set.contains(499.0) );
+        CPPUNIT_ASSERT( not set.contains("499") );
+
+        //duplicates: find() and remove() take the first one
+        set.push_back(7);
+        CPPUNIT_ASSERT( &*set.find(7) == &set[7] );
+        set.remove(7);
+        CPPUNIT_ASSERT_EQUAL( 8LL, set[7].asInt64() );
+        CPPUNIT_ASSERT( set.contains(7) );
+        set.remove(7);
+        CPPUNIT_ASSERT( not set.contains(7) );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(499), set.size() );
+
+        //a copy searches the same index; modifying either leaves the other's intact
+        Value indexed;
+        for(int i = 0; i < 500; i++)
+            indexed.push_back(i);
+        const Value copy = indexed;
+        CPPUNIT_ASSERT( copy.contains(0) );
+        indexed.remove(0);
+        indexed.push_back(1000);
+        CPPUNIT_ASSERT( indexed.contains(1000) and not indexed.contains(0) );
+        CPPUNIT_ASSERT( copy.contains(0) and not copy.contains(1000) );
+        indexed.remove(300);
+        CPPUNIT_ASSERT( copy.contains(300) and not indexed.contains(300) );
+
+        //an item changed through a reference kept from before a search is still found
+        Value& item = indexed[3];
+        CPPUNIT_ASSERT( not indexed.contains(2000) );
+        item = 2000;
+        CPPUNIT_ASSERT( indexed.contains(2000) );
+        CPPUNIT_ASSERT( &*indexed.find(2000) == &item );
+        indexed.remove(2000);
+        CPPUNIT_ASSERT( not indexed.contains(2000) );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(498), indexed.size() );
+
+        //whether it was handed out before the index was built or after
+        Value fresh;
+        for(int i = 0; i < 100; i++)
+            fresh.push_back(i);
+        Value& early = fresh[5];
+        CPPUNIT_ASSERT( fresh.contains(99) );
+        early = 5000;
+        Value& late = fresh[6];
+        late = 6000;
+        CPPUNIT_ASSERT( fresh.contains(5000) and fresh.contains(6000) );
+        CPPUNIT_ASSERT( not fresh.contains(5) and not fresh.contains(6) );
+        fresh.remove(6000);
+        CPPUNIT_ASSERT( not fresh.contains(6000) and fresh.contains(7) );
+    }
+
+    void test_removeIf()
+    {
+        Value array;
+        for(int i = 0; i < 100000; i++)
+            array.push_back(i);
+        CPPUNIT_ASSERT( array.contains(99999) );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(50000), array.remove_if([](const Value& v){ return v.asInt64() % 2; }) );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(50000), array.size() );
+        CPPUNIT_ASSERT_EQUAL( 99998LL, array[49999].asInt64() );
+        CPPUNIT_ASSERT( not array.contains(99999) and array.contains(99998) );
+
+        //nothing matching leaves shared items shared
+        const Value copy = array;
+        CPPUNIT_ASSERT_EQUAL( std::size_t(0), array.remove_if([](const Value& v){ return v.asInt64() < 0; }) );
+        CPPUNIT_ASSERT( &copy[0] == &static_cast<const Value&>(array)[0] );
+
+        Value map;
+        map["a"] = 1;   map["b"] = 2;   map["c"] = 3;
+        const Value map_copy = map;
+        CPPUNIT_ASSERT_EQUAL( std::size_t(2), map.remove_if([](const Value& v){ return v.asInt64() != 2; }) );
+        CPPUNIT_ASSERT( map == Value("b", 2) );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(3), map_copy.size() );
+        CPPUNIT_ASSERT_EQUAL( std::size_t(0), v_string->remove_if([](const Value&){ return true; }) );
+    }
+
 };
 
 CPPUNIT_TEST_SUITE_REGISTRATION( Value_Map_and_Array_Test );